@@ -0,0 +1,217 @@
+/*
+ * bank_transfer — bank_account documents and asynchronous transfers between them
+ *
+ * The account type, its JSON mapping and the bank_error category are the ones of
+ * transactions_transfer_basic.cpp, shared here by the programs that run many
+ * transfers.
+ *
+ * submit_transfer() moves `amount` from one account to another in a transaction run by
+ * a transaction_executor (transaction_executor.hxx) through the async_attempt_context
+ * API.  Each attempt reads both accounts concurrently; whichever read completes second
+ * stages both replaces, so an attempt costs two round trips before the commit instead
+ * of four.  If the source account cannot cover the amount, nothing is staged, the
+ * empty transaction commits, and the transfer reports bank_error::insufficient_funds.
+ *
+ * The handler receives the outcome on an SDK I/O thread: the transaction's error (or
+ * insufficient_funds), and the number of attempts it took, which counts the rollbacks
+ * caused by conflicting transfers.
+ */
+
+#pragma once
+
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/collection.hxx>
+#include <couchbase/transactions/async_attempt_context.hxx>
+
+#include <tao/json.hpp>
+
+#include "transaction_executor.hxx"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+enum bank_error : int {
+  insufficient_funds = 1,
+};
+
+namespace bank_transfer_detail
+{
+struct bank_error_category : std::error_category {
+  [[nodiscard]] auto name() const noexcept -> const char* override
+  {
+    return "bank_error";
+  }
+
+  [[nodiscard]] auto message(int ev) const noexcept -> std::string override
+  {
+    switch (static_cast<bank_error>(ev)) {
+      case insufficient_funds:
+        return "insufficient_funds (1): not enough funds on the account";
+    }
+    return "unexpected error code in \"bank_error\" category, ev=" + std::to_string(ev);
+  }
+};
+} // namespace bank_transfer_detail
+
+inline auto
+bank_error_category_instance() noexcept -> const std::error_category&
+{
+  static const bank_transfer_detail::bank_error_category instance{};
+  return instance;
+}
+
+template<>
+struct std::is_error_code_enum<bank_error> : std::true_type {
+};
+
+inline auto
+make_error_code(bank_error e) -> std::error_code
+{
+  return { static_cast<int>(e), bank_error_category_instance() };
+}
+
+struct bank_account {
+  std::string name;
+  std::int64_t balance;
+};
+
+template<>
+struct tao::json::traits<bank_account> {
+  template<template<typename...> class Traits>
+  static void assign(tao::json::basic_value<Traits>& v, const bank_account& p)
+  {
+    v = {
+      { "name", p.name },
+      { "balance", p.balance },
+    };
+  }
+
+  template<template<typename...> class Traits>
+  static bank_account as(const tao::json::basic_value<Traits>& v)
+  {
+    bank_account result;
+    const auto& object = v.get_object();
+    result.name = object.at("name").template as<std::string>();
+    result.balance = object.at("balance").template as<std::int64_t>();
+    return result;
+  }
+};
+
+struct transfer_outcome {
+  couchbase::error error{};
+  std::size_t attempts{ 0 };
+};
+
+using transfer_handler = std::function<void(transfer_outcome)>;
+
+namespace bank_transfer_detail
+{
+// Shared by all attempts of one transfer.
+struct transfer_state {
+  std::atomic_size_t attempts{ 0 };
+  std::atomic_bool insufficient_funds{ false };
+};
+
+// The two reads of one attempt; the second to complete stages the writes.
+struct attempt_reads {
+  std::mutex mutex{};
+  std::optional<couchbase::transactions::transaction_get_result> from{};
+  std::optional<couchbase::transactions::transaction_get_result> to{};
+  std::size_t pending{ 2 };
+  bool failed{ false };
+};
+
+inline void
+stage_transfer(const std::shared_ptr<couchbase::transactions::async_attempt_context>& ctx,
+               const couchbase::transactions::transaction_get_result& from,
+               const couchbase::transactions::transaction_get_result& to,
+               std::int64_t amount,
+               transfer_state& state)
+{
+  auto from_account = from.content_as<bank_account>();
+  auto to_account = to.content_as<bank_account>();
+  if (from_account.balance < amount) {
+    state.insufficient_funds = true;
+    return;
+  }
+  from_account.balance -= amount;
+  to_account.balance += amount;
+  // A failed replace fails the attempt by itself; there is nothing left to do here.
+  ctx->replace(from, std::move(from_account), [](auto /* err */, auto /* res */) {
+  });
+  ctx->replace(to, std::move(to_account), [](auto /* err */, auto /* res */) {
+  });
+}
+} // namespace bank_transfer_detail
+
+inline void
+submit_transfer(transaction_executor& executor,
+                const couchbase::collection& collection,
+                std::string from_id,
+                std::string to_id,
+                std::int64_t amount,
+                transfer_handler&& handler)
+{
+  using couchbase::transactions::transaction_get_result;
+  auto state = std::make_shared<bank_transfer_detail::transfer_state>();
+
+  executor.submit(
+    [collection, from_id = std::move(from_id), to_id = std::move(to_id), amount, state](
+      std::shared_ptr<couchbase::transactions::async_attempt_context> ctx) -> couchbase::error {
+      ++state->attempts;
+      state->insufficient_funds = false;
+      auto reads = std::make_shared<bank_transfer_detail::attempt_reads>();
+      auto on_read = [ctx, reads, amount, state](
+                       bool is_from, const couchbase::error& err, transaction_get_result doc) {
+        {
+          const std::scoped_lock lock(reads->mutex);
+          if (err.ec()) {
+            reads->failed = true; // the SDK fails the attempt
+          } else {
+            (is_from ? reads->from : reads->to).emplace(std::move(doc));
+          }
+          if (--reads->pending > 0 || reads->failed) {
+            return;
+          }
+        }
+        bank_transfer_detail::stage_transfer(ctx, *reads->from, *reads->to, amount, *state);
+      };
+      ctx->get(collection, from_id, [on_read](auto err, auto doc) {
+        on_read(true, err, std::move(doc));
+      });
+      ctx->get(collection, to_id, [on_read](auto err, auto doc) {
+        on_read(false, err, std::move(doc));
+      });
+      return {};
+    },
+    [state, handler = std::move(handler)](auto err, auto /* result */) {
+      if (!err.ec() && state->insufficient_funds) {
+        err = couchbase::error{ bank_error::insufficient_funds, "not enough funds on the account" };
+      }
+      handler({ std::move(err), state->attempts.load() });
+    });
+}
+
+inline auto
+submit_transfer(transaction_executor& executor,
+                const couchbase::collection& collection,
+                std::string from_id,
+                std::string to_id,
+                std::int64_t amount) -> std::future<transfer_outcome>
+{
+  auto barrier = std::make_shared<std::promise<transfer_outcome>>();
+  auto future = barrier->get_future();
+  submit_transfer(
+    executor, collection, std::move(from_id), std::move(to_id), amount, [barrier](auto outcome) {
+      barrier->set_value(std::move(outcome));
+    });
+  return future;
+}
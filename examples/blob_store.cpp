@@ -0,0 +1,407 @@
+/*
+ * blob_store — uploads, downloads and range-reads an object larger than a document
+ *
+ * Stores INPUT_FILE (or, without it, a generated object of BLOB_SIZE bytes) under
+ * BLOB_ID with the chunked blob_store from blob_store.hxx, then:
+ *
+ *   - downloads the whole object again, checksumming it on the fly instead of keeping
+ *     it, and compares the result with the source;
+ *   - reads RANGE_READS random ranges of RANGE_SIZE bytes and compares every one of
+ *     them with the same bytes of the source.
+ *
+ * It prints the throughput of the upload and of the download, and the latency of the
+ * range reads.  Only WINDOW chunks of CHUNK_SIZE bytes are held in memory at a time by
+ * the store (the generated object itself is kept in memory to verify the reads against).
+ * The object is removed at the end unless KEEP_BLOB is set.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   BLOB_ID       ID of the object's manifest (default: "blob::example")
+ *   INPUT_FILE    file to upload
+ *   BLOB_SIZE     size of the generated object in bytes (default: 67108864)
+ *   CHUNK_SIZE    bytes per chunk document (default: 1048576)
+ *   WINDOW        chunk operations in flight (default: 16)
+ *   RANGE_READS   random range reads (default: 100)
+ *   RANGE_SIZE    bytes per range read (default: 65536)
+ *   KEEP_BLOB     do not remove the object at the end (default: false)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/logger.hxx>
+
+#include "blob_store.hxx"
+#include "crc32.hxx"
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::string blob_id{ "blob::example" };
+  std::optional<std::string> input_file{};
+  std::size_t blob_size{ 64 * 1024 * 1024 };
+  std::size_t chunk_size{ 1024 * 1024 };
+  std::size_t window{ 16 };
+  std::size_t range_reads{ 100 };
+  std::size_t range_size{ 65536 };
+  bool keep_blob{ false };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+// An output stream buffer that only counts and checksums what is written to it.
+class crc32_streambuf : public std::streambuf
+{
+public:
+  [[nodiscard]] auto checksum() const -> std::uint32_t
+  {
+    return crc_;
+  }
+
+  [[nodiscard]] auto size() const -> std::uint64_t
+  {
+    return size_;
+  }
+
+protected:
+  auto xsputn(const char* data, std::streamsize count) -> std::streamsize override
+  {
+    crc_ = crc32(data, static_cast<std::size_t>(count), crc_);
+    size_ += static_cast<std::uint64_t>(count);
+    return count;
+  }
+
+  auto overflow(int_type ch) -> int_type override
+  {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      const auto c = traits_type::to_char_type(ch);
+      xsputn(&c, 1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+private:
+  std::uint32_t crc_{ 0 };
+  std::uint64_t size_{ 0 };
+};
+
+// The object being stored: a file, or bytes generated in memory.
+class blob_source
+{
+public:
+  explicit blob_source(const program_config& config)
+  {
+    if (config.input_file) {
+      from_file_ = true;
+      file_.open(*config.input_file, std::ios::binary);
+      file_.seekg(0, std::ios::end);
+      size_ = static_cast<std::uint64_t>(file_.tellg());
+      file_.seekg(0);
+      return;
+    }
+    generated_.resize(config.blob_size);
+    std::mt19937_64 engine{ 42 };
+    for (std::size_t i = 0; i < generated_.size(); i += sizeof(std::uint64_t)) {
+      const auto word = engine();
+      std::memcpy(generated_.data() + i, &word, std::min(sizeof(word), generated_.size() - i));
+    }
+    size_ = generated_.size();
+  }
+
+  [[nodiscard]] auto valid() const -> bool
+  {
+    return !from_file_ || static_cast<bool>(file_);
+  }
+
+  [[nodiscard]] auto size() const -> std::uint64_t
+  {
+    return size_;
+  }
+
+  auto put(const blob_store& store, const std::string& id) -> couchbase::error
+  {
+    if (!from_file_) {
+      return store.put(id, generated_.data(), generated_.size());
+    }
+    file_.clear();
+    file_.seekg(0);
+    return store.put(id, file_);
+  }
+
+  auto read(std::uint64_t offset, std::uint64_t length) -> std::vector<std::byte>
+  {
+    length = std::min(length, size_ - std::min(offset, size_));
+    std::vector<std::byte> bytes(static_cast<std::size_t>(length));
+    if (!from_file_) {
+      std::copy_n(generated_.begin() + static_cast<std::ptrdiff_t>(offset),
+                  bytes.size(),
+                  bytes.begin());
+    } else {
+      file_.clear();
+      file_.seekg(static_cast<std::streamoff>(offset));
+      file_.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(length));
+    }
+    return bytes;
+  }
+
+  auto checksum() -> std::uint32_t
+  {
+    std::uint32_t crc{ 0 };
+    for (std::uint64_t offset = 0; offset < size_; offset += 1024 * 1024) {
+      const auto bytes = read(offset, 1024 * 1024);
+      crc = crc32(bytes.data(), bytes.size(), crc);
+    }
+    return crc;
+  }
+
+private:
+  bool from_file_{ false };
+  std::ifstream file_{};
+  std::vector<std::byte> generated_{};
+  std::uint64_t size_{ 0 };
+};
+
+auto
+megabytes_per_second(std::uint64_t bytes, std::chrono::steady_clock::duration elapsed) -> double
+{
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  return seconds > 0 ? static_cast<double>(bytes) / (1024 * 1024) / seconds : 0.0;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  blob_source source{ config };
+  if (!source.valid()) {
+    std::cout << "Unable to open " << program_config::quote(*config.input_file) << "\n";
+    cluster.close().get();
+    return EXIT_FAILURE;
+  }
+
+  blob_store_options store_options{};
+  store_options.chunk_size = config.chunk_size;
+  store_options.window = config.window;
+  const blob_store store{ collection, store_options };
+
+  std::cout << std::fixed << std::setprecision(1);
+  {
+    const auto start = std::chrono::steady_clock::now();
+    if (auto err = source.put(store, config.blob_id); err.ec()) {
+      std::cout << "PUT failed: " << err.message() << "\n";
+      cluster.close().get();
+      return EXIT_FAILURE;
+    }
+    std::cout << "PUT " << source.size() << " bytes: "
+              << megabytes_per_second(source.size(), std::chrono::steady_clock::now() - start)
+              << " MiB/s\n";
+  }
+  if (auto [err, manifest] = store.stat(config.blob_id); !err.ec()) {
+    std::cout << "  " << manifest.chunk_count() << " chunks of " << manifest.chunk_size
+              << " bytes, generation " << manifest.generation << "\n";
+  }
+
+  bool verified{ true };
+  {
+    crc32_streambuf checksum;
+    std::ostream sink{ &checksum };
+    const auto start = std::chrono::steady_clock::now();
+    const auto err = store.get(config.blob_id, sink);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (err.ec()) {
+      std::cout << "GET failed: " << err.message() << "\n";
+      verified = false;
+    } else {
+      const bool match =
+        checksum.size() == source.size() && checksum.checksum() == source.checksum();
+      std::cout << "GET " << checksum.size() << " bytes: "
+                << megabytes_per_second(checksum.size(), elapsed) << " MiB/s, "
+                << (match ? "matches the source" : "DIFFERS from the source") << "\n";
+      verified = verified && match;
+    }
+  }
+
+  if (config.range_reads > 0 && source.size() > 0) {
+    std::mt19937_64 engine{ 7 };
+    std::uniform_int_distribution<std::uint64_t> pick{ 0, source.size() - 1 };
+    latency_histogram latency{};
+    std::size_t failed{ 0 };
+    std::size_t mismatched{ 0 };
+    for (std::size_t i = 0; i < config.range_reads; ++i) {
+      const auto offset = pick(engine);
+      const auto start = std::chrono::steady_clock::now();
+      auto [err, bytes] = store.get_range(config.blob_id, offset, config.range_size);
+      latency.record(std::chrono::steady_clock::now() - start);
+      if (err.ec()) {
+        ++failed;
+        continue;
+      }
+      if (bytes != source.read(offset, config.range_size)) {
+        ++mismatched;
+      }
+    }
+    std::cout << "RANGE " << config.range_reads << " x " << config.range_size
+              << " bytes, latency us: p50 " << to_micros(latency.value_at_percentile(50))
+              << ", p99 " << to_micros(latency.value_at_percentile(99)) << ", max "
+              << to_micros(latency.max()) << " (" << failed << " failed, " << mismatched
+              << " mismatched)\n";
+    verified = verified && failed == 0 && mismatched == 0;
+  }
+
+  if (!config.keep_blob) {
+    if (auto err = store.remove(config.blob_id); err.ec()) {
+      std::cout << "REMOVE failed: " << err.message() << "\n";
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return verified ? 0 : EXIT_FAILURE;
+}
+
+auto
+parse_truthy(const char* val) -> bool
+{
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  for (const auto& truth : truthy_values) {
+    if (val == truth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("BLOB_ID"); val != nullptr) {
+    config.blob_id = val;
+  }
+  if (const auto* val = getenv("INPUT_FILE"); val != nullptr) {
+    config.input_file = val;
+  }
+  if (const auto* val = getenv("BLOB_SIZE"); val != nullptr) {
+    config.blob_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("CHUNK_SIZE"); val != nullptr) {
+    config.chunk_size = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("WINDOW"); val != nullptr) {
+    config.window = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("RANGE_READS"); val != nullptr) {
+    config.range_reads = std::stoul(val);
+  }
+  if (const auto* val = getenv("RANGE_SIZE"); val != nullptr) {
+    config.range_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("KEEP_BLOB"); val != nullptr) {
+    config.keep_blob = parse_truthy(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    config.verbose = parse_truthy(val);
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "            BLOB_ID: " << quote(blob_id) << "\n";
+  std::cout << "         INPUT_FILE: " << (input_file ? quote(*input_file) : "[NONE]") << "\n";
+  std::cout << "          BLOB_SIZE: " << blob_size << "\n";
+  std::cout << "         CHUNK_SIZE: " << chunk_size << "\n";
+  std::cout << "             WINDOW: " << window << "\n";
+  std::cout << "        RANGE_READS: " << range_reads << "\n";
+  std::cout << "         RANGE_SIZE: " << range_size << "\n";
+  std::cout << "          KEEP_BLOB: " << std::boolalpha << keep_blob << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
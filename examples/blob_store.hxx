@@ -0,0 +1,459 @@
+/*
+ * blob_store — binary objects larger than a document, stored as chunks plus a manifest
+ *
+ * minimal_with_char_array.cpp stores bytes as one document through
+ * raw_binary_transcoder, which caps an object at the server's document size limit
+ * (20 MiB) and needs all of it in memory.  blob_store splits an object into chunks of
+ * `chunk_size` bytes, each its own binary document, and describes them in a JSON
+ * manifest stored under the object's ID:
+ *
+ *   <id>                                 {"size", "chunk_size", "generation", "crc32"}
+ *   <id>::chunk::<generation>::<index>   bytes [index * chunk_size, ...) of the object
+ *
+ * put() reads the object from a stream (or a buffer) one chunk at a time and keeps up to
+ * `window` chunk upserts in flight, so memory stays at about window * chunk_size however
+ * large the object is, and a single put() can fill the link: the chunks hash to
+ * different vBuckets and therefore spread over all nodes.  The manifest, with the
+ * CRC-32 of every chunk, is written only after all chunks are stored, with a CAS check,
+ * so readers see either the old object or the new one, never a mix.  Every put() writes
+ * its chunks under a fresh random generation and removes the chunks of the object it
+ * replaced afterwards.  A put() that fails removes the chunks it wrote.
+ *
+ * get() streams the object into an std::ostream and get_range() returns any byte range
+ * of it; both keep up to `window` chunk gets in flight, hand the chunks over in order
+ * and verify the size and CRC-32 of each chunk before using it (a mismatch fails the
+ * read with decoding_failure).  A range read fetches only the chunks it overlaps.
+ *
+ * A read that runs while the object is replaced may find the old chunks already removed
+ * and fail with document_not_found; reading again picks up the new manifest.  All
+ * members block the calling thread, so they must not be called from an SDK completion
+ * handler.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/codec_flags.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+#include <couchbase/codec/raw_json_transcoder.hxx>
+
+#include <tao/json.hpp>
+
+#include "crc32.hxx"
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct blob_store_options {
+  std::size_t chunk_size{ 1024 * 1024 };
+  std::size_t window{ 16 }; // chunk operations in flight
+  std::optional<std::chrono::milliseconds> timeout{}; // of every chunk operation
+};
+
+struct blob_manifest {
+  std::uint64_t size{ 0 };
+  std::uint64_t chunk_size{ 0 };
+  std::string generation{};
+  std::vector<std::uint32_t> checksums{}; // CRC-32 of every chunk
+  couchbase::cas cas{};
+
+  [[nodiscard]] auto chunk_count() const -> std::size_t
+  {
+    return checksums.size();
+  }
+};
+
+class blob_store
+{
+public:
+  explicit blob_store(couchbase::collection collection, blob_store_options options = {})
+    : collection_{ std::move(collection) }
+    , options_{ options }
+  {
+    options_.chunk_size = std::max<std::size_t>(options_.chunk_size, 1);
+    options_.window = std::max<std::size_t>(options_.window, 1);
+  }
+
+  // Stores everything `source` yields until its end under `id`.
+  auto put(const std::string& id, std::istream& source) const -> couchbase::error
+  {
+    return put_chunks(id, [&source](couchbase::codec::binary& chunk) -> bool {
+      source.read(reinterpret_cast<char*>(chunk.data()),
+                  static_cast<std::streamsize>(chunk.size()));
+      chunk.resize(static_cast<std::size_t>(source.gcount()));
+      return !source.bad();
+    });
+  }
+
+  auto put(const std::string& id, const void* data, std::size_t size) const -> couchbase::error
+  {
+    const auto* bytes = static_cast<const std::byte*>(data);
+    std::size_t offset{ 0 };
+    return put_chunks(id, [&](couchbase::codec::binary& chunk) -> bool {
+      const auto length = std::min(chunk.size(), size - offset);
+      std::copy_n(bytes + offset, length, chunk.begin());
+      chunk.resize(length);
+      offset += length;
+      return true;
+    });
+  }
+
+  [[nodiscard]] auto stat(const std::string& id) const
+    -> std::pair<couchbase::error, blob_manifest>
+  {
+    auto [err, resp] = collection_.get(id).get();
+    if (err.ec()) {
+      return { err, {} };
+    }
+    auto manifest = decode_manifest(resp.content_as<couchbase::codec::raw_json_transcoder>());
+    if (!manifest) {
+      return { couchbase::error{ couchbase::errc::common::decoding_failure,
+                                 "blob_store: \"" + id + "\" is not a blob manifest" },
+               {} };
+    }
+    manifest->cas = resp.cas();
+    return { {}, std::move(manifest.value()) };
+  }
+
+  // Writes the whole object to `sink`.  On failure, part of it may have been written.
+  auto get(const std::string& id, std::ostream& sink) const -> couchbase::error
+  {
+    auto [err, manifest] = stat(id);
+    if (err.ec()) {
+      return err;
+    }
+    const auto write = [&sink](std::size_t, const couchbase::codec::binary& chunk) -> bool {
+      sink.write(reinterpret_cast<const char*>(chunk.data()),
+                 static_cast<std::streamsize>(chunk.size()));
+      return static_cast<bool>(sink);
+    };
+    return fetch_chunks(id, manifest, 0, manifest.chunk_count(), write);
+  }
+
+  // Returns `length` bytes from `offset`, fewer if the object ends first.
+  [[nodiscard]] auto get_range(const std::string& id,
+                               std::uint64_t offset,
+                               std::uint64_t length) const
+    -> std::pair<couchbase::error, std::vector<std::byte>>
+  {
+    auto [err, manifest] = stat(id);
+    if (err.ec()) {
+      return { err, {} };
+    }
+    if (offset > manifest.size) {
+      return { couchbase::error{ couchbase::errc::common::invalid_argument,
+                                 "blob_store: offset beyond the end of \"" + id + "\"" },
+               {} };
+    }
+    length = std::min(length, manifest.size - offset);
+    std::vector<std::byte> range;
+    if (length == 0) {
+      return { {}, std::move(range) };
+    }
+    range.reserve(static_cast<std::size_t>(length));
+    const auto end = offset + length;
+    const auto first = static_cast<std::size_t>(offset / manifest.chunk_size);
+    const auto last = static_cast<std::size_t>((end - 1) / manifest.chunk_size) + 1;
+    const auto chunk_size = manifest.chunk_size;
+    const auto copy = [&range, offset, end, chunk_size](std::size_t index,
+                                                        const couchbase::codec::binary& chunk) {
+      const auto start = index * chunk_size;
+      const auto from = std::max(offset, start) - start;
+      const auto to = std::min(end, start + chunk.size()) - start;
+      range.insert(range.end(),
+                   chunk.begin() + static_cast<std::ptrdiff_t>(from),
+                   chunk.begin() + static_cast<std::ptrdiff_t>(to));
+      return true;
+    };
+    if (auto fetch_err = fetch_chunks(id, manifest, first, last, copy); fetch_err.ec()) {
+      return { fetch_err, {} };
+    }
+    return { {}, std::move(range) };
+  }
+
+  auto remove(const std::string& id) const -> couchbase::error
+  {
+    auto [err, manifest] = stat(id);
+    if (err.ec()) {
+      return err;
+    }
+    // The manifest goes first, so that no reader starts on chunks about to disappear.
+    auto [remove_err, resp] =
+      collection_.remove(id, couchbase::remove_options{}.cas(manifest.cas)).get();
+    if (remove_err.ec()) {
+      return remove_err;
+    }
+    return remove_chunks(id, manifest.generation, manifest.chunk_count());
+  }
+
+private:
+  static auto chunk_id(const std::string& id, const std::string& generation, std::size_t index)
+    -> std::string
+  {
+    return id + "::chunk::" + generation + "::" + std::to_string(index);
+  }
+
+  static auto new_generation() -> std::string
+  {
+    thread_local std::mt19937_64 engine{ std::random_device{}() };
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << engine();
+    return out.str();
+  }
+
+  static auto encode_manifest(const blob_manifest& manifest) -> std::string
+  {
+    tao::json::value checksums = tao::json::empty_array;
+    for (const auto checksum : manifest.checksums) {
+      checksums.emplace_back(checksum);
+    }
+    return tao::json::to_string(tao::json::value{
+      { "size", manifest.size },
+      { "chunk_size", manifest.chunk_size },
+      { "generation", manifest.generation },
+      { "crc32", checksums },
+    });
+  }
+
+  static auto decode_manifest(const std::string& text) -> std::optional<blob_manifest>
+  {
+    try {
+      const auto value = tao::json::from_string(text);
+      blob_manifest manifest{};
+      manifest.size = value.at("size").as<std::uint64_t>();
+      manifest.chunk_size = value.at("chunk_size").as<std::uint64_t>();
+      manifest.generation = value.at("generation").get_string();
+      for (const auto& checksum : value.at("crc32").get_array()) {
+        manifest.checksums.push_back(checksum.as<std::uint32_t>());
+      }
+      const auto chunks = manifest.chunk_size == 0
+                            ? 0
+                            : (manifest.size + manifest.chunk_size - 1) / manifest.chunk_size;
+      if (manifest.chunk_size == 0 || manifest.chunk_count() != chunks) {
+        return {};
+      }
+      return manifest;
+    } catch (const std::exception&) {
+      return {};
+    }
+  }
+
+  // `read` fills the chunk it is given and shrinks it to the bytes it read; an empty
+  // chunk ends the object.  It returns false if the source failed.
+  auto put_chunks(const std::string& id,
+                  const std::function<bool(couchbase::codec::binary&)>& read) const
+    -> couchbase::error
+  {
+    blob_manifest manifest{};
+    manifest.chunk_size = options_.chunk_size;
+    manifest.generation = new_generation();
+
+    couchbase::upsert_options chunk_options{};
+    if (options_.timeout) {
+      chunk_options.timeout(options_.timeout.value());
+    }
+    std::mutex error_mutex;
+    couchbase::error first_error{};
+    const auto failed = [&]() -> bool {
+      const std::scoped_lock lock(error_mutex);
+      return static_cast<bool>(first_error.ec());
+    };
+
+    kv_multi_detail::window window{ options_.window };
+    while (!failed()) {
+      couchbase::codec::binary chunk(options_.chunk_size);
+      if (!read(chunk)) {
+        const std::scoped_lock lock(error_mutex);
+        first_error = couchbase::error{ couchbase::errc::common::invalid_argument,
+                                        "blob_store: unable to read the source of \"" + id +
+                                          "\"" };
+        break;
+      }
+      if (chunk.empty()) {
+        break;
+      }
+      manifest.checksums.push_back(crc32(chunk.data(), chunk.size()));
+      manifest.size += chunk.size();
+      window.acquire();
+      collection_.upsert(
+        chunk_id(id, manifest.generation, manifest.chunk_count() - 1),
+        couchbase::codec::encoded_value{ std::move(chunk),
+                                         couchbase::codec::codec_flags::binary_common_flags },
+        chunk_options,
+        [&](auto err, auto) {
+          if (err.ec()) {
+            const std::scoped_lock lock(error_mutex);
+            if (!first_error.ec()) {
+              first_error = err;
+            }
+          }
+          window.release();
+        });
+    }
+    window.drain();
+    if (first_error.ec()) {
+      remove_chunks(id, manifest.generation, manifest.chunk_count());
+      return first_error;
+    }
+
+    // Publish the manifest, replacing whatever manifest is current at that moment.
+    const auto encoded = encode_manifest(manifest);
+    for (;;) {
+      auto [stat_err, previous] = stat(id);
+      if (stat_err.ec() && stat_err.ec() != couchbase::errc::key_value::document_not_found) {
+        remove_chunks(id, manifest.generation, manifest.chunk_count());
+        return stat_err;
+      }
+      const bool exists = stat_err.ec() != couchbase::errc::key_value::document_not_found;
+      auto [write_err, resp] =
+        exists
+          ? collection_
+              .replace<couchbase::codec::raw_json_transcoder>(
+                id, encoded, couchbase::replace_options{}.cas(previous.cas))
+              .get()
+          : collection_.insert<couchbase::codec::raw_json_transcoder>(id, encoded).get();
+      if (write_err.ec() == couchbase::errc::common::cas_mismatch ||
+          write_err.ec() == couchbase::errc::key_value::document_exists ||
+          write_err.ec() == couchbase::errc::key_value::document_not_found) {
+        continue; // another put() or remove() got there first
+      }
+      if (write_err.ec()) {
+        remove_chunks(id, manifest.generation, manifest.chunk_count());
+        return write_err;
+      }
+      if (!previous.generation.empty()) {
+        remove_chunks(id, previous.generation, previous.chunk_count());
+      }
+      return {};
+    }
+  }
+
+  // Passes chunks [first, last) of the object to `consume` in order, after checking
+  // them; `consume` returns false to fail the read.
+  auto fetch_chunks(
+    const std::string& id,
+    const blob_manifest& manifest,
+    std::size_t first,
+    std::size_t last,
+    const std::function<bool(std::size_t, const couchbase::codec::binary&)>& consume) const
+    -> couchbase::error
+  {
+    struct fetched {
+      bool done{ false };
+      couchbase::error error{};
+      couchbase::codec::binary data{};
+    };
+
+    couchbase::get_options chunk_options{};
+    if (options_.timeout) {
+      chunk_options.timeout(options_.timeout.value());
+    }
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<fetched> slots(last - first);
+    std::size_t in_flight{ 0 };
+
+    couchbase::error result{};
+    auto next_dispatch = first;
+    for (auto next = first; next < last; ++next) {
+      for (; next_dispatch < last && next_dispatch < next + options_.window; ++next_dispatch) {
+        {
+          const std::scoped_lock lock(mutex);
+          ++in_flight;
+        }
+        auto* slot = &slots[next_dispatch - first];
+        collection_.get(chunk_id(id, manifest.generation, next_dispatch),
+                        chunk_options,
+                        [&, slot](auto err, auto resp) {
+                          auto data = err.ec()
+                                        ? couchbase::codec::binary{}
+                                        : resp.template content_as<
+                                            couchbase::codec::raw_binary_transcoder>();
+                          // Notify while holding the mutex: the waiter returns, destroying
+                          // the condition variable, as soon as it sees the last chunk.
+                          const std::scoped_lock lock(mutex);
+                          slot->error = std::move(err);
+                          slot->data = std::move(data);
+                          slot->done = true;
+                          --in_flight;
+                          cv.notify_all();
+                        });
+      }
+
+      fetched chunk{};
+      {
+        std::unique_lock lock(mutex);
+        auto& slot = slots[next - first];
+        cv.wait(lock, [&slot] {
+          return slot.done;
+        });
+        chunk = std::move(slot);
+      }
+      if (chunk.error.ec()) {
+        result = chunk.error;
+        break;
+      }
+      const auto expected_size =
+        std::min<std::uint64_t>(manifest.chunk_size, manifest.size - next * manifest.chunk_size);
+      if (chunk.data.size() != expected_size ||
+          crc32(chunk.data.data(), chunk.data.size()) != manifest.checksums[next]) {
+        result = couchbase::error{ couchbase::errc::common::decoding_failure,
+                                   "blob_store: checksum mismatch in chunk " +
+                                     std::to_string(next) + " of \"" + id + "\"" };
+        break;
+      }
+      if (!consume(next, chunk.data)) {
+        result = couchbase::error{ couchbase::errc::common::invalid_argument,
+                                   "blob_store: unable to write \"" + id + "\"" };
+        break;
+      }
+    }
+
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&in_flight] {
+      return in_flight == 0;
+    });
+    return result;
+  }
+
+  // Best effort: chunks that are already gone do not count as failures.
+  auto remove_chunks(const std::string& id,
+                     const std::string& generation,
+                     std::size_t count) const -> couchbase::error
+  {
+    std::mutex error_mutex;
+    couchbase::error first_error{};
+    kv_multi_detail::window window{ options_.window };
+    for (std::size_t index = 0; index < count; ++index) {
+      window.acquire();
+      collection_.remove(chunk_id(id, generation, index), {}, [&](auto err, auto) {
+        if (err.ec() && err.ec() != couchbase::errc::key_value::document_not_found) {
+          const std::scoped_lock lock(error_mutex);
+          if (!first_error.ec()) {
+            first_error = err;
+          }
+        }
+        window.release();
+      });
+    }
+    window.drain();
+    return first_error;
+  }
+
+  couchbase::collection collection_;
+  blob_store_options options_;
+};
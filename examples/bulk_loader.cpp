@@ -0,0 +1,580 @@
+/*
+ * bulk_loader — seeds a collection from a JSONL or CSV file
+ *
+ * The input file is memory-mapped read-only and cut into NUM_THREADS byte ranges,
+ * each moved forward to the next line break, so every thread splits its own share of
+ * the file into records in parallel.  Records are std::string_views into the mapping:
+ * nothing is copied until a record is encoded for the wire.
+ *
+ * Each thread upserts its records through the callback API with up to WINDOW
+ * operations in flight, so a single client host keeps NUM_THREADS * WINDOW requests
+ * outstanding and is limited by the network rather than by round trips.  Memory stays
+ * bounded by the window: only encoded in-flight documents are held in addition to the
+ * mapping, whose pages the kernel reads ahead and evicts on its own.
+ *
+ * Formats (INPUT_FORMAT, defaults to the file extension):
+ *   jsonl  one JSON document per line.  With TRANSCODER=raw_json (the default) the
+ *          line is sent as-is through raw_json_transcoder: it is copied from the
+ *          mapping into the encoded value, and the SDK copies that once more into its
+ *          request buffer (see external_bytes.hxx).  TRANSCODER=json parses and
+ *          re-encodes it with the default JSON transcoder, which rejects malformed
+ *          lines up front.
+ *   csv    the first line names the columns; every further line becomes a JSON object
+ *          with one field per column (numeric cells become numbers).  Quoted cells
+ *          with embedded commas and doubled quotes are supported, embedded line breaks
+ *          are not.
+ *
+ * Document IDs are KEY_PREFIX followed by the value of ID_FIELD.  When ID_FIELD is
+ * not set, or a record does not have it, the record's byte offset in the file is used
+ * instead, which is stable across runs and thread counts.  For JSONL the ID is found
+ * with a plain text scan for the first "ID_FIELD": key, so it should be a top-level
+ * string or number field.
+ *
+ * Without INPUT_FILE the loader writes a synthetic JSONL file of NUM_DOCUMENTS records
+ * of about DOCUMENT_SIZE bytes to the temporary directory, loads it and removes it.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   INPUT_FILE       path of the file to load
+ *   INPUT_FORMAT     jsonl or csv
+ *   TRANSCODER       raw_json or json (default: raw_json)
+ *   ID_FIELD         field or column holding the document ID
+ *   KEY_PREFIX       prepended to every document ID (default: "")
+ *   NUM_THREADS      parsing/dispatching threads (default: 4)
+ *   WINDOW           operations in flight per thread (default: 256)
+ *   NUM_DOCUMENTS    synthetic input: number of records (default: 10000)
+ *   DOCUMENT_SIZE    synthetic input: approximate record size (default: 512)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_json_transcoder.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "mapped_file.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+enum class input_format {
+  jsonl,
+  csv,
+};
+
+enum class transcoder_kind {
+  raw_json,
+  json,
+};
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::optional<std::string> input_file{}; // synthetic JSONL when not set
+  std::optional<input_format> format{};    // from the file extension when not set
+  transcoder_kind transcoder{ transcoder_kind::raw_json };
+  std::optional<std::string> id_field{};
+  std::string key_prefix{};
+  std::size_t num_threads{ 4 };
+  std::size_t window{ 256 };
+  std::size_t num_documents{ 10'000 };
+  std::size_t document_size{ 512 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct load_counters {
+  std::atomic_uint64_t documents{ 0 };
+  std::atomic_uint64_t bytes{ 0 };
+  std::atomic_uint64_t errors{ 0 };
+  std::atomic_uint64_t skipped{ 0 };
+};
+
+// Cuts `contents` into `parts` ranges that start and end on line boundaries.
+auto
+split_on_lines(std::string_view contents, std::size_t parts) -> std::vector<std::string_view>
+{
+  std::vector<std::string_view> ranges;
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i <= parts && begin < contents.size(); ++i) {
+    std::size_t end = i == parts ? contents.size() : contents.size() / parts * i;
+    if (end <= begin) {
+      continue;
+    }
+    if (end < contents.size()) {
+      const auto newline = contents.find('\n', end);
+      end = newline == std::string_view::npos ? contents.size() : newline + 1;
+    }
+    ranges.push_back(contents.substr(begin, end - begin));
+    begin = end;
+  }
+  return ranges;
+}
+
+auto
+trim_line(std::string_view line) -> std::string_view
+{
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+// Returns the value of the first `"field":` in `record`, without unescaping.
+auto
+find_json_field(std::string_view record, const std::string& field)
+  -> std::optional<std::string_view>
+{
+  const std::string key = "\"" + field + "\"";
+  for (auto pos = record.find(key); pos != std::string_view::npos;
+       pos = record.find(key, pos + 1)) {
+    auto rest = record.substr(pos + key.size());
+    const auto colon = rest.find_first_not_of(" \t");
+    if (colon == std::string_view::npos || rest[colon] != ':') {
+      continue;
+    }
+    rest = rest.substr(colon + 1);
+    const auto start = rest.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+      return {};
+    }
+    rest = rest.substr(start);
+    if (rest.front() == '"') {
+      const auto end = rest.find('"', 1);
+      return end == std::string_view::npos ? std::optional<std::string_view>{}
+                                           : rest.substr(1, end - 1);
+    }
+    return rest.substr(0, std::min(rest.find_first_of(",} \t"), rest.size()));
+  }
+  return {};
+}
+
+auto
+split_csv_line(std::string_view line) -> std::vector<std::string>
+{
+  std::vector<std::string> cells(1);
+  bool quoted = false;
+  for (std::size_t i = 0; i < line.size(); ++i) {
+    const char c = line[i];
+    if (quoted) {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+        cells.back().push_back('"');
+        ++i;
+      } else if (c == '"') {
+        quoted = false;
+      } else {
+        cells.back().push_back(c);
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      cells.emplace_back();
+    } else {
+      cells.back().push_back(c);
+    }
+  }
+  return cells;
+}
+
+auto
+csv_cell_to_json(const std::string& cell) -> tao::json::value
+{
+  if (!cell.empty()) {
+    char* end = nullptr;
+    const double number = std::strtod(cell.c_str(), &end);
+    if (end == cell.c_str() + cell.size()) {
+      return number;
+    }
+  }
+  return cell;
+}
+
+class record_loader
+{
+public:
+  record_loader(const couchbase::collection& collection,
+                const program_config& config,
+                std::string_view file,
+                load_counters& counters)
+    : collection_{ collection }
+    , config_{ config }
+    , file_{ file }
+    , counters_{ counters }
+  {
+  }
+
+  void load_jsonl(std::string_view range)
+  {
+    for_each_line(range, [this](std::string_view line) {
+      std::optional<std::string_view> id;
+      if (config_.id_field) {
+        id = find_json_field(line, *config_.id_field);
+      }
+      if (config_.transcoder == transcoder_kind::raw_json) {
+        // Copied from the mapping into the encoded value, which raw_json_transcoder takes
+        // over as it is; the SDK copies it again into its request buffer.
+        dispatch(
+          make_id(id, line),
+          couchbase::codec::raw_json_transcoder::encode(couchbase::codec::binary{
+            reinterpret_cast<const std::byte*>(line.data()),
+            reinterpret_cast<const std::byte*>(line.data() + line.size()) }),
+          line.size());
+        return;
+      }
+      tao::json::value document;
+      try {
+        document = tao::json::from_string(line);
+      } catch (const std::exception&) {
+        ++counters_.skipped;
+        return;
+      }
+      dispatch(make_id(id, line),
+               couchbase::codec::default_json_transcoder::encode(document),
+               line.size());
+    });
+  }
+
+  void load_csv(std::string_view range, const std::vector<std::string>& columns)
+  {
+    std::optional<std::size_t> id_column;
+    if (config_.id_field) {
+      if (auto it = std::find(columns.begin(), columns.end(), *config_.id_field);
+          it != columns.end()) {
+        id_column = static_cast<std::size_t>(std::distance(columns.begin(), it));
+      }
+    }
+    for_each_line(range, [&](std::string_view line) {
+      const auto cells = split_csv_line(line);
+      tao::json::value document = tao::json::empty_object;
+      for (std::size_t i = 0; i < columns.size() && i < cells.size(); ++i) {
+        document[columns[i]] = csv_cell_to_json(cells[i]);
+      }
+      std::optional<std::string_view> id;
+      if (id_column && *id_column < cells.size() && !cells[*id_column].empty()) {
+        id = cells[*id_column];
+      }
+      if (config_.transcoder == transcoder_kind::raw_json) {
+        dispatch(make_id(id, line),
+                 couchbase::codec::raw_json_transcoder::encode(tao::json::to_string(document)),
+                 line.size());
+      } else {
+        dispatch(make_id(id, line),
+                 couchbase::codec::default_json_transcoder::encode(document),
+                 line.size());
+      }
+    });
+  }
+
+  // Blocks until every dispatched upsert has completed.
+  void drain()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return in_flight_ == 0;
+    });
+  }
+
+private:
+  template<typename Handler>
+  static void for_each_line(std::string_view range, Handler&& handler)
+  {
+    while (!range.empty()) {
+      const auto newline = range.find('\n');
+      const auto line = trim_line(range.substr(0, newline));
+      range.remove_prefix(newline == std::string_view::npos ? range.size() : newline + 1);
+      if (!line.empty()) {
+        handler(line);
+      }
+    }
+  }
+
+  auto make_id(std::optional<std::string_view> id, std::string_view line) const -> std::string
+  {
+    if (id) {
+      return config_.key_prefix + std::string(*id);
+    }
+    return config_.key_prefix + std::to_string(line.data() - file_.data());
+  }
+
+  void dispatch(std::string id, couchbase::codec::encoded_value document, std::size_t bytes)
+  {
+    {
+      std::unique_lock lock(mutex_);
+      cv_.wait(lock, [this] {
+        return in_flight_ < config_.window;
+      });
+      ++in_flight_;
+    }
+    collection_.upsert(std::move(id), std::move(document), {}, [this, bytes](auto err, auto) {
+      if (err.ec()) {
+        ++counters_.errors;
+      } else {
+        ++counters_.documents;
+        counters_.bytes += bytes;
+      }
+      // Notify under the lock: drain() returns, and the loader may be destroyed, as
+      // soon as the last completion is observed.
+      const std::scoped_lock lock(mutex_);
+      --in_flight_;
+      cv_.notify_all();
+    });
+  }
+
+  const couchbase::collection& collection_;
+  const program_config& config_;
+  std::string_view file_;
+  load_counters& counters_;
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::size_t in_flight_{ 0 };
+};
+
+auto
+write_synthetic_input(const program_config& config) -> std::string
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "bulk_loader_sample.jsonl").string();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  for (std::size_t i = 0; i < config.num_documents; ++i) {
+    std::string line = R"({"id":"bulk_loader::)" + std::to_string(i) + R"(","index":)" +
+                       std::to_string(i) + R"(,"payload":")";
+    const auto envelope = line.size() + 2;
+    line.append(config.document_size > envelope ? config.document_size - envelope : 0, 'x');
+    line += "\"}\n";
+    out << line;
+  }
+  return path;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+
+  bool synthetic_input = false;
+  if (!config.input_file) {
+    config.input_file = write_synthetic_input(config);
+    config.format = input_format::jsonl;
+    if (!config.id_field) {
+      config.id_field = "id";
+    }
+    synthetic_input = true;
+  }
+  if (!config.format) {
+    const auto extension = std::filesystem::path(*config.input_file).extension().string();
+    config.format = extension == ".csv" ? input_format::csv : input_format::jsonl;
+  }
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  const mapped_file input(*config.input_file);
+  if (input.error()) {
+    std::cout << "Unable to map " << program_config::quote(*config.input_file)
+              << ". ec: " << input.error().message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  auto body = input.contents();
+  std::vector<std::string> columns;
+  if (config.format == input_format::csv) {
+    const auto newline = body.find('\n');
+    columns = split_csv_line(trim_line(body.substr(0, newline)));
+    body.remove_prefix(newline == std::string_view::npos ? body.size() : newline + 1);
+  }
+
+  load_counters counters{};
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::future<void>> workers;
+  for (const auto range : split_on_lines(body, config.num_threads)) {
+    workers.emplace_back(std::async(std::launch::async, [&, range]() {
+      record_loader loader(collection, config, input.contents(), counters);
+      if (config.format == input_format::csv) {
+        loader.load_csv(range, columns);
+      } else {
+        loader.load_jsonl(range);
+      }
+      loader.drain();
+    }));
+  }
+
+  const auto report = [&](const char* label) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const auto documents = counters.documents.load();
+    const auto megabytes = static_cast<double>(counters.bytes.load()) / (1024.0 * 1024.0);
+    std::cout << label << std::fixed << std::setprecision(2) << elapsed.count() << "s: "
+              << documents << " documents, " << megabytes << " MB, "
+              << static_cast<double>(documents) / elapsed.count() << " docs/s, "
+              << megabytes / elapsed.count() << " MB/s, " << counters.errors.load()
+              << " errors, " << counters.skipped.load() << " skipped\n";
+  };
+  for (auto& worker : workers) {
+    while (worker.wait_for(std::chrono::seconds{ 1 }) == std::future_status::timeout) {
+      report("  ");
+    }
+  }
+  report("Loaded in ");
+
+  if (synthetic_input) {
+    std::error_code ignored;
+    std::filesystem::remove(*config.input_file, ignored);
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  if (counters.errors.load() > 0) {
+    return EXIT_FAILURE; // some documents were not written
+  }
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("INPUT_FILE"); val != nullptr) {
+    config.input_file = val;
+  }
+  if (const auto* val = getenv("INPUT_FORMAT"); val != nullptr) {
+    const std::string_view format{ val };
+    if (format == "csv") {
+      config.format = input_format::csv;
+    } else if (format == "jsonl") {
+      config.format = input_format::jsonl;
+    }
+  }
+  if (const auto* val = getenv("TRANSCODER"); val != nullptr) {
+    config.transcoder =
+      std::string_view{ val } == "json" ? transcoder_kind::json : transcoder_kind::raw_json;
+  }
+  if (const auto* val = getenv("ID_FIELD"); val != nullptr) {
+    config.id_field = val;
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("WINDOW"); val != nullptr) {
+    config.window = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::stoul(val);
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZE"); val != nullptr) {
+    config.document_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "         INPUT_FILE: " << (input_file ? quote(*input_file) : "[SYNTHETIC]")
+            << "\n";
+  std::cout << "       INPUT_FORMAT: "
+            << (!format ? "[FROM EXTENSION]" : format == input_format::csv ? "csv" : "jsonl")
+            << "\n";
+  std::cout << "         TRANSCODER: "
+            << (transcoder == transcoder_kind::json ? "json" : "raw_json") << "\n";
+  std::cout << "           ID_FIELD: " << (id_field ? quote(*id_field) : "[BYTE OFFSET]")
+            << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "             WINDOW: " << window << "\n";
+  std::cout << "      NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "      DOCUMENT_SIZE: " << document_size << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,483 @@
+/*
+ * collection_exporter — streams a whole collection to a file with a KV range scan
+ *
+ * Dumping a collection for offline analysis does not need the Query service: a KV
+ * range scan walks the documents directly on the data nodes.  The SDK splits a scan
+ * into one stream per vBucket partition and runs SCAN_CONCURRENCY of them at once, so
+ * throughput grows with the concurrency until the client host or the network is the
+ * limit.  BATCH_ITEM_LIMIT and BATCH_BYTE_LIMIT cap what each stream buffers.
+ *
+ * Documents are read with passthrough_transcoder.hxx, so
+ * bodies are never parsed: the bytes and flags stored on the server are written out
+ * as they are.  Output goes through a double buffer of BUFFER_SIZE bytes: while a
+ * background thread writes one full buffer to disk with a single large write, the scan
+ * keeps filling the other.  Memory therefore stays bounded by two buffers plus the
+ * SDK's per-partition batches, however large the collection is.
+ *
+ * Output formats (OUTPUT_FORMAT, defaults to the file extension):
+ *   jsonl   one line per document:
+ *             {"id":"...","cas":123,"flags":33554432,"value":{...}}
+ *           JSON documents are embedded verbatim; any other body is written as
+ *           "value_base64" instead of "value".
+ *   binary  a sequence of records, integers in network byte order:
+ *             u32 id length, id bytes, u64 cas, u32 flags, u32 value length, value bytes
+ *
+ * Range scans require Couchbase Server 7.6 or newer.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   OUTPUT_FILE        destination (default: collection_export.jsonl in the temp dir)
+ *   OUTPUT_FORMAT      jsonl or binary
+ *   SCAN_PREFIX        only export documents whose ID starts with this prefix
+ *   SCAN_CONCURRENCY   vBucket partitions scanned at once (default: 16)
+ *   BATCH_ITEM_LIMIT   documents per partition batch (default: 512)
+ *   BATCH_BYTE_LIMIT   bytes per partition batch (default: 1048576)
+ *   BUFFER_SIZE        size of each output buffer in bytes (default: 4194304)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/codec_flags.hxx>
+#include <couchbase/logger.hxx>
+
+#include "passthrough_transcoder.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+enum class output_format {
+  jsonl,
+  binary,
+};
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::string output_file{
+    (std::filesystem::temp_directory_path() / "collection_export.jsonl").string()
+  };
+  std::optional<output_format> format{}; // from the file extension when not set
+  std::optional<std::string> scan_prefix{};
+  std::uint16_t scan_concurrency{ 16 };
+  std::uint32_t batch_item_limit{ 512 };
+  std::uint32_t batch_byte_limit{ 1024 * 1024 };
+  std::size_t buffer_size{ 4 * 1024 * 1024 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+// Double-buffered file writer: append() fills one buffer while a background thread
+// writes the other.  append() only blocks when both buffers are full.
+class buffered_writer
+{
+public:
+  buffered_writer(std::FILE* file, std::size_t buffer_size)
+    : file_{ file }
+    , buffer_size_{ std::max<std::size_t>(buffer_size, 4096) }
+  {
+    filling_.reserve(buffer_size_);
+    flushing_.reserve(buffer_size_);
+    writer_ = std::thread([this] {
+      run();
+    });
+  }
+
+  buffered_writer(const buffered_writer&) = delete;
+  auto operator=(const buffered_writer&) -> buffered_writer& = delete;
+
+  ~buffered_writer()
+  {
+    close();
+  }
+
+  void append(std::string_view data)
+  {
+    filling_.append(data);
+    if (filling_.size() >= buffer_size_) {
+      hand_off();
+    }
+  }
+
+  // Writes everything appended so far and stops the writer thread.  Returns false if
+  // any write failed.
+  auto close() -> bool
+  {
+    if (writer_.joinable()) {
+      hand_off();
+      {
+        const std::scoped_lock lock(mutex_);
+        done_ = true;
+      }
+      cv_.notify_all();
+      writer_.join();
+    }
+    return !failed_;
+  }
+
+  [[nodiscard]] auto bytes_written() const -> std::uint64_t
+  {
+    const std::scoped_lock lock(mutex_);
+    return bytes_written_;
+  }
+
+private:
+  void hand_off()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return !pending_;
+    });
+    std::swap(filling_, flushing_);
+    pending_ = true;
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  void run()
+  {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] {
+        return pending_ || done_;
+      });
+      if (!pending_) {
+        return;
+      }
+      lock.unlock();
+      const auto written = std::fwrite(flushing_.data(), 1, flushing_.size(), file_);
+      lock.lock();
+      failed_ = failed_ || written != flushing_.size();
+      bytes_written_ += written;
+      flushing_.clear();
+      pending_ = false;
+      cv_.notify_all();
+    }
+  }
+
+  std::FILE* file_;
+  const std::size_t buffer_size_;
+  std::string filling_{};  // owned by the appending thread
+  std::string flushing_{}; // owned by the writer thread while pending_ is set
+  mutable std::mutex mutex_{};
+  std::condition_variable cv_{};
+  bool pending_{ false };
+  bool done_{ false };
+  bool failed_{ false };
+  std::uint64_t bytes_written_{ 0 };
+  std::thread writer_{};
+};
+
+void
+append_json_string(std::string& out, std::string_view value)
+{
+  static constexpr std::string_view hex{ "0123456789abcdef" };
+  out.push_back('"');
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out.append("\\u00");
+      out.push_back(hex[(static_cast<unsigned char>(c) >> 4U) & 0x0fU]);
+      out.push_back(hex[static_cast<unsigned char>(c) & 0x0fU]);
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+void
+append_base64(std::string& out, const couchbase::codec::binary& data)
+{
+  static constexpr std::string_view alphabet{
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+  };
+  std::size_t i = 0;
+  for (; i + 2 < data.size(); i += 3) {
+    const auto n = (std::to_integer<std::uint32_t>(data[i]) << 16U) |
+                   (std::to_integer<std::uint32_t>(data[i + 1]) << 8U) |
+                   std::to_integer<std::uint32_t>(data[i + 2]);
+    out.push_back(alphabet[(n >> 18U) & 0x3fU]);
+    out.push_back(alphabet[(n >> 12U) & 0x3fU]);
+    out.push_back(alphabet[(n >> 6U) & 0x3fU]);
+    out.push_back(alphabet[n & 0x3fU]);
+  }
+  if (const auto rest = data.size() - i; rest > 0) {
+    auto n = std::to_integer<std::uint32_t>(data[i]) << 16U;
+    if (rest == 2) {
+      n |= std::to_integer<std::uint32_t>(data[i + 1]) << 8U;
+    }
+    out.push_back(alphabet[(n >> 18U) & 0x3fU]);
+    out.push_back(alphabet[(n >> 12U) & 0x3fU]);
+    out.push_back(rest == 2 ? alphabet[(n >> 6U) & 0x3fU] : '=');
+    out.push_back('=');
+  }
+}
+
+void
+append_big_endian(std::string& out, std::uint64_t value, std::size_t bytes)
+{
+  for (std::size_t i = bytes; i > 0; --i) {
+    out.push_back(static_cast<char>((value >> ((i - 1) * 8)) & 0xffU));
+  }
+}
+
+// Renders one document into `record` in the requested output format.
+void
+format_record(std::string& record,
+              output_format format,
+              const std::string& id,
+              couchbase::cas cas,
+              const couchbase::codec::encoded_value& value)
+{
+  record.clear();
+  if (format == output_format::binary) {
+    append_big_endian(record, id.size(), 4);
+    record.append(id);
+    append_big_endian(record, cas.value(), 8);
+    append_big_endian(record, value.flags, 4);
+    append_big_endian(record, value.data.size(), 4);
+    record.append(reinterpret_cast<const char*>(value.data.data()), value.data.size());
+    return;
+  }
+
+  record.append(R"({"id":)");
+  append_json_string(record, id);
+  record.append(R"(,"cas":)").append(std::to_string(cas.value()));
+  record.append(R"(,"flags":)").append(std::to_string(value.flags));
+  if (couchbase::codec::codec_flags::has_common_flags(
+        value.flags, couchbase::codec::codec_flags::json_common_flags) &&
+      !value.data.empty()) {
+    record.append(R"(,"value":)");
+    record.append(reinterpret_cast<const char*>(value.data.data()), value.data.size());
+  } else {
+    record.append(R"(,"value_base64":")");
+    append_base64(record, value.data);
+    record.push_back('"');
+  }
+  record.append("}\n");
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  if (!config.format) {
+    const auto extension = std::filesystem::path(config.output_file).extension().string();
+    config.format = extension == ".bin" ? output_format::binary : output_format::jsonl;
+  }
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  std::FILE* file = std::fopen(config.output_file.c_str(), "wb");
+  if (file == nullptr) {
+    std::cout << "Unable to open " << program_config::quote(config.output_file) << "\n";
+    cluster.close().get();
+    return EXIT_FAILURE;
+  }
+  // buffered_writer already hands the C library buffer-sized writes.
+  std::setvbuf(file, nullptr, _IONBF, 0);
+
+  const auto scan_options = couchbase::scan_options{}
+                              .concurrency(config.scan_concurrency)
+                              .batch_item_limit(config.batch_item_limit)
+                              .batch_byte_limit(config.batch_byte_limit);
+  const auto start = std::chrono::steady_clock::now();
+  auto [scan_err, scan] =
+    config.scan_prefix
+      ? collection.scan(couchbase::prefix_scan(*config.scan_prefix), scan_options).get()
+      : collection.scan(couchbase::range_scan{}, scan_options).get();
+
+  std::uint64_t documents{ 0 };
+  couchbase::error export_err = scan_err;
+  bool write_ok = true;
+  if (!scan_err.ec()) {
+    buffered_writer writer(file, config.buffer_size);
+    std::string record;
+    auto next_report = start + std::chrono::seconds{ 1 };
+    while (true) {
+      auto [err, item] = scan.next().get();
+      if (err.ec()) {
+        export_err = err;
+        break;
+      }
+      if (!item) {
+        break;
+      }
+      format_record(record,
+                    *config.format,
+                    item->id(),
+                    item->cas(),
+                    item->content_as<passthrough_transcoder>());
+      writer.append(record);
+      ++documents;
+
+      if (const auto now = std::chrono::steady_clock::now(); now >= next_report) {
+        std::cout << "  " << documents << " documents, " << writer.bytes_written()
+                  << " bytes written\n";
+        next_report = now + std::chrono::seconds{ 1 };
+      }
+    }
+    write_ok = writer.close();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const auto megabytes = static_cast<double>(writer.bytes_written()) / (1024.0 * 1024.0);
+    std::cout << "Exported " << documents << " documents (" << std::fixed << std::setprecision(2)
+              << megabytes << " MB) in " << elapsed.count() << "s: "
+              << static_cast<double>(documents) / elapsed.count() << " docs/s, "
+              << megabytes / elapsed.count() << " MB/s\n";
+  }
+  write_ok = std::fclose(file) == 0 && write_ok;
+
+  if (export_err.ec()) {
+    std::cout << "Scan failed after " << documents << " documents: " << export_err.message()
+              << "\n";
+  }
+  if (!write_ok) {
+    std::cout << "Unable to write " << program_config::quote(config.output_file) << "\n";
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  if (export_err.ec() || !write_ok) {
+    return EXIT_FAILURE; // the output file is incomplete
+  }
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("OUTPUT_FILE"); val != nullptr) {
+    config.output_file = val;
+  }
+  if (const auto* val = getenv("OUTPUT_FORMAT"); val != nullptr) {
+    const std::string_view format{ val };
+    if (format == "binary") {
+      config.format = output_format::binary;
+    } else if (format == "jsonl") {
+      config.format = output_format::jsonl;
+    }
+  }
+  if (const auto* val = getenv("SCAN_PREFIX"); val != nullptr) {
+    config.scan_prefix = val;
+  }
+  if (const auto* val = getenv("SCAN_CONCURRENCY"); val != nullptr) {
+    config.scan_concurrency =
+      static_cast<std::uint16_t>(std::clamp<unsigned long>(std::stoul(val), 1, 1024));
+  }
+  if (const auto* val = getenv("BATCH_ITEM_LIMIT"); val != nullptr) {
+    config.batch_item_limit = static_cast<std::uint32_t>(std::stoul(val));
+  }
+  if (const auto* val = getenv("BATCH_BYTE_LIMIT"); val != nullptr) {
+    config.batch_byte_limit = static_cast<std::uint32_t>(std::stoul(val));
+  }
+  if (const auto* val = getenv("BUFFER_SIZE"); val != nullptr) {
+    config.buffer_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "        OUTPUT_FILE: " << quote(output_file) << "\n";
+  std::cout << "      OUTPUT_FORMAT: "
+            << (!format                          ? "[FROM EXTENSION]"
+                : format == output_format::binary ? "binary"
+                                                  : "jsonl")
+            << "\n";
+  std::cout << "        SCAN_PREFIX: " << (scan_prefix ? quote(*scan_prefix) : "[ALL]") << "\n";
+  std::cout << "   SCAN_CONCURRENCY: " << scan_concurrency << "\n";
+  std::cout << "   BATCH_ITEM_LIMIT: " << batch_item_limit << "\n";
+  std::cout << "   BATCH_BYTE_LIMIT: " << batch_byte_limit << "\n";
+  std::cout << "        BUFFER_SIZE: " << buffer_size << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,294 @@
+/*
+ * crc32c_bench — cost of the CRC-32C trailer of crc32c_transcoder
+ *
+ * For every size in PAYLOAD_SIZES it encodes and decodes BYTES_PER_SIZE bytes worth of
+ * binary documents, once with raw_binary_transcoder and once with
+ * crc32c_transcoder<raw_binary_transcoder> (crc32c_transcoder.hxx), and prints both
+ * round trips and the difference per KiB of payload.  It also times the checksum alone,
+ * with the implementation crc32c() picks on this CPU and with the table method, to show
+ * what the CRC32 instructions save.  All of this runs on the client; small documents
+ * are dominated by the copies the transcoders make, not by the checksum.
+ *
+ * It then stores DOCUMENT_ID through the wrapper, overwrites one byte of it with
+ * raw_binary_transcoder, and shows the read through the wrapper failing with
+ * decoding_failure.  The document is removed at the end.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   PAYLOAD_SIZES   comma-separated sizes in bytes (default: 64,256,1024,4096,16384,65536,
+ *                   1048576)
+ *   BYTES_PER_SIZE  payload bytes processed per size and variant (default: 67108864)
+ *   DOCUMENT_ID     ID of the corrupted document (default: "crc32c_bench::document")
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+#include <couchbase/logger.hxx>
+
+#include "crc32.hxx"
+#include "crc32c_transcoder.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::vector<std::size_t> payload_sizes{ 64, 256, 1024, 4096, 16384, 65536, 1048576 };
+  std::size_t bytes_per_size{ 64 * 1024 * 1024 };
+  std::string document_id{ "crc32c_bench::document" };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+using checked_binary_transcoder = crc32c_transcoder<couchbase::codec::raw_binary_transcoder>;
+
+auto
+split(const std::string& list) -> std::vector<std::string>
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.emplace_back(item);
+    }
+  }
+  return items;
+}
+
+auto
+make_payload(std::size_t size) -> couchbase::codec::binary
+{
+  couchbase::codec::binary payload(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    payload[i] = static_cast<std::byte>(i * 131 + 7);
+  }
+  return payload;
+}
+
+// Nanoseconds per call of `operation`, run `rounds` times.  Whatever `operation`
+// returns is folded into `sink` so that the compiler cannot drop the work.
+template<typename Operation>
+auto
+time_per_call(std::size_t rounds, std::uint64_t& sink, Operation&& operation) -> double
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; ++i) {
+    sink += static_cast<std::uint64_t>(operation());
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(rounds);
+}
+
+void
+run_benchmark(const program_config& config)
+{
+  std::cout << "crc32c implementation: " << crc32c_implementation() << "\n\n";
+  std::cout << std::setw(10) << "size" << std::setw(14) << "plain ns/op" << std::setw(14)
+            << "crc32c ns/op" << std::setw(16) << "overhead ns/KiB" << std::setw(14)
+            << "crc ns/KiB" << std::setw(16) << "table ns/KiB" << "\n";
+
+  std::uint64_t sink{ 0 };
+  for (const auto size : config.payload_sizes) {
+    const auto payload = make_payload(size);
+    const auto rounds =
+      std::max<std::size_t>(config.bytes_per_size / std::max<std::size_t>(size, 1), 1);
+
+    const auto plain = time_per_call(rounds, sink, [&payload] {
+      const auto encoded = couchbase::codec::raw_binary_transcoder::encode(payload);
+      return couchbase::codec::raw_binary_transcoder::decode(encoded).size();
+    });
+    const auto checked = time_per_call(rounds, sink, [&payload] {
+      const auto encoded = checked_binary_transcoder::encode(payload);
+      return checked_binary_transcoder::decode(encoded).size();
+    });
+    const auto hardware = time_per_call(rounds, sink, [&payload] {
+      return crc32c(payload.data(), payload.size());
+    });
+    const auto table = time_per_call(rounds, sink, [&payload] {
+      return crc32c_portable(payload.data(), payload.size());
+    });
+
+    const auto per_kib = 1024.0 / static_cast<double>(std::max<std::size_t>(size, 1));
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << size << std::setw(14)
+              << plain << std::setw(14) << checked << std::setw(16)
+              << (checked - plain) * per_kib << std::setw(14) << hardware * per_kib
+              << std::setw(16) << table * per_kib << "\n";
+  }
+  std::cout << "(checksum " << std::hex << sink << std::dec << ")\n\n";
+}
+
+void
+demonstrate_corruption(const couchbase::collection& collection, const std::string& id)
+{
+  if (auto [err, resp] =
+        collection.upsert<checked_binary_transcoder>(id, make_payload(4096), {}).get();
+      err.ec()) {
+    std::cout << "Unable to store " << program_config::quote(id) << ": " << err.message() << "\n";
+    return;
+  }
+
+  auto [get_err, stored] = collection.get(id, {}).get();
+  if (get_err.ec()) {
+    std::cout << "Unable to read " << program_config::quote(id) << ": " << get_err.message()
+              << "\n";
+    return;
+  }
+  const auto intact = stored.content_as<checked_binary_transcoder>();
+  std::cout << "Stored " << intact.size() << " bytes, checksum verified on read\n";
+
+  // Flip one bit in the middle of the stored value, trailer included, as a failing disk or
+  // a bad buffer would.
+  auto raw = stored.content_as<couchbase::codec::raw_binary_transcoder>();
+  raw[raw.size() / 2] ^= std::byte{ 0x10 };
+  if (auto [err, resp] =
+        collection.upsert<couchbase::codec::raw_binary_transcoder>(id, raw, {}).get();
+      err.ec()) {
+    std::cout << "Unable to overwrite " << program_config::quote(id) << ": " << err.message()
+              << "\n";
+    return;
+  }
+
+  auto [err, corrupted] = collection.get(id, {}).get();
+  if (err.ec()) {
+    std::cout << "Unable to read " << program_config::quote(id) << ": " << err.message() << "\n";
+    return;
+  }
+  try {
+    const auto decoded = corrupted.content_as<checked_binary_transcoder>();
+    std::cout << "Corrupted document decoded without error (" << decoded.size() << " bytes)\n";
+  } catch (const std::system_error& e) {
+    std::cout << "Corrupted document rejected: " << e.what() << "\n";
+  }
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  run_benchmark(config);
+  demonstrate_corruption(collection, config.document_id);
+  collection.remove(config.document_id, {}).get();
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("PAYLOAD_SIZES"); val != nullptr) {
+    config.payload_sizes.clear();
+    for (const auto& size : split(val)) {
+      config.payload_sizes.emplace_back(std::stoul(size));
+    }
+  }
+  if (const auto* val = getenv("BYTES_PER_SIZE"); val != nullptr) {
+    config.bytes_per_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("DOCUMENT_ID"); val != nullptr) {
+    config.document_id = val;
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string sizes;
+  for (const auto size : payload_sizes) {
+    sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "      PAYLOAD_SIZES: " << sizes << "\n";
+  std::cout << "     BYTES_PER_SIZE: " << bytes_per_size << "\n";
+  std::cout << "        DOCUMENT_ID: " << quote(document_id) << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
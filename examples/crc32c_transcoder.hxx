@@ -0,0 +1,112 @@
+/*
+ * crc32c_transcoder — CRC-32C trailer for binary transcoders
+ *
+ * A custom binary format such as bank_account_transcoder's carries no redundancy: a
+ * flipped bit in a stored balance decodes into a different, perfectly plausible number.
+ * crc32c_transcoder<T> wraps any transcoder T whose output is opaque bytes and appends
+ * the CRC-32C of T's encoding as four little-endian bytes.  decode() recomputes it and
+ * throws std::system_error with errc::common::decoding_failure on a mismatch (or on a
+ * value too short to hold a trailer) before T sees the bytes, then hands T the value
+ * without its trailer.  The flags are T's, unchanged.
+ *
+ * The checksum runs on the CPU's CRC32 instructions where available, and on slice-by-8
+ * tables otherwise (crc32.hxx).  The wrapper also copies the value once more in each
+ * direction, since an encoded_value cannot be grown or shrunk in place.  crc32c_bench.cpp
+ * measures both checksums per KiB and the cost of the wrapper per document size.
+ *
+ * The wrapper is opt-in: a program names crc32c_transcoder<T> where it wants the trailer,
+ * for example crc32c_transcoder<bank_account_transcoder> in place of the bare transcoder
+ * of transactions_transfer_with_binary_objects.cpp.  The trailer changes the stored
+ * format: documents written through the wrapper cannot be read by T alone and vice
+ * versa, so a keyspace has to be rewritten when switching.  Do not wrap JSON or string
+ * transcoders — the trailer would make the value invalid for every other reader.
+ * crc32c_bench.cpp shows a corrupted document being rejected.
+ */
+
+#pragma once
+
+#include "crc32.hxx"
+
+#include <couchbase/codec/encoded_value.hxx>
+#include <couchbase/codec/transcoder_traits.hxx>
+#include <couchbase/error_codes.hxx>
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace crc32c_transcoder_detail
+{
+constexpr std::size_t trailer_size{ 4 };
+
+// A copy of `payload` followed by its trailer, allocated once at its final size.
+inline auto
+with_trailer(const couchbase::codec::binary& payload) -> couchbase::codec::binary
+{
+  couchbase::codec::binary data;
+  data.reserve(payload.size() + trailer_size);
+  data.insert(data.end(), payload.begin(), payload.end());
+  const auto crc = crc32c(payload.data(), payload.size());
+  for (std::size_t i = 0; i < trailer_size; ++i) {
+    data.push_back(static_cast<std::byte>(crc >> (8 * i)));
+  }
+  return data;
+}
+
+// The payload in front of a verified trailer.
+inline auto
+verify_trailer(const couchbase::codec::binary& data) -> couchbase::codec::binary
+{
+  if (data.size() < trailer_size) {
+    throw std::system_error(couchbase::errc::common::decoding_failure,
+                            "crc32c_transcoder: value of " + std::to_string(data.size()) +
+                              " bytes has no checksum trailer");
+  }
+  const auto payload_size = data.size() - trailer_size;
+  std::uint32_t stored{ 0 };
+  for (std::size_t i = 0; i < trailer_size; ++i) {
+    stored |= static_cast<std::uint32_t>(data[payload_size + i]) << (8 * i);
+  }
+  if (const auto computed = crc32c(data.data(), payload_size); computed != stored) {
+    std::ostringstream message;
+    message << "crc32c_transcoder: checksum mismatch, stored=0x" << std::hex << stored
+            << ", computed=0x" << computed;
+    throw std::system_error(couchbase::errc::common::decoding_failure, message.str());
+  }
+  return { data.begin(), data.begin() + static_cast<std::ptrdiff_t>(payload_size) };
+}
+} // namespace crc32c_transcoder_detail
+
+template<typename Transcoder>
+struct crc32c_transcoder {
+  using document_type = typename Transcoder::document_type;
+
+  template<typename Document = document_type>
+  static auto encode(const Document& document) -> couchbase::codec::encoded_value
+  {
+    const auto encoded = Transcoder::encode(document);
+    return { crc32c_transcoder_detail::with_trailer(encoded.data), encoded.flags };
+  }
+
+  template<typename Document = document_type>
+  static auto decode(const couchbase::codec::encoded_value& encoded) -> Document
+  {
+    const couchbase::codec::encoded_value payload{
+      crc32c_transcoder_detail::verify_trailer(encoded.data),
+      encoded.flags,
+    };
+    // bank_account_transcoder::decode() is not a template, csv_transcoder::decode() is.
+    if constexpr (std::is_same_v<Document, document_type>) {
+      return Transcoder::decode(payload);
+    } else {
+      return Transcoder::template decode<Document>(payload);
+    }
+  }
+};
+
+template<typename Transcoder>
+struct couchbase::codec::is_transcoder<crc32c_transcoder<Transcoder>> : public std::true_type {
+};
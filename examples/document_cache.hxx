@@ -0,0 +1,339 @@
+/*
+ * document_cache — sharded, byte-bounded read-through cache in front of collection.get
+ *
+ * Entries hold the document's CAS and its raw encoded_value (bytes + flags), exactly
+ * as the server returned them; nothing is decoded until the caller asks for it with
+ * cached_document::content_as<T>(), so a hit costs a hash lookup and a shared_ptr copy.
+ *
+ * The key space is split over `shard_count` shards by hash of the document ID.  Every
+ * shard has its own mutex and its own LRU list and is bounded to max_bytes /
+ * shard_count bytes (ID + body + bookkeeping), so threads reading different documents
+ * rarely contend and the total footprint never exceeds max_bytes.
+ *
+ * An entry is served without a round trip for `ttl` after it was fetched or last
+ * validated.  After that it is revalidated instead of refetched: a sub-document lookup
+ * of the $document virtual attribute returns the current CAS without the body, and
+ * when it still matches the cached CAS the entry is renewed in place.  Only a changed
+ * (or deleted) document is fetched again in full; a fetch that finds the document
+ * deleted drops its entry.
+ *
+ * Writes made through document_cache::upsert() invalidate the entry before the write
+ * is sent and again once it completes.  Every invalidation also bumps its shard's
+ * epoch, and a fetch only fills the cache if the epoch is unchanged since it started,
+ * so a read racing with the write cannot bring back the old body.  Writes made by
+ * other clients become visible after at most `ttl`.
+ *
+ * The cache keeps its state alive until the last outstanding SDK callback has run,
+ * so it can be destroyed while operations are still in flight.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/default_json_transcoder.hxx>
+
+#include "passthrough_transcoder.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct cached_document {
+  couchbase::cas cas{};
+  couchbase::codec::encoded_value value{};
+
+  template<typename Document, typename Transcoder = couchbase::codec::default_json_transcoder>
+  [[nodiscard]] auto content_as() const -> Document
+  {
+    return Transcoder::template decode<Document>(value);
+  }
+};
+
+struct document_cache_options {
+  std::size_t shard_count{ 16 };
+  std::size_t max_bytes{ 64 * 1024 * 1024 };
+  std::chrono::milliseconds ttl{ std::chrono::seconds{ 30 } };
+};
+
+struct document_cache_stats {
+  std::uint64_t hits{ 0 };          // served from memory, no round trip
+  std::uint64_t revalidations{ 0 }; // served from memory after a CAS-only round trip
+  std::uint64_t misses{ 0 };        // full fetch of the document
+  std::uint64_t evictions{ 0 };
+  std::uint64_t invalidations{ 0 };
+  std::uint64_t entries{ 0 };
+  std::uint64_t bytes{ 0 };
+
+  // Fraction of requests answered without any round trip.
+  [[nodiscard]] auto hit_ratio() const -> double
+  {
+    const auto requests = hits + revalidations + misses;
+    return requests == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(requests);
+  }
+};
+
+using document_cache_handler =
+  std::function<void(couchbase::error, std::shared_ptr<const cached_document>)>;
+
+class document_cache
+{
+public:
+  document_cache(couchbase::collection collection, document_cache_options options = {})
+    : state_{ std::make_shared<state>(std::move(collection), options) }
+  {
+  }
+
+  // Calls `handler` with the cached document, fetching or revalidating it first when
+  // needed.  On a hit the handler runs on the calling thread, otherwise on an SDK I/O
+  // thread.
+  void get(std::string id, document_cache_handler&& handler) const
+  {
+    auto& shard = state_->shard_for(id);
+    std::shared_ptr<const cached_document> cached;
+    bool fresh{ false };
+    {
+      const std::scoped_lock lock(shard.mutex);
+      if (auto it = shard.index.find(id); it != shard.index.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        cached = it->second->document;
+        fresh = std::chrono::steady_clock::now() < it->second->fresh_until;
+      }
+    }
+    if (fresh) {
+      ++state_->hits;
+      handler({}, std::move(cached));
+    } else if (cached) {
+      revalidate(state_, std::move(id), std::move(cached), std::move(handler));
+    } else {
+      fetch(state_, std::move(id), std::move(handler));
+    }
+  }
+
+  auto get(std::string id) const
+    -> std::future<std::pair<couchbase::error, std::shared_ptr<const cached_document>>>
+  {
+    auto barrier = std::make_shared<
+      std::promise<std::pair<couchbase::error, std::shared_ptr<const cached_document>>>>();
+    auto future = barrier->get_future();
+    get(std::move(id), [barrier](auto err, auto document) {
+      barrier->set_value({ std::move(err), std::move(document) });
+    });
+    return future;
+  }
+
+  // Writes through to the collection, invalidating the cached copy around the write.
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename Document>
+  void upsert(std::string id,
+              const Document& document,
+              const couchbase::upsert_options& options,
+              couchbase::upsert_handler&& handler) const
+  {
+    state_->invalidate(id);
+    state_->collection.template upsert<Transcoder>(
+      id,
+      document,
+      options,
+      [state = state_, id, handler = std::move(handler)](auto err, auto resp) mutable {
+        state->invalidate(id);
+        handler(std::move(err), std::move(resp));
+      });
+  }
+
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename Document>
+  auto upsert(std::string id,
+              const Document& document,
+              const couchbase::upsert_options& options = {}) const
+    -> std::future<std::pair<couchbase::error, couchbase::mutation_result>>
+  {
+    auto barrier =
+      std::make_shared<std::promise<std::pair<couchbase::error, couchbase::mutation_result>>>();
+    auto future = barrier->get_future();
+    upsert<Transcoder>(std::move(id), document, options, [barrier](auto err, auto resp) {
+      barrier->set_value({ std::move(err), std::move(resp) });
+    });
+    return future;
+  }
+
+  // Drops the cached copy of `id`, e.g. after a write made outside this cache.
+  void invalidate(const std::string& id) const
+  {
+    state_->invalidate(id);
+  }
+
+  [[nodiscard]] auto stats() const -> document_cache_stats
+  {
+    document_cache_stats result{};
+    result.hits = state_->hits;
+    result.revalidations = state_->revalidations;
+    result.misses = state_->misses;
+    result.evictions = state_->evictions;
+    result.invalidations = state_->invalidations;
+    for (const auto& shard : state_->shards) {
+      const std::scoped_lock lock(shard.mutex);
+      result.entries += shard.index.size();
+      result.bytes += shard.bytes;
+    }
+    return result;
+  }
+
+private:
+  // Approximate per-entry overhead of the LRU node and the index slot.
+  static constexpr std::size_t entry_overhead{ 128 };
+
+  struct entry {
+    std::string id;
+    std::shared_ptr<const cached_document> document;
+    std::chrono::steady_clock::time_point fresh_until;
+    std::size_t size;
+  };
+
+  struct shard {
+    mutable std::mutex mutex{};
+    std::list<entry> lru{}; // most recently used first
+    std::unordered_map<std::string, std::list<entry>::iterator> index{};
+    std::size_t bytes{ 0 };
+    std::uint64_t epoch{ 0 }; // bumped by every invalidation
+  };
+
+  struct state {
+    state(couchbase::collection c, const document_cache_options& options)
+      : collection{ std::move(c) }
+      , ttl{ options.ttl }
+      , shard_capacity{ options.max_bytes / std::max<std::size_t>(options.shard_count, 1) }
+      , shards(std::max<std::size_t>(options.shard_count, 1))
+    {
+    }
+
+    auto shard_for(const std::string& id) -> shard&
+    {
+      return shards[std::hash<std::string>{}(id) % shards.size()];
+    }
+
+    void invalidate(const std::string& id)
+    {
+      auto& s = shard_for(id);
+      const std::scoped_lock lock(s.mutex);
+      ++s.epoch;
+      if (auto it = s.index.find(id); it != s.index.end()) {
+        s.bytes -= it->second->size;
+        s.lru.erase(it->second);
+        s.index.erase(it);
+        ++invalidations;
+      }
+    }
+
+    // Inserts or replaces the entry for `id` unless the shard was invalidated since
+    // `epoch` was read.
+    void store(const std::string& id,
+               std::shared_ptr<const cached_document> document,
+               std::uint64_t epoch)
+    {
+      const std::size_t size = id.size() + document->value.data.size() + entry_overhead;
+      auto& s = shard_for(id);
+      const std::scoped_lock lock(s.mutex);
+      if (s.epoch != epoch || size > shard_capacity) {
+        return;
+      }
+      if (auto it = s.index.find(id); it != s.index.end()) {
+        s.bytes -= it->second->size;
+        s.lru.erase(it->second);
+        s.index.erase(it);
+      }
+      while (!s.lru.empty() && s.bytes + size > shard_capacity) {
+        s.bytes -= s.lru.back().size;
+        s.index.erase(s.lru.back().id);
+        s.lru.pop_back();
+        ++evictions;
+      }
+      s.lru.push_front(
+        entry{ id, std::move(document), std::chrono::steady_clock::now() + ttl, size });
+      s.index.emplace(id, s.lru.begin());
+      s.bytes += size;
+    }
+
+    // Extends the freshness of `id` if it still holds `document`.
+    void renew(const std::string& id, const std::shared_ptr<const cached_document>& document)
+    {
+      auto& s = shard_for(id);
+      const std::scoped_lock lock(s.mutex);
+      if (auto it = s.index.find(id); it != s.index.end() && it->second->document == document) {
+        it->second->fresh_until = std::chrono::steady_clock::now() + ttl;
+      }
+    }
+
+    auto current_epoch(const std::string& id) -> std::uint64_t
+    {
+      auto& s = shard_for(id);
+      const std::scoped_lock lock(s.mutex);
+      return s.epoch;
+    }
+
+    const couchbase::collection collection;
+    const std::chrono::milliseconds ttl;
+    const std::size_t shard_capacity;
+    std::vector<shard> shards;
+
+    std::atomic_uint64_t hits{ 0 };
+    std::atomic_uint64_t revalidations{ 0 };
+    std::atomic_uint64_t misses{ 0 };
+    std::atomic_uint64_t evictions{ 0 };
+    std::atomic_uint64_t invalidations{ 0 };
+  };
+
+  static void fetch(const std::shared_ptr<state>& self,
+                    std::string id,
+                    document_cache_handler&& handler)
+  {
+    ++self->misses;
+    const auto epoch = self->current_epoch(id);
+    self->collection.get(
+      id,
+      {},
+      [self, id, epoch, handler = std::move(handler)](auto err, auto resp) mutable {
+        if (err.ec()) {
+          if (err.ec() == couchbase::errc::key_value::document_not_found) {
+            self->invalidate(id); // drop the entry a revalidation found deleted
+          }
+          return handler(std::move(err), nullptr);
+        }
+        auto document = std::make_shared<const cached_document>(cached_document{
+          resp.cas(), resp.template content_as<passthrough_transcoder>() });
+        self->store(id, document, epoch);
+        handler({}, std::move(document));
+      });
+  }
+
+  static void revalidate(const std::shared_ptr<state>& self,
+                         std::string id,
+                         std::shared_ptr<const cached_document> cached,
+                         document_cache_handler&& handler)
+  {
+    // Any lookup returns the document's current CAS in its header; $document is a
+    // virtual attribute, so this costs no body transfer.
+    self->collection.lookup_in(
+      id,
+      couchbase::lookup_in_specs{ couchbase::lookup_in_specs::get("$document.CAS").xattr() },
+      {},
+      [self, id, cached = std::move(cached), handler = std::move(handler)](
+        auto err, auto resp) mutable {
+        if (!err.ec() && resp.cas() == cached->cas) {
+          ++self->revalidations;
+          self->renew(id, cached);
+          return handler({}, std::move(cached));
+        }
+        fetch(self, std::move(id), std::move(handler));
+      });
+  }
+
+  std::shared_ptr<state> state_;
+};
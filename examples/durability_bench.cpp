@@ -0,0 +1,524 @@
+/*
+ * durability_bench — cost of every durability level across document sizes
+ *
+ * transactions_transfer_basic.cpp and ledger_with_csv_encoding.cpp write with
+ * durability_level::majority unconditionally.  This benchmark measures what each level
+ * costs so that the choice can be made per kind of write.  For every level in
+ * DURABILITY_LEVELS and every size in DOCUMENT_SIZES it runs two phases:
+ *
+ *   latency     OPS_PER_LEVEL upserts one after another, each timed individually
+ *   throughput  THROUGHPUT_OPS upserts from NUM_THREADS threads, each thread writing
+ *               its own document (writes to one document with a durability level in
+ *               flight would fail with durable_write_in_progress)
+ *
+ * A level the cluster cannot provide fails at once with durability_impossible (a
+ * single node whose bucket has replicas configured, or more replicas than nodes); it
+ * is reported as unavailable and skipped for the remaining sizes.
+ *
+ * The latencies are then fed into a durability_policy (durability_policy.hxx) with the
+ * write classes from WRITE_CLASSES, and the level the policy picks for each class and
+ * size is printed: the data to decide where majority is affordable.  The results are
+ * also emitted as JSON (on stdout, and into RESULT_FILE when set), with latencies in
+ * microseconds, as kv_bench does.  The documents are removed at the end.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   DURABILITY_LEVELS  comma-separated levels (default: none,majority,
+ *                      majority_and_persist_to_active,persist_to_majority)
+ *   DOCUMENT_SIZES     comma-separated sizes in bytes (default: 256,4096,65536)
+ *   OPS_PER_LEVEL      latency phase upserts per level and size (default: 200)
+ *   THROUGHPUT_OPS     throughput phase upserts per level and size (default: 2000)
+ *   NUM_THREADS        throughput phase threads (default: 8)
+ *   BUDGET_PERCENTILE  latency percentile compared against the budgets (default: 99)
+ *   WRITE_CLASSES      comma-separated name:budget_us[:minimum_level]
+ *                      (default: session:1000,order:5000,ledger:20000:majority)
+ *   KEY_PREFIX         document ID prefix (default: "durability::")
+ *   RESULT_FILE        also write the JSON report to this file
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "durability_policy.hxx"
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::vector<couchbase::durability_level> levels{ durability_levels.begin(),
+                                                   durability_levels.end() };
+  std::vector<std::size_t> document_sizes{ 256, 4096, 65536 };
+  std::size_t ops_per_level{ 200 };
+  std::size_t throughput_ops{ 2000 };
+  std::size_t num_threads{ 8 };
+  double budget_percentile{ 99 };
+  std::vector<durability_write_class> write_classes{
+    { "session", std::chrono::microseconds{ 1000 } },
+    { "order", std::chrono::microseconds{ 5000 } },
+    { "ledger", std::chrono::microseconds{ 20000 }, couchbase::durability_level::majority },
+  };
+  std::string key_prefix{ "durability::" };
+  std::optional<std::string> result_file{};
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct level_result {
+  couchbase::durability_level level;
+  std::size_t document_size;
+  bool available{ true };
+  latency_histogram latency{};
+  double ops_per_second{ 0 };
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+};
+
+auto
+split(const std::string& list) -> std::vector<std::string>
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.emplace_back(item);
+    }
+  }
+  return items;
+}
+
+auto
+make_payload(std::size_t size) -> couchbase::codec::binary
+{
+  couchbase::codec::binary payload(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    payload[i] = static_cast<std::byte>(i & 0xffU);
+  }
+  return payload;
+}
+
+auto
+latency_id(const program_config& config, std::size_t size, std::size_t index) -> std::string
+{
+  return config.key_prefix + std::to_string(size) + "::" + std::to_string(index);
+}
+
+auto
+thread_id(const program_config& config, std::size_t size, std::size_t thread) -> std::string
+{
+  return config.key_prefix + std::to_string(size) + "::thread::" + std::to_string(thread);
+}
+
+auto
+is_unavailable(const couchbase::error& err) -> bool
+{
+  return err.ec() == couchbase::errc::key_value::durability_impossible ||
+         err.ec() == couchbase::errc::key_value::durability_level_not_available;
+}
+
+auto
+run_level(const couchbase::collection& collection,
+          const program_config& config,
+          durability_policy& policy,
+          couchbase::durability_level level,
+          std::size_t size) -> level_result
+{
+  using transcoder = couchbase::codec::raw_binary_transcoder;
+
+  level_result result{ level, size };
+  const auto payload = make_payload(size);
+  const auto options = couchbase::upsert_options{}.durability(level);
+
+  for (std::size_t index = 0; index < config.ops_per_level; ++index) {
+    const auto start = std::chrono::steady_clock::now();
+    auto [err, resp] =
+      collection.upsert<transcoder>(latency_id(config, size, index), payload, options).get();
+    const auto latency = std::chrono::steady_clock::now() - start;
+    policy.record(level, size, latency, err);
+    if (is_unavailable(err)) {
+      result.available = false;
+      result.last_error = err.message();
+      return result;
+    }
+    result.latency.record(latency);
+    if (err.ec()) {
+      ++result.errors;
+      result.last_error = err.message();
+    }
+  }
+
+  std::atomic_uint64_t errors{ 0 };
+  std::vector<std::thread> workers;
+  workers.reserve(config.num_threads);
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < config.num_threads; ++t) {
+    const auto operations = config.throughput_ops / config.num_threads +
+                            (t < config.throughput_ops % config.num_threads ? 1 : 0);
+    workers.emplace_back([&, t, operations] {
+      const auto id = thread_id(config, size, t);
+      for (std::size_t i = 0; i < operations; ++i) {
+        if (collection.upsert<transcoder>(id, payload, options).get().first.ec()) {
+          ++errors;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  const auto seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (seconds > 0) {
+    result.ops_per_second = static_cast<double>(config.throughput_ops) / seconds;
+  }
+  result.errors += errors;
+  return result;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_table(const std::vector<level_result>& results)
+{
+  std::cout << "latencies in microseconds\n";
+  std::cout << std::setw(31) << "durability" << std::setw(9) << "size" << std::setw(10) << "mean"
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+            << std::setw(10) << "ops/s" << std::setw(8) << "errors"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto& r : results) {
+    std::cout << std::setw(31) << durability_level_name(r.level) << std::setw(9)
+              << r.document_size;
+    if (!r.available) {
+      std::cout << "  unavailable: " << r.last_error << "\n";
+      continue;
+    }
+    const auto& h = r.latency;
+    std::cout << std::setw(10) << to_micros(h.mean()) << std::setw(10)
+              << to_micros(h.value_at_percentile(50)) << std::setw(10)
+              << to_micros(h.value_at_percentile(99)) << std::setw(10)
+              << to_micros(h.value_at_percentile(99.9)) << std::setw(10) << r.ops_per_second
+              << std::setw(8) << r.errors << "\n";
+    if (!r.last_error.empty()) {
+      std::cout << "          last error: " << r.last_error << "\n";
+    }
+  }
+  std::cout << "\n";
+}
+
+void
+print_policy(const program_config& config, const durability_policy& policy)
+{
+  std::cout << "durability selected at p" << std::setprecision(1) << config.budget_percentile
+            << "\n";
+  std::cout << std::setw(10) << "class" << std::setw(10) << "budget" << std::setw(31)
+            << "minimum" << std::setw(9) << "size" << std::setw(31) << "selected"
+            << "\n";
+  for (const auto& write_class : config.write_classes) {
+    for (const auto size : config.document_sizes) {
+      std::cout << std::setw(10) << write_class.name << std::setw(10)
+                << write_class.budget.count() << std::setw(31)
+                << durability_level_name(write_class.minimum) << std::setw(9) << size
+                << std::setw(31) << durability_level_name(policy.select(write_class.name, size))
+                << "\n";
+    }
+  }
+  std::cout << "\n";
+}
+
+auto
+to_json(const program_config& config,
+        const std::vector<level_result>& results,
+        const durability_policy& policy) -> tao::json::value
+{
+  tao::json::value entries = tao::json::empty_array;
+  for (const auto& r : results) {
+    const auto& h = r.latency;
+    entries.emplace_back(tao::json::value{
+      { "durability", std::string{ durability_level_name(r.level) } },
+      { "document_size", r.document_size },
+      { "available", r.available },
+      { "count", h.count() },
+      { "errors", r.errors },
+      { "ops_per_second", r.ops_per_second },
+      { "mean_us", to_micros(h.mean()) },
+      { "p50_us", to_micros(h.value_at_percentile(50)) },
+      { "p99_us", to_micros(h.value_at_percentile(99)) },
+      { "p999_us", to_micros(h.value_at_percentile(99.9)) },
+      { "max_us", to_micros(h.max()) },
+    });
+  }
+
+  tao::json::value selections = tao::json::empty_array;
+  for (const auto& write_class : config.write_classes) {
+    for (const auto size : config.document_sizes) {
+      const auto selected = policy.select(write_class.name, size);
+      selections.emplace_back(tao::json::value{
+        { "class", write_class.name },
+        { "budget_us", write_class.budget.count() },
+        { "minimum", std::string{ durability_level_name(write_class.minimum) } },
+        { "document_size", size },
+        { "durability", std::string{ durability_level_name(selected) } },
+      });
+    }
+  }
+
+  return tao::json::value{
+    { "benchmark", "durability_bench" },
+    { "config",
+      {
+        { "connection_string", config.connection_string },
+        { "bucket_name", config.bucket_name },
+        { "scope_name", config.scope_name },
+        { "collection_name", config.collection_name },
+        { "ops_per_level", config.ops_per_level },
+        { "throughput_ops", config.throughput_ops },
+        { "num_threads", config.num_threads },
+        { "budget_percentile", config.budget_percentile },
+      } },
+    { "results", entries },
+    { "policy", selections },
+  };
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  // Every latency phase yields exactly one estimate per level and size.
+  durability_policy_options policy_options{};
+  policy_options.percentile = config.budget_percentile;
+  policy_options.min_samples = config.ops_per_level;
+  policy_options.window = config.ops_per_level;
+  durability_policy policy{ policy_options };
+  for (const auto& write_class : config.write_classes) {
+    policy.set_class(write_class);
+  }
+
+  std::vector<level_result> results;
+  for (const auto level : config.levels) {
+    for (const auto size : config.document_sizes) {
+      if (!policy.available(level)) {
+        results.push_back(level_result{ level, size, false, {}, 0, 0, "skipped" });
+        continue;
+      }
+      results.emplace_back(run_level(collection, config, policy, level, size));
+    }
+  }
+
+  print_table(results);
+  print_policy(config, policy);
+
+  const auto report = tao::json::to_string(to_json(config, results, policy), 2);
+  std::cout << report << "\n";
+  if (config.result_file) {
+    std::ofstream out(*config.result_file);
+    out << report << "\n";
+    if (!out) {
+      std::cout << "Unable to write " << program_config::quote(*config.result_file) << "\n";
+    }
+  }
+
+  for (const auto size : config.document_sizes) {
+    for (std::size_t index = 0; index < config.ops_per_level; ++index) {
+      collection.remove(latency_id(config, size, index), {}).get();
+    }
+    for (std::size_t t = 0; t < config.num_threads; ++t) {
+      collection.remove(thread_id(config, size, t), {}).get();
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("DURABILITY_LEVELS"); val != nullptr) {
+    config.levels.clear();
+    for (const auto& name : split(val)) {
+      if (const auto level = durability_level_from_name(name); level) {
+        config.levels.emplace_back(*level);
+      } else {
+        std::cout << "Ignoring unknown durability level " << quote(name) << "\n";
+      }
+    }
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZES"); val != nullptr) {
+    config.document_sizes.clear();
+    for (const auto& size : split(val)) {
+      config.document_sizes.emplace_back(std::stoul(size));
+    }
+  }
+  if (const auto* val = getenv("OPS_PER_LEVEL"); val != nullptr) {
+    config.ops_per_level = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("THROUGHPUT_OPS"); val != nullptr) {
+    config.throughput_ops = std::stoul(val);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("BUDGET_PERCENTILE"); val != nullptr) {
+    config.budget_percentile = std::stod(val);
+  }
+  if (const auto* val = getenv("WRITE_CLASSES"); val != nullptr) {
+    config.write_classes.clear();
+    for (const auto& spec : split(val)) {
+      std::istringstream input(spec);
+      std::string name;
+      std::string budget;
+      std::string minimum;
+      std::getline(input, name, ':');
+      std::getline(input, budget, ':');
+      std::getline(input, minimum);
+      durability_write_class write_class{ name, std::chrono::microseconds{ std::stol(budget) } };
+      if (!minimum.empty()) {
+        if (const auto level = durability_level_from_name(minimum); level) {
+          write_class.minimum = *level;
+        } else {
+          std::cout << "Ignoring unknown durability level " << quote(minimum) << "\n";
+        }
+      }
+      config.write_classes.emplace_back(std::move(write_class));
+    }
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("RESULT_FILE"); val != nullptr) {
+    config.result_file = val;
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string level_names;
+  for (const auto level : levels) {
+    level_names += std::string{ level_names.empty() ? "" : "," } +
+                   std::string{ durability_level_name(level) };
+  }
+  std::string sizes;
+  for (const auto size : document_sizes) {
+    sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+  }
+  std::string classes;
+  for (const auto& write_class : write_classes) {
+    classes += (classes.empty() ? "" : ",") + write_class.name + ":" +
+               std::to_string(write_class.budget.count()) + ":" +
+               std::string{ durability_level_name(write_class.minimum) };
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "  DURABILITY_LEVELS: " << level_names << "\n";
+  std::cout << "     DOCUMENT_SIZES: " << sizes << "\n";
+  std::cout << "      OPS_PER_LEVEL: " << ops_per_level << "\n";
+  std::cout << "     THROUGHPUT_OPS: " << throughput_ops << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "  BUDGET_PERCENTILE: " << budget_percentile << "\n";
+  std::cout << "      WRITE_CLASSES: " << classes << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "        RESULT_FILE: " << (result_file ? quote(*result_file) : "[NONE]") << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
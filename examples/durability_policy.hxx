@@ -0,0 +1,223 @@
+/*
+ * durability_policy — picks a durability level per write class from a latency budget
+ *
+ * Every durability level buys a stronger guarantee with a longer wait:
+ *
+ *   none                            acknowledged once the active node has the write
+ *   majority                        ... once a majority of copies have it in memory
+ *   majority_and_persist_to_active  ... and the active node has also persisted it
+ *   persist_to_majority             ... once a majority of copies have persisted it
+ *
+ * Instead of hard-coding one level for every write, an application names its kinds of
+ * write (write classes) and gives each a latency budget and the weakest level it may
+ * ever use.  durability_policy::select() then returns the strongest level whose
+ * `percentile` latency, as measured for documents of that size, fits the budget; if
+ * none fits, the class minimum, since a budget never justifies a weaker guarantee than
+ * the class requires.
+ *
+ * Latencies are fed in with record(), either from a benchmark that writes with every
+ * level up front (durability_bench.cpp) or from the application's own writes.  They are
+ * kept per level and per document size class (the next power of two, at least 64
+ * bytes); an estimate is the percentile of the last `window` writes of its cell, so it
+ * follows the cluster when it gets faster or slower.  A size with no estimate of its
+ * own uses the estimate of the nearest larger measured size; a level without any such
+ * estimate is never selected above the minimum.  Note that live writes only refresh
+ * the levels that are selected: a level that once was too slow stays out of use until
+ * it is measured again.
+ *
+ * A write that fails with durability_impossible or durability_level_not_available
+ * marks its level as unavailable (not enough replicas, or a server without durability
+ * support), and the level is not selected until reset().  All members are thread-safe;
+ * record() may be called from SDK completion handlers.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/durability_level.hxx>
+
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+struct durability_write_class {
+  std::string name;
+  std::chrono::microseconds budget;
+  couchbase::durability_level minimum{ couchbase::durability_level::none };
+};
+
+struct durability_policy_options {
+  double percentile{ 99 };
+  std::size_t window{ 1000 };
+  std::size_t min_samples{ 20 }; // writes before a cell has a first estimate
+};
+
+// From the weakest to the strongest guarantee.
+inline constexpr std::array<couchbase::durability_level, 4> durability_levels{
+  couchbase::durability_level::none,
+  couchbase::durability_level::majority,
+  couchbase::durability_level::majority_and_persist_to_active,
+  couchbase::durability_level::persist_to_majority,
+};
+
+inline auto
+durability_level_name(couchbase::durability_level level) -> std::string_view
+{
+  switch (level) {
+    case couchbase::durability_level::none:
+      return "none";
+    case couchbase::durability_level::majority:
+      return "majority";
+    case couchbase::durability_level::majority_and_persist_to_active:
+      return "majority_and_persist_to_active";
+    case couchbase::durability_level::persist_to_majority:
+      return "persist_to_majority";
+  }
+  return "unknown";
+}
+
+inline auto
+durability_level_from_name(std::string_view name) -> std::optional<couchbase::durability_level>
+{
+  for (const auto level : durability_levels) {
+    if (durability_level_name(level) == name) {
+      return level;
+    }
+  }
+  return {};
+}
+
+class durability_policy
+{
+public:
+  explicit durability_policy(durability_policy_options options = {})
+    : options_{ options }
+  {
+  }
+
+  // Adds or replaces a write class.
+  void set_class(durability_write_class write_class)
+  {
+    const std::scoped_lock lock(mutex_);
+    auto name = write_class.name;
+    classes_.insert_or_assign(std::move(name), std::move(write_class));
+  }
+
+  void record(couchbase::durability_level level,
+              std::size_t document_size,
+              std::chrono::nanoseconds latency,
+              const couchbase::error& err = {})
+  {
+    const std::scoped_lock lock(mutex_);
+    if (err.ec() == couchbase::errc::key_value::durability_impossible ||
+        err.ec() == couchbase::errc::key_value::durability_level_not_available) {
+      unavailable_[index_of(level)] = true;
+      return;
+    }
+    auto& c = cells_[{ index_of(level), size_class(document_size) }];
+    c.latencies.record(latency);
+    const auto samples = c.estimate ? options_.window : options_.min_samples;
+    if (c.latencies.count() >= std::max<std::size_t>(samples, 1)) {
+      c.estimate = c.latencies.value_at_percentile(options_.percentile);
+      c.latencies.reset();
+    }
+  }
+
+  // The level for a write of `document_size` bytes of the named class; an unknown class
+  // gets durability_level::none.
+  [[nodiscard]] auto select(std::string_view class_name, std::size_t document_size) const
+    -> couchbase::durability_level
+  {
+    const std::scoped_lock lock(mutex_);
+    const auto found = classes_.find(std::string{ class_name });
+    if (found == classes_.end()) {
+      return couchbase::durability_level::none;
+    }
+    const auto& write_class = found->second;
+    const auto minimum = index_of(write_class.minimum);
+    for (auto i = durability_levels.size(); i-- > minimum + 1;) {
+      if (unavailable_[i]) {
+        continue;
+      }
+      if (const auto latency = estimate_locked(i, document_size);
+          latency && *latency <= write_class.budget) {
+        return durability_levels[i];
+      }
+    }
+    return write_class.minimum;
+  }
+
+  // The current `percentile` latency estimate for the level and size, if any.
+  [[nodiscard]] auto estimate(couchbase::durability_level level, std::size_t document_size) const
+    -> std::optional<std::chrono::nanoseconds>
+  {
+    const std::scoped_lock lock(mutex_);
+    return estimate_locked(index_of(level), document_size);
+  }
+
+  [[nodiscard]] auto available(couchbase::durability_level level) const -> bool
+  {
+    const std::scoped_lock lock(mutex_);
+    return !unavailable_[index_of(level)];
+  }
+
+  // Forgets all measurements and unavailable levels; the write classes are kept.
+  void reset()
+  {
+    const std::scoped_lock lock(mutex_);
+    cells_.clear();
+    unavailable_ = {};
+  }
+
+private:
+  struct cell {
+    latency_histogram latencies{};
+    std::optional<std::chrono::nanoseconds> estimate{};
+  };
+
+  static auto index_of(couchbase::durability_level level) -> std::size_t
+  {
+    for (std::size_t i = 0; i < durability_levels.size(); ++i) {
+      if (durability_levels[i] == level) {
+        return i;
+      }
+    }
+    return 0;
+  }
+
+  static auto size_class(std::size_t document_size) -> std::size_t
+  {
+    std::size_t size{ 64 };
+    while (size < document_size) {
+      size <<= 1U;
+    }
+    return size;
+  }
+
+  [[nodiscard]] auto estimate_locked(std::size_t level, std::size_t document_size) const
+    -> std::optional<std::chrono::nanoseconds>
+  {
+    for (auto it = cells_.lower_bound({ level, size_class(document_size) });
+         it != cells_.end() && it->first.first == level;
+         ++it) {
+      if (it->second.estimate) {
+        return it->second.estimate;
+      }
+    }
+    return {};
+  }
+
+  const durability_policy_options options_;
+  mutable std::mutex mutex_{};
+  std::map<std::string, durability_write_class> classes_{};
+  std::map<std::pair<std::size_t, std::size_t>, cell> cells_{}; // (level, size class)
+  std::array<bool, durability_levels.size()> unavailable_{};
+};
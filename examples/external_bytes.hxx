@@ -0,0 +1,111 @@
+/*
+ * external_bytes — binary documents backed by memory the application does not copy
+ *
+ * Uploading a file with raw_binary_transcoder, as in minimal_with_char_array.cpp, means
+ * reading it into an std::vector<std::byte> first; upsert<raw_binary_transcoder>() then
+ * takes that vector by value and encodes it, so the bytes are copied twice before the
+ * SDK even starts building its request, and the process holds two private copies of
+ * the whole document at once.
+ *
+ * external_bytes is a document that only refers to bytes owned by someone else: a
+ * memory-mapped file (mapped_file.hxx), a buffer of another library, a slice of either.
+ * It carries a shared `owner` that keeps the memory alive.  external_binary_transcoder
+ * encodes it with a single copy, straight from the source into the value handed to the
+ * SDK, and upsert_external() holds on to the owner until the write has completed, so
+ * the source can be released by the caller as soon as the call returns.
+ *
+ * This is as close to zero-copy as the public API allows: couchbase::codec::encoded_value
+ * owns its bytes in an std::vector, so one copy into it cannot be avoided, and the SDK
+ * copies the value once more into its request buffer.  What goes away is the private
+ * buffer holding the file (for a mapping, the source pages belong to the page cache and
+ * can be dropped by the kernel at any time) and the copy made by the by-value encode;
+ * peak private memory per document drops from three copies to two.  For objects larger
+ * than a document, blob_store.hxx copies each chunk straight from the source as well.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/codec_flags.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+
+struct external_bytes {
+  const std::byte* data{ nullptr };
+  std::size_t size{ 0 };
+  std::shared_ptr<const void> owner{}; // keeps `data` valid
+
+  // Bytes [offset, offset + length) of this view, clamped to its end, sharing the owner.
+  [[nodiscard]] auto slice(std::size_t offset, std::size_t length) const -> external_bytes
+  {
+    offset = std::min(offset, size);
+    return { data + offset, std::min(length, size - offset), owner };
+  }
+};
+
+// Copies the referenced bytes once, into the value given to the SDK, with the binary
+// common flags.  Decoding is raw_binary_transcoder's, into an owning vector.
+struct external_binary_transcoder {
+  using document_type = couchbase::codec::raw_binary_transcoder::document_type;
+
+  static auto encode(const external_bytes& document) -> couchbase::codec::encoded_value
+  {
+    return { couchbase::codec::binary(document.data, document.data + document.size),
+             couchbase::codec::codec_flags::binary_common_flags };
+  }
+
+  static auto decode(const couchbase::codec::encoded_value& encoded) -> document_type
+  {
+    return couchbase::codec::raw_binary_transcoder::decode(encoded);
+  }
+};
+
+template<>
+struct couchbase::codec::is_transcoder<external_binary_transcoder> : public std::true_type {
+};
+
+using external_upsert_handler = std::function<void(couchbase::error, couchbase::mutation_result)>;
+
+// The owner of `document` is released only after the handler has run, on an SDK I/O
+// thread.  The current SDK has copied the bytes before this returns; holding the owner
+// keeps callers correct should the copy ever move onto the I/O path.
+inline void
+upsert_external(const couchbase::collection& collection,
+                std::string id,
+                external_bytes document,
+                const couchbase::upsert_options& options,
+                external_upsert_handler&& handler)
+{
+  auto encoded = external_binary_transcoder::encode(document);
+  collection.upsert(
+    std::move(id),
+    std::move(encoded),
+    options,
+    [owner = std::move(document.owner), handler = std::move(handler)](auto err, auto resp) {
+      handler(std::move(err), std::move(resp));
+    });
+}
+
+inline auto
+upsert_external(const couchbase::collection& collection,
+                std::string id,
+                external_bytes document,
+                const couchbase::upsert_options& options = {})
+  -> std::future<std::pair<couchbase::error, couchbase::mutation_result>>
+{
+  auto barrier =
+    std::make_shared<std::promise<std::pair<couchbase::error, couchbase::mutation_result>>>();
+  auto future = barrier->get_future();
+  upsert_external(
+    collection, std::move(id), std::move(document), options, [barrier](auto err, auto resp) {
+      barrier->set_value({ std::move(err), std::move(resp) });
+    });
+  return future;
+}
@@ -0,0 +1,303 @@
+/*
+ * hedged_get — tail latency of plain gets vs hedged gets
+ *
+ * Seeds NUM_DOCUMENTS small documents, then runs NUM_OPERATIONS gets of random
+ * documents from NUM_THREADS threads twice: with collection.get(), and through the
+ * hedged_reader from hedged_get.hxx, which adds a get_any_replica() to every get that
+ * is still outstanding after the hedge delay.  For both it prints the latency
+ * percentiles; for the hedged run also how many gets were hedged, how many of those the
+ * replica read won, how many hedges the budget suppressed and the delay in effect at
+ * the end.
+ *
+ * A healthy local server answers almost every get well below its p95, so few hedges
+ * fire and the tails look alike.  The difference shows on a multi-node cluster with one
+ * slow node, where the hedged p99.9 stays close to the latency of the healthy nodes.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_DOCUMENTS     documents to read (default: 1000)
+ *   NUM_THREADS       reader threads (default: 4)
+ *   NUM_OPERATIONS    gets across all threads, per run (default: 20000)
+ *   HEDGE_DELAY_US    fixed hedge delay; 0 follows HEDGE_PERCENTILE (default: 0)
+ *   HEDGE_PERCENTILE  percentile of the active get latency used as delay (default: 95)
+ *   HEDGE_BUDGET      maximum hedges per get (default: 0.05)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "hedged_get.hxx"
+#include "kv_multi.hxx"
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_documents{ 1000 };
+  std::size_t num_threads{ 4 };
+  std::size_t num_operations{ 20000 };
+  std::chrono::microseconds hedge_delay{ 0 };
+  double hedge_percentile{ 95 };
+  double hedge_budget{ 0.05 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+make_document_id(std::size_t index) -> std::string
+{
+  return "hedged::" + std::to_string(index);
+}
+
+struct run_result {
+  latency_histogram latency{};
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+};
+
+// Runs `get(id)` num_operations times across num_threads threads; the callable returns
+// the couchbase::error of the read.
+template<typename Get>
+auto
+run_gets(const program_config& config, Get&& get) -> run_result
+{
+  run_result result{};
+  std::mutex result_mutex;
+  std::vector<std::thread> workers;
+  workers.reserve(config.num_threads);
+  for (std::size_t t = 0; t < config.num_threads; ++t) {
+    const auto operations = config.num_operations / config.num_threads +
+                            (t < config.num_operations % config.num_threads ? 1 : 0);
+    workers.emplace_back([&, t, operations] {
+      std::mt19937_64 engine{ t + 1 };
+      std::uniform_int_distribution<std::size_t> pick{ 0, config.num_documents - 1 };
+      latency_histogram latency{};
+      std::uint64_t errors{ 0 };
+      std::string last_error{};
+      for (std::size_t i = 0; i < operations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const couchbase::error err = get(make_document_id(pick(engine)));
+        latency.record(std::chrono::steady_clock::now() - start);
+        if (err.ec()) {
+          ++errors;
+          last_error = err.message();
+        }
+      }
+      const std::scoped_lock lock(result_mutex);
+      result.latency.merge(latency);
+      result.errors += errors;
+      if (!last_error.empty()) {
+        result.last_error = last_error;
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return result;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_result(const std::string& name, const run_result& result)
+{
+  const auto& h = result.latency;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::left << std::setw(8) << name << std::right << " latency us: p50 "
+            << to_micros(h.value_at_percentile(50)) << ", p95 "
+            << to_micros(h.value_at_percentile(95)) << ", p99 "
+            << to_micros(h.value_at_percentile(99)) << ", p99.9 "
+            << to_micros(h.value_at_percentile(99.9)) << ", max " << to_micros(h.max()) << " ("
+            << h.count() << " gets, " << result.errors << " errors)\n";
+  if (!result.last_error.empty()) {
+    std::cout << "  last error: " << result.last_error << "\n";
+  }
+}
+
+auto
+percent(std::uint64_t part, std::uint64_t whole) -> double
+{
+  return whole == 0 ? 0.0 : static_cast<double>(part) * 100 / static_cast<double>(whole);
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  {
+    std::vector<std::pair<std::string, tao::json::value>> documents;
+    documents.reserve(config.num_documents);
+    for (std::size_t i = 0; i < config.num_documents; ++i) {
+      documents.emplace_back(make_document_id(i), tao::json::value{ { "index", i } });
+    }
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : upsert_multi(collection, documents)) {
+      if (entry.error.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "Seeded " << config.num_documents - failed << " documents (" << failed
+              << " failed)\n";
+  }
+
+  print_result("get", run_gets(config, [&](std::string id) {
+                 auto [err, resp] = collection.get(std::move(id)).get();
+                 return err;
+               }));
+
+  hedged_get_options hedge_options{};
+  if (config.hedge_delay.count() > 0) {
+    hedge_options.delay = config.hedge_delay;
+  }
+  hedge_options.delay_percentile = config.hedge_percentile;
+  hedge_options.budget = config.hedge_budget;
+  const hedged_reader reader{ collection, hedge_options };
+  print_result("hedged", run_gets(config, [&](std::string id) {
+                 auto [err, document] = reader.get(std::move(id)).get();
+                 return err;
+               }));
+  const auto stats = reader.stats();
+  std::cout << std::setprecision(2) << "  hedged " << stats.hedged << " of " << stats.gets
+            << " gets (" << percent(stats.hedged, stats.gets) << "%), replica won " << stats.won
+            << " (" << percent(stats.won, stats.hedged) << "% of hedges), " << stats.suppressed
+            << " suppressed by the budget, delay " << stats.delay.count() << "us\n";
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("HEDGE_DELAY_US"); val != nullptr) {
+    config.hedge_delay = std::chrono::microseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("HEDGE_PERCENTILE"); val != nullptr) {
+    config.hedge_percentile = std::stod(val);
+  }
+  if (const auto* val = getenv("HEDGE_BUDGET"); val != nullptr) {
+    config.hedge_budget = std::stod(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "      NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "     NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "     HEDGE_DELAY_US: " << hedge_delay.count() << "\n";
+  std::cout << "   HEDGE_PERCENTILE: " << hedge_percentile << "\n";
+  std::cout << "       HEDGE_BUDGET: " << hedge_budget << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
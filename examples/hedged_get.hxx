@@ -0,0 +1,322 @@
+/*
+ * hedged_get — races a slow collection.get against a replica read
+ *
+ * When one node stalls, every get routed to it waits, and those waits make up almost
+ * all of the tail latency.  hedged_reader::get() sends the normal get to the active
+ * copy and, if it has not answered after `delay`, also sends get_any_replica() for the
+ * same document.  Whichever answer arrives first is passed to the handler; the other
+ * one is dropped.  get_any_replica() asks the active and every replica at once and
+ * returns the first answer, so the hedge wins whenever any copy is faster than the get
+ * that stalled.  A replica answer may be slightly stale, which the caller accepts by
+ * using hedged reads at all; hedged_document::replica tells which kind of copy it got.
+ *
+ * Without a fixed `delay`, the delay follows the `delay_percentile` (default p95) of
+ * the latencies of the active gets: it is recomputed from the last `window` of them, so
+ * it adapts when the cluster gets faster or slower.  Until `min_samples` have been
+ * seen, `initial_delay` is used.
+ *
+ * Each hedge is an extra read, so hedges are capped at `budget` times the number of
+ * gets so far (plus `burst`); once the cap is reached the get simply waits for the
+ * active copy.  A failed get is only reported after both reads have failed, with the
+ * error of the active get; document_not_found from the active copy is final.
+ *
+ * The delays are kept by one timer thread owned by the reader.  SDK callbacks never
+ * block, and the reader can be destroyed while gets are in flight: their handlers
+ * still run, they just can no longer be hedged.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/default_json_transcoder.hxx>
+
+#include "latency_histogram.hxx"
+#include "passthrough_transcoder.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct hedged_document {
+  couchbase::cas cas{};
+  couchbase::codec::encoded_value value{};
+  bool replica{ false }; // served by a replica copy, which may be slightly stale
+
+  template<typename Document, typename Transcoder = couchbase::codec::default_json_transcoder>
+  [[nodiscard]] auto content_as() const -> Document
+  {
+    return Transcoder::template decode<Document>(value);
+  }
+};
+
+struct hedged_get_options {
+  std::optional<std::chrono::microseconds> delay{}; // fixed delay, instead of the percentile
+  double delay_percentile{ 95 };
+  std::chrono::microseconds initial_delay{ std::chrono::milliseconds{ 5 } };
+  std::size_t min_samples{ 100 };
+  std::size_t window{ 1000 };
+  double budget{ 0.05 }; // hedges per get
+  std::size_t burst{ 10 };
+};
+
+struct hedged_get_stats {
+  std::uint64_t gets{ 0 };
+  std::uint64_t hedged{ 0 };     // replica reads sent
+  std::uint64_t won{ 0 };        // ... that answered first
+  std::uint64_t suppressed{ 0 }; // hedges skipped because the budget was used up
+  std::chrono::microseconds delay{ 0 };
+};
+
+using hedged_get_handler = std::function<void(couchbase::error, hedged_document)>;
+
+class hedged_reader
+{
+public:
+  explicit hedged_reader(couchbase::collection collection, hedged_get_options options = {})
+    : state_{ std::make_shared<state>(std::move(collection), options) }
+    , timer_{ [state = state_] {
+      state->run_timer();
+    } }
+  {
+  }
+
+  hedged_reader(const hedged_reader&) = delete;
+  auto operator=(const hedged_reader&) -> hedged_reader& = delete;
+
+  ~hedged_reader()
+  {
+    {
+      const std::scoped_lock lock(state_->timer_mutex);
+      state_->stopped = true;
+      state_->timer_cv.notify_all();
+    }
+    timer_.join();
+  }
+
+  // The handler runs on an SDK I/O thread.
+  void get(std::string id, hedged_get_handler&& handler) const
+  {
+    ++state_->gets;
+    auto request = std::make_shared<attempt>(std::move(id), std::move(handler));
+    state_->schedule(request);
+    state_->collection.get(
+      request->id, {}, [self = state_, request](auto err, auto resp) {
+        self->record_active_latency(std::chrono::steady_clock::now() - request->start);
+        hedged_get_handler handler;
+        {
+          const std::scoped_lock lock(request->mutex);
+          if (request->done) {
+            return; // the hedge answered first
+          }
+          if (err.ec() && err.ec() != couchbase::errc::key_value::document_not_found &&
+              request->replica_pending) {
+            request->active_error = err; // let the replica read decide
+            return;
+          }
+          request->done = true;
+          handler = std::move(request->handler);
+        }
+        hedged_document document{};
+        if (!err.ec()) {
+          document.cas = resp.cas();
+          document.value = resp.template content_as<passthrough_transcoder>();
+        }
+        handler(std::move(err), std::move(document));
+      });
+  }
+
+  auto get(std::string id) const -> std::future<std::pair<couchbase::error, hedged_document>>
+  {
+    auto barrier = std::make_shared<std::promise<std::pair<couchbase::error, hedged_document>>>();
+    auto future = barrier->get_future();
+    get(std::move(id), [barrier](auto err, auto document) {
+      barrier->set_value({ std::move(err), std::move(document) });
+    });
+    return future;
+  }
+
+  [[nodiscard]] auto stats() const -> hedged_get_stats
+  {
+    return {
+      state_->gets,
+      state_->hedged,
+      state_->won,
+      state_->suppressed,
+      std::chrono::duration_cast<std::chrono::microseconds>(state_->current_delay()),
+    };
+  }
+
+private:
+  struct attempt {
+    attempt(std::string document_id, hedged_get_handler&& h)
+      : id{ std::move(document_id) }
+      , handler{ std::move(h) }
+    {
+    }
+
+    const std::string id;
+    const std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+    std::mutex mutex{};
+    hedged_get_handler handler;
+    bool done{ false };
+    bool replica_pending{ false };
+    std::optional<couchbase::error> active_error{};
+  };
+
+  struct timer {
+    std::chrono::steady_clock::time_point deadline;
+    std::shared_ptr<attempt> request;
+
+    auto operator>(const timer& other) const -> bool
+    {
+      return deadline > other.deadline;
+    }
+  };
+
+  struct state : std::enable_shared_from_this<state> {
+    state(couchbase::collection c, const hedged_get_options& o)
+      : collection{ std::move(c) }
+      , options{ o }
+      , delay_ns{ std::chrono::nanoseconds{ o.delay.value_or(o.initial_delay) }.count() }
+    {
+    }
+
+    [[nodiscard]] auto current_delay() const -> std::chrono::nanoseconds
+    {
+      return std::chrono::nanoseconds{ delay_ns.load() };
+    }
+
+    void record_active_latency(std::chrono::nanoseconds latency)
+    {
+      if (options.delay) {
+        return;
+      }
+      const std::scoped_lock lock(latency_mutex);
+      latencies.record(latency);
+      if (latencies.count() >= std::max(options.window, options.min_samples)) {
+        delay_ns = latencies.value_at_percentile(options.delay_percentile).count();
+        latencies.reset();
+      }
+    }
+
+    void schedule(std::shared_ptr<attempt> request)
+    {
+      const std::scoped_lock lock(timer_mutex);
+      const auto deadline = request->start + current_delay();
+      const bool earliest = timers.empty() || deadline < timers.top().deadline;
+      timers.push({ deadline, std::move(request) });
+      if (earliest) {
+        timer_cv.notify_one();
+      }
+    }
+
+    void run_timer()
+    {
+      std::unique_lock lock(timer_mutex);
+      while (!stopped) {
+        if (timers.empty()) {
+          timer_cv.wait(lock);
+          continue;
+        }
+        if (std::chrono::steady_clock::now() < timers.top().deadline) {
+          timer_cv.wait_until(lock, timers.top().deadline);
+          continue;
+        }
+        auto request = timers.top().request;
+        timers.pop();
+        lock.unlock();
+        hedge(std::move(request));
+        lock.lock();
+      }
+    }
+
+    auto try_spend_budget() -> bool
+    {
+      const auto allowed =
+        static_cast<std::uint64_t>(options.budget * static_cast<double>(gets.load())) +
+        options.burst;
+      if (++hedged > allowed) {
+        --hedged;
+        return false;
+      }
+      return true;
+    }
+
+    void hedge(std::shared_ptr<attempt> request)
+    {
+      {
+        const std::scoped_lock lock(request->mutex);
+        if (request->done) {
+          return;
+        }
+        if (!try_spend_budget()) {
+          ++suppressed;
+          return;
+        }
+        request->replica_pending = true;
+      }
+      collection.get_any_replica(
+        request->id,
+        {},
+        [self = shared_from_this(), request](auto err, auto resp) {
+          hedged_get_handler handler;
+          {
+            const std::scoped_lock lock(request->mutex);
+            request->replica_pending = false;
+            if (request->done) {
+              return;
+            }
+            if (err.ec()) {
+              if (!request->active_error) {
+                return; // the active get is still running
+              }
+              err = *request->active_error;
+            } else {
+              ++self->won;
+            }
+            request->done = true;
+            handler = std::move(request->handler);
+          }
+          hedged_document document{};
+          if (!err.ec()) {
+            document.cas = resp.cas();
+            document.value = resp.template content_as<passthrough_transcoder>();
+            document.replica = resp.is_replica();
+          }
+          handler(std::move(err), std::move(document));
+        });
+    }
+
+    const couchbase::collection collection;
+    const hedged_get_options options;
+
+    std::atomic_uint64_t gets{ 0 };
+    std::atomic_uint64_t hedged{ 0 };
+    std::atomic_uint64_t won{ 0 };
+    std::atomic_uint64_t suppressed{ 0 };
+
+    std::mutex latency_mutex{};
+    latency_histogram latencies{};
+    std::atomic_int64_t delay_ns;
+
+    std::mutex timer_mutex{};
+    std::condition_variable timer_cv{};
+    std::priority_queue<timer, std::vector<timer>, std::greater<>> timers{};
+    bool stopped{ false };
+  };
+
+  std::shared_ptr<state> state_;
+  std::thread timer_;
+};
@@ -0,0 +1,366 @@
+/*
+ * hot_key_bench — cost of hot-key detection in the client hot path
+ *
+ * hot_key_detector.hxx counts every key a client touches.  That is only acceptable if
+ * the counting is cheap next to the operations themselves; the budget is 1% of one CPU
+ * core at TARGET_RATE operations per second.  This program measures it in two ways.
+ *
+ *   1. CPU cost.  NUM_THREADS threads replay NUM_RECORDS key accesses drawn from a
+ *      Zipfian distribution over NUM_KEYS keys, once without and once with
+ *      hot_key_detector::record(), and the difference gives the CPU time per record.
+ *      Multiplied by TARGET_RATE this is the share of one core spent on detection.  The
+ *      keys reported by the detector are compared with the true hottest keys.
+ *   2. End to end.  The same threads run NUM_OPERATIONS gets against NUM_DOCUMENTS
+ *      documents, alternating ROUNDS times between the plain collection and a
+ *      hot_key_tracking_collection, and the best throughput of each is printed.  On a
+ *      local server the difference is within run-to-run noise.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_THREADS      threads (default: 4)
+ *   NUM_KEYS         key space of the CPU benchmark (default: 100000)
+ *   NUM_RECORDS      accesses across all threads in the CPU benchmark (default: 4000000)
+ *   TARGET_RATE      operations per second the budget applies to (default: 100000)
+ *   NUM_DOCUMENTS    documents of the end-to-end benchmark (default: 1000)
+ *   NUM_OPERATIONS   gets across all threads, per round and mode (default: 20000)
+ *   ROUNDS           rounds of the end-to-end benchmark (default: 3)
+ *   ZIPF_THETA       skew of both key distributions (default: 0.99)
+ *   TOP_K            hot keys reported by the detector (default: 10)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "hot_key_detector.hxx"
+#include "key_distribution.hxx"
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_threads{ 4 };
+  std::size_t num_keys{ 100000 };
+  std::size_t num_records{ 4000000 };
+  double target_rate{ 100000 };
+  std::size_t num_documents{ 1000 };
+  std::size_t num_operations{ 20000 };
+  std::size_t rounds{ 3 };
+  double zipf_theta{ 0.99 };
+  std::size_t top_k{ 10 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+make_key(std::size_t index) -> std::string
+{
+  return "item::" + std::to_string(index);
+}
+
+// Splits `total` over the threads and runs `body(thread_index, share)` on each.
+template<typename Body>
+void
+run_threads(std::size_t num_threads, std::size_t total, Body&& body)
+{
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    const auto share = total / num_threads + (t < total % num_threads ? 1 : 0);
+    workers.emplace_back([&body, t, share] {
+      body(t, share);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+// Returns the CPU time of one record() call in nanoseconds.
+auto
+measure_record_cost(const program_config& config, hot_key_detector& detector) -> double
+{
+  std::vector<std::string> keys;
+  keys.reserve(config.num_keys);
+  for (std::size_t i = 0; i < config.num_keys; ++i) {
+    keys.emplace_back(make_key(i));
+  }
+  const auto distribution = key_distribution::zipfian(config.num_keys, config.zipf_theta);
+  std::vector<std::vector<std::uint32_t>> sequences(config.num_threads);
+  run_threads(config.num_threads, config.num_records, [&](std::size_t t, std::size_t records) {
+    std::mt19937_64 engine{ t + 1 };
+    sequences[t].resize(records);
+    for (auto& index : sequences[t]) {
+      index = static_cast<std::uint32_t>(distribution.next(engine));
+    }
+  });
+
+  // Both passes touch the same keys in the same order, so only record() differs.  They
+  // run one after the other, and with more threads than cores the wall time of a pass
+  // is CPU time divided by the cores in use.
+  std::atomic_size_t checksum{ 0 };
+  const auto timed_pass = [&](bool record) {
+    const auto start = std::chrono::steady_clock::now();
+    run_threads(config.num_threads, config.num_records, [&](std::size_t t, std::size_t) {
+      std::size_t sum{ 0 };
+      for (const auto index : sequences[t]) {
+        if (record) {
+          detector.record(keys[index]);
+        }
+        sum += keys[index].size();
+      }
+      checksum += sum;
+    });
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+      .count();
+  };
+  const auto without = timed_pass(false);
+  const auto with = timed_pass(true);
+  if (config.num_records == 0 || checksum == 0) {
+    return 0;
+  }
+  const auto cores =
+    std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, config.num_threads);
+  return std::max(with - without, 0.0) * static_cast<double>(cores) /
+         static_cast<double>(config.num_records);
+}
+
+// Runs the gets of one end-to-end round and returns operations per second.
+template<typename Collection>
+auto
+run_gets(const program_config& config,
+         const Collection& collection,
+         const key_distribution& distribution,
+         std::uint64_t seed,
+         std::atomic_uint64_t& errors) -> double
+{
+  const auto start = std::chrono::steady_clock::now();
+  run_threads(config.num_threads, config.num_operations, [&](std::size_t t, std::size_t ops) {
+    std::mt19937_64 engine{ seed + t };
+    for (std::size_t i = 0; i < ops; ++i) {
+      auto [err, resp] = collection.get(make_key(distribution.next(engine))).get();
+      if (err.ec()) {
+        ++errors;
+      }
+    }
+  });
+  const auto seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return seconds > 0 ? static_cast<double>(config.num_operations) / seconds : 0;
+}
+
+void
+print_hot_keys(const hot_key_snapshot& snapshot)
+{
+  std::cout << "  hottest keys in the last " << snapshot.window.count() << "ms ("
+            << snapshot.accesses << " accesses):\n";
+  for (std::size_t rank = 0; rank < snapshot.keys.size(); ++rank) {
+    const auto& key = snapshot.keys[rank];
+    std::cout << "    " << std::setw(2) << rank + 1 << ". " << std::left << std::setw(16)
+              << key.key << std::right << std::setw(10) << key.accesses << "  "
+              << std::setprecision(2) << key.share * 100 << "%\n";
+  }
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  hot_key_detector_options detector_options{};
+  detector_options.top_k = config.top_k;
+
+  std::cout << std::fixed;
+  {
+    // Merging is part of the cost, so the detector runs with its usual merge interval.
+    hot_key_detector detector{ detector_options };
+    const auto cost = measure_record_cost(config, detector);
+    const auto share = cost * config.target_rate / 1e9;
+    std::cout << "record(): " << std::setprecision(1) << cost << "ns per access, "
+              << std::setprecision(3) << share * 100 << "% of one core at "
+              << std::setprecision(0) << config.target_rate << " ops/s"
+              << (share < 0.01 ? " (within the 1% budget)" : " (OVER the 1% budget)") << "\n";
+    print_hot_keys(detector.merge());
+    std::cout << "  the true hottest keys are " << make_key(0) << ", " << make_key(1)
+              << ", " << make_key(2) << ", ...\n";
+  }
+
+  if (config.num_documents > 0 && config.num_operations > 0) {
+    std::vector<std::pair<std::string, tao::json::value>> documents;
+    documents.reserve(config.num_documents);
+    for (std::size_t i = 0; i < config.num_documents; ++i) {
+      documents.emplace_back(make_key(i), tao::json::value{ { "quantity", i } });
+    }
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : upsert_multi(collection, documents)) {
+      if (entry.error.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "Seeded " << config.num_documents - failed << " documents (" << failed
+              << " failed)\n";
+
+    hot_key_detector detector{ detector_options };
+    const hot_key_tracking_collection tracked{ collection, detector };
+    const auto distribution = key_distribution::zipfian(config.num_documents, config.zipf_theta);
+    std::atomic_uint64_t errors{ 0 };
+    double plain_rate{ 0 };
+    double tracked_rate{ 0 };
+    for (std::size_t round = 0; round < config.rounds; ++round) {
+      plain_rate = std::max(plain_rate, run_gets(config, collection, distribution, round, errors));
+      tracked_rate =
+        std::max(tracked_rate, run_gets(config, tracked, distribution, round, errors));
+    }
+    std::cout << std::setprecision(0) << "get: " << plain_rate << " ops/s plain, "
+              << tracked_rate << " ops/s tracked (best of " << config.rounds << " rounds, "
+              << std::setprecision(2)
+              << (plain_rate > 0 ? (plain_rate - tracked_rate) / plain_rate * 100 : 0.0)
+              << "% slower, " << errors << " errors)\n";
+    print_hot_keys(detector.merge());
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_KEYS"); val != nullptr) {
+    config.num_keys = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_RECORDS"); val != nullptr) {
+    config.num_records = std::stoul(val);
+  }
+  if (const auto* val = getenv("TARGET_RATE"); val != nullptr) {
+    config.target_rate = std::stod(val);
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::stoul(val);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("ROUNDS"); val != nullptr) {
+    config.rounds = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("TOP_K"); val != nullptr) {
+    config.top_k = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "           NUM_KEYS: " << num_keys << "\n";
+  std::cout << "        NUM_RECORDS: " << num_records << "\n";
+  std::cout << "        TARGET_RATE: " << target_rate << "\n";
+  std::cout << "      NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "     NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "             ROUNDS: " << rounds << "\n";
+  std::cout << "         ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "              TOP_K: " << top_k << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,506 @@
+/*
+ * hot_key_detector — finds the most frequently accessed document keys of this client
+ *
+ * Hot keys usually show up first as one struggling node.  hot_key_detector counts key
+ * accesses in the client so the culprits can be named while it happens: record(key) is
+ * called for every operation (hot_key_tracking_collection below does it for the usual
+ * KV calls), and snapshot() returns the top_k keys of the last merge_interval with
+ * their estimated access counts.
+ *
+ * Every thread records into its own shard, so the hot path never contends with other
+ * threads: one hash of the key, an uncontended lock, `sketch_depth` counter increments
+ * and, for most keys, a single comparison.  A shard holds
+ *
+ *   - a count-min sketch: sketch_depth rows of sketch_width counters.  A key increments
+ *     one counter per row, and its estimate is the smallest of them — never below the
+ *     true count, and above it by at most 2N / sketch_width with high probability, for
+ *     N accesses in the window.
+ *   - a space-saving style top-K list of (key, estimate) candidates.  A key that is not
+ *     yet listed only replaces the weakest candidate once its sketch estimate exceeds
+ *     that candidate's count, so the long tail of cold keys never touches the list (or
+ *     allocates a string) at all.
+ *
+ * A background thread merges the shards every merge_interval: it adds all sketches
+ * into one, re-estimates the union of the per-thread candidates against it, keeps the
+ * top_k and resets the shards for the next window.  Counts are therefore per window,
+ * not since start, so keys that cool down drop out of the list again.
+ *
+ * A shard lives as long as its thread.  When a thread that recorded keys exits, its
+ * shard is folded into one retired shard, which the next merge counts like any other,
+ * and removed from the detector, so short-lived threads neither leak shards nor slow
+ * down the merges.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class count_min_sketch
+{
+public:
+  // `width` is rounded up to a power of two.
+  count_min_sketch(std::size_t width, std::size_t depth)
+    : mask_{ round_up_to_power_of_two(std::max<std::size_t>(width, 2)) - 1 }
+    , depth_{ std::max<std::size_t>(depth, 1) }
+    , counters_((mask_ + 1) * depth_, 0)
+  {
+  }
+
+  // Counts one more access of the key with `hash` and returns its new estimate.
+  auto add(std::uint64_t hash) -> std::uint64_t
+  {
+    auto estimate = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t row = 0; row < depth_; ++row) {
+      auto& counter = counters_[slot(hash, row)];
+      ++counter;
+      estimate = std::min<std::uint64_t>(estimate, counter);
+    }
+    return estimate;
+  }
+
+  [[nodiscard]] auto estimate(std::uint64_t hash) const -> std::uint64_t
+  {
+    auto estimate = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t row = 0; row < depth_; ++row) {
+      estimate = std::min<std::uint64_t>(estimate, counters_[slot(hash, row)]);
+    }
+    return estimate;
+  }
+
+  // Adds the counts of `other`, which must have the same dimensions.
+  void merge(const count_min_sketch& other)
+  {
+    for (std::size_t i = 0; i < counters_.size(); ++i) {
+      counters_[i] += other.counters_[i];
+    }
+  }
+
+  void clear()
+  {
+    std::fill(counters_.begin(), counters_.end(), 0);
+  }
+
+private:
+  static auto round_up_to_power_of_two(std::size_t value) -> std::size_t
+  {
+    std::size_t result{ 1 };
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  // Each row needs its own hash function.  Deriving the rows from one hash as h1 + i * h2
+  // leaves too few distinct row patterns for narrow sketches (keys that agree on both
+  // halves collide in every row), so every row re-mixes the key hash with its own seed
+  // using MurmurHash3's fmix64.  That is a few multiplications, cheaper than hashing the
+  // key again.
+  [[nodiscard]] auto slot(std::uint64_t hash, std::size_t row) const -> std::size_t
+  {
+    hash += (row + 1) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return row * (mask_ + 1) + static_cast<std::size_t>(hash & mask_);
+  }
+
+  std::size_t mask_;
+  std::size_t depth_;
+  std::vector<std::uint32_t> counters_;
+};
+
+struct hot_key_detector_options {
+  std::size_t top_k{ 10 };
+  std::size_t sketch_width{ 2048 };
+  std::size_t sketch_depth{ 4 };
+  std::chrono::milliseconds merge_interval{ std::chrono::seconds{ 1 } };
+};
+
+struct hot_key {
+  std::string key{};
+  std::uint64_t accesses{ 0 }; // estimate for the window, never below the true count
+  double rate{ 0 };            // accesses per second
+  double share{ 0 };           // fraction of all recorded accesses in the window
+};
+
+struct hot_key_snapshot {
+  std::chrono::milliseconds window{ 0 };
+  std::uint64_t accesses{ 0 }; // all keys
+  std::vector<hot_key> keys{}; // hottest first
+};
+
+class hot_key_detector
+{
+public:
+  explicit hot_key_detector(hot_key_detector_options options = {})
+    : options_{ options }
+    , merged_{ options.sketch_width, options.sketch_depth }
+    , merger_{ [this] {
+      run_merger();
+    } }
+  {
+  }
+
+  hot_key_detector(const hot_key_detector&) = delete;
+  auto operator=(const hot_key_detector&) -> hot_key_detector& = delete;
+
+  ~hot_key_detector()
+  {
+    {
+      const std::scoped_lock lock(stop_mutex_);
+      stopped_ = true;
+      stop_cv_.notify_all();
+    }
+    merger_.join();
+  }
+
+  // Counts one access of `key`.  Safe to call from any thread, including SDK I/O threads.
+  void record(std::string_view key)
+  {
+    const auto hash = std::hash<std::string_view>{}(key);
+    auto& shard = local_shard();
+    const std::scoped_lock lock(shard.mutex);
+    ++shard.accesses;
+    shard.candidates.offer(hash, shard.sketch.add(hash), key);
+  }
+
+  // The result of the last merge.
+  [[nodiscard]] auto snapshot() const -> hot_key_snapshot
+  {
+    const std::scoped_lock lock(snapshot_mutex_);
+    return snapshot_;
+  }
+
+  // Closes the current window now instead of at the next merge_interval.
+  auto merge() -> hot_key_snapshot
+  {
+    const std::scoped_lock merge_lock(merge_mutex_);
+
+    std::vector<std::shared_ptr<shard>> shards;
+    {
+      const std::scoped_lock lock(registry_->mutex);
+      shards = registry_->shards;
+      shards.push_back(registry_->retired);
+    }
+    merged_.clear();
+    std::unordered_map<std::uint64_t, std::string> candidates;
+    hot_key_snapshot result{};
+    for (const auto& shard : shards) {
+      const std::scoped_lock lock(shard->mutex);
+      merged_.merge(shard->sketch);
+      shard->sketch.clear();
+      result.accesses += shard->accesses;
+      shard->accesses = 0;
+      for (auto& candidate : shard->candidates.entries) {
+        candidates.try_emplace(candidate.hash, std::move(candidate.key));
+      }
+      shard->candidates.clear();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    result.window = std::chrono::duration_cast<std::chrono::milliseconds>(now - window_start_);
+    window_start_ = now;
+    const auto seconds = std::chrono::duration<double>(result.window).count();
+
+    for (auto& [hash, key] : candidates) {
+      hot_key entry{ std::move(key), merged_.estimate(hash) };
+      entry.rate = seconds > 0 ? static_cast<double>(entry.accesses) / seconds : 0;
+      entry.share = result.accesses > 0
+                      ? static_cast<double>(entry.accesses) / static_cast<double>(result.accesses)
+                      : 0;
+      result.keys.emplace_back(std::move(entry));
+    }
+    std::sort(result.keys.begin(), result.keys.end(), [](const auto& a, const auto& b) {
+      return a.accesses > b.accesses;
+    });
+    if (result.keys.size() > options_.top_k) {
+      result.keys.resize(options_.top_k);
+    }
+
+    const std::scoped_lock lock(snapshot_mutex_);
+    snapshot_ = result;
+    return result;
+  }
+
+private:
+  // Up to `capacity` keys with the highest sketch estimates seen by one thread.
+  struct candidate_list {
+    struct entry {
+      std::uint64_t hash;
+      std::uint64_t count;
+      std::string key;
+    };
+
+    void offer(std::uint64_t hash, std::uint64_t estimate, std::string_view key)
+    {
+      // Estimates only grow, so a listed key with a count of at least `min_count` would
+      // already be at `estimate`: nothing to do for the cold majority.
+      if (entries.size() == capacity && estimate <= min_count) {
+        return;
+      }
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].hash == hash) {
+          entries[i].count = estimate;
+          if (i == min_index) {
+            update_min();
+          }
+          return;
+        }
+      }
+      if (entries.size() < capacity) {
+        entries.push_back({ hash, estimate, std::string{ key } });
+      } else {
+        auto& weakest = entries[min_index];
+        weakest.hash = hash;
+        weakest.count = estimate;
+        weakest.key.assign(key);
+      }
+      update_min();
+    }
+
+    void update_min()
+    {
+      min_index = 0;
+      for (std::size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].count < entries[min_index].count) {
+          min_index = i;
+        }
+      }
+      min_count = entries.empty() ? 0 : entries[min_index].count;
+    }
+
+    void clear()
+    {
+      entries.clear();
+      min_index = 0;
+      min_count = 0;
+    }
+
+    std::size_t capacity;
+    std::vector<entry> entries{};
+    std::size_t min_index{ 0 };
+    std::uint64_t min_count{ 0 };
+  };
+
+  struct shard {
+    explicit shard(const hot_key_detector_options& options)
+      : sketch{ options.sketch_width, options.sketch_depth }
+      , candidates{ std::max<std::size_t>(options.top_k, 1) }
+    {
+    }
+
+    // Moves the counts of `other` into this shard.  Both mutexes must be held.
+    void absorb(shard& other)
+    {
+      sketch.merge(other.sketch);
+      other.sketch.clear();
+      accesses += other.accesses;
+      other.accesses = 0;
+      for (const auto& candidate : other.candidates.entries) {
+        candidates.offer(candidate.hash, sketch.estimate(candidate.hash), candidate.key);
+      }
+      other.candidates.clear();
+    }
+
+    std::mutex mutex{}; // taken by the owning thread, and by merge() once per window
+    count_min_sketch sketch;
+    candidate_list candidates;
+    std::uint64_t accesses{ 0 };
+  };
+
+  // The shards of the live threads, and the counts left behind by the threads that have
+  // exited since the last merge.  Shared with those threads, which may outlive the
+  // detector.
+  struct shard_registry {
+    explicit shard_registry(const hot_key_detector_options& options)
+      : retired{ std::make_shared<shard>(options) }
+    {
+    }
+
+    // Called when the thread owning `s` exits.  A merge that already copied the shard
+    // list finds `s` empty, so no access is counted twice; at worst the last counts of
+    // the thread show up one window late.
+    void retire(const std::shared_ptr<shard>& s)
+    {
+      const std::scoped_lock lock(mutex, retired->mutex, s->mutex);
+      shards.erase(std::remove(shards.begin(), shards.end(), s), shards.end());
+      retired->absorb(*s);
+    }
+
+    std::mutex mutex{};
+    std::vector<std::shared_ptr<shard>> shards{};
+    std::shared_ptr<shard> retired;
+  };
+
+  // The shards of one thread, one per detector it has recorded into.  Retires them when
+  // the thread exits.
+  struct local_shards {
+    struct entry {
+      std::uint64_t id;
+      std::weak_ptr<shard_registry> registry;
+      std::shared_ptr<shard> owned;
+    };
+
+    local_shards() = default;
+    local_shards(const local_shards&) = delete;
+    auto operator=(const local_shards&) -> local_shards& = delete;
+
+    ~local_shards()
+    {
+      for (const auto& e : entries) {
+        if (auto registry = e.registry.lock()) {
+          registry->retire(e.owned);
+        }
+      }
+    }
+
+    std::vector<entry> entries{};
+  };
+
+  auto local_shard() -> shard&
+  {
+    thread_local local_shards local;
+    for (const auto& e : local.entries) {
+      if (e.id == id_) {
+        return *e.owned;
+      }
+    }
+    local.entries.erase(std::remove_if(local.entries.begin(),
+                                       local.entries.end(),
+                                       [](const auto& e) {
+                                         return e.registry.expired(); // detector is gone
+                                       }),
+                        local.entries.end());
+    auto s = std::make_shared<shard>(options_);
+    {
+      const std::scoped_lock lock(registry_->mutex);
+      registry_->shards.push_back(s);
+    }
+    local.entries.push_back({ id_, registry_, s });
+    return *s;
+  }
+
+  void run_merger()
+  {
+    std::unique_lock lock(stop_mutex_);
+    while (!stop_cv_.wait_for(lock, options_.merge_interval, [this] {
+      return stopped_;
+    })) {
+      lock.unlock();
+      merge();
+      lock.lock();
+    }
+  }
+
+  static auto next_id() -> std::uint64_t
+  {
+    static std::atomic_uint64_t id{ 0 };
+    return ++id;
+  }
+
+  const hot_key_detector_options options_;
+  const std::uint64_t id_{ next_id() };
+
+  const std::shared_ptr<shard_registry> registry_{ std::make_shared<shard_registry>(options_) };
+
+  std::mutex merge_mutex_{};
+  count_min_sketch merged_;
+  std::chrono::steady_clock::time_point window_start_{ std::chrono::steady_clock::now() };
+
+  mutable std::mutex snapshot_mutex_{};
+  hot_key_snapshot snapshot_{};
+
+  std::mutex stop_mutex_{};
+  std::condition_variable stop_cv_{};
+  bool stopped_{ false };
+  std::thread merger_; // last, so it starts after everything it uses
+};
+
+// Forwards the common KV operations to `collection` and records their keys in `detector`.
+// Takes the same arguments as the couchbase::collection methods of the same name, in
+// both their callback and future forms.
+class hot_key_tracking_collection
+{
+public:
+  hot_key_tracking_collection(couchbase::collection collection, hot_key_detector& detector)
+    : collection_{ std::move(collection) }
+    , detector_{ &detector }
+  {
+  }
+
+  [[nodiscard]] auto collection() const -> const couchbase::collection&
+  {
+    return collection_;
+  }
+
+  template<typename... Args>
+  auto get(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.get(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  auto lookup_in(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.lookup_in(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename... Args>
+  auto upsert(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.template upsert<Transcoder>(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename... Args>
+  auto insert(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.template insert<Transcoder>(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename... Args>
+  auto replace(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.template replace<Transcoder>(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  auto mutate_in(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.mutate_in(std::move(id), std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  auto remove(std::string id, Args&&... args) const
+  {
+    detector_->record(id);
+    return collection_.remove(std::move(id), std::forward<Args>(args)...);
+  }
+
+private:
+  couchbase::collection collection_;
+  hot_key_detector* detector_;
+};
@@ -0,0 +1,414 @@
+/*
+ * hot_keys_with_opentelemetry — publishing the client's hottest keys as OpenTelemetry gauges
+ *
+ * The SDK's operation metrics say how fast a collection is, not which documents make it
+ * slow.  This program routes its KV traffic through hot_key_tracking_collection
+ * (hot_key_detector.hxx), which counts every key in per-thread count-min sketches, and
+ * publishes the top keys of each HOT_KEY_WINDOW_MS window next to the SDK metrics on
+ * the "hot-key-service" meter:
+ *
+ *   hot_keys.rate         gauge  accesses per second of each hot key, by key and rank
+ *   hot_keys.share        gauge  fraction of all accesses going to each hot key (0..1)
+ *   hot_keys.access_rate  gauge  accesses per second over all keys
+ *
+ * Only the top TOP_K keys are reported, which bounds the number of attribute sets per
+ * window; keys that drop out of the list simply stop being reported.
+ *
+ * NUM_THREADS threads run NUM_OPERATIONS gets and upserts of item documents chosen from
+ * a Zipfian distribution over NUM_ITEMS keys; every WRITE_EVERY-th operation of a thread
+ * is an upsert.  At the end the last window is printed.  The pipeline is the OTLP/HTTP
+ * one of inventory_with_opentelemetry.cpp, set up by opentelemetry_meter.hxx, so the
+ * same ./telemetry-cluster stack can be used to look at the gauges.  See
+ * hot_key_bench.cpp for the overhead of the detection itself.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_ITEMS          item documents (default: 10000)
+ *   NUM_THREADS        worker threads (default: 4)
+ *   NUM_OPERATIONS     operations across all threads (default: 40000)
+ *   WRITE_EVERY        every Nth operation of a thread is an upsert (default: 10)
+ *   ZIPF_THETA         skew of item popularity (default: 0.99)
+ *   TOP_K              hot keys published per window (default: 10)
+ *   HOT_KEY_WINDOW_MS  length of a detection window (default: 1000)
+ *   OTEL_METRICS_ENDPOINT                   OTLP/HTTP endpoint
+ *                                           (default: http://localhost:4318/v1/metrics)
+ *   OTEL_METRICS_READER_EXPORT_INTERVAL_MS  export interval (default: 1000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <opentelemetry/metrics/provider.h>
+
+#include <tao/json.hpp>
+
+#include "hot_key_detector.hxx"
+#include "key_distribution.hxx"
+#include "opentelemetry_meter.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_items{ 10000 };
+  std::size_t num_threads{ 4 };
+  std::size_t num_operations{ 40000 };
+  std::size_t write_every{ 10 };
+  double zipf_theta{ 0.99 };
+  std::size_t top_k{ 10 };
+  std::chrono::milliseconds hot_key_window{ std::chrono::seconds{ 1 } };
+  std::optional<std::string> metrics_endpoint{};
+  std::chrono::milliseconds metrics_export_interval{ std::chrono::seconds{ 1 } };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+namespace
+{
+constexpr auto* k_service_name{ "hot-key-service" };
+constexpr auto* k_service_version{ "1.0.0" };
+
+using double_observer =
+  opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObserverResultT<double>>;
+
+// Observable-instrument callbacks run on the metric reader's thread; `state` is the
+// hot_key_detector the instruments were registered for in hot_key_instruments.  They
+// read the result of the last merge, so they never compete with the recording threads.
+void
+observe_rate(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  if (!opentelemetry::nostd::holds_alternative<double_observer>(result)) {
+    return;
+  }
+  const auto snapshot = static_cast<const hot_key_detector*>(state)->snapshot();
+  auto& observer = opentelemetry::nostd::get<double_observer>(result);
+  for (std::size_t rank = 0; rank < snapshot.keys.size(); ++rank) {
+    const auto& key = snapshot.keys[rank];
+    observer->Observe(key.rate,
+                      { { "key", opentelemetry::nostd::string_view{ key.key } },
+                        { "rank", static_cast<std::int64_t>(rank + 1) } });
+  }
+}
+
+void
+observe_share(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  if (!opentelemetry::nostd::holds_alternative<double_observer>(result)) {
+    return;
+  }
+  const auto snapshot = static_cast<const hot_key_detector*>(state)->snapshot();
+  auto& observer = opentelemetry::nostd::get<double_observer>(result);
+  for (std::size_t rank = 0; rank < snapshot.keys.size(); ++rank) {
+    const auto& key = snapshot.keys[rank];
+    observer->Observe(key.share,
+                      { { "key", opentelemetry::nostd::string_view{ key.key } },
+                        { "rank", static_cast<std::int64_t>(rank + 1) } });
+  }
+}
+
+void
+observe_access_rate(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  if (!opentelemetry::nostd::holds_alternative<double_observer>(result)) {
+    return;
+  }
+  const auto snapshot = static_cast<const hot_key_detector*>(state)->snapshot();
+  const auto seconds = std::chrono::duration<double>(snapshot.window).count();
+  opentelemetry::nostd::get<double_observer>(result)->Observe(
+    seconds > 0 ? static_cast<double>(snapshot.accesses) / seconds : 0.0);
+}
+
+// Keeps the observable instruments alive and detaches their callbacks from the detector
+// before it goes away.
+class hot_key_instruments
+{
+public:
+  explicit hot_key_instruments(hot_key_detector& detector)
+    : state_{ &detector }
+  {
+    auto meter = opentelemetry::metrics::Provider::GetMeterProvider()->GetMeter(
+      k_service_name, k_service_version);
+    add(meter->CreateDoubleObservableGauge(
+          "hot_keys.rate", "Accesses per second of the hottest keys", "{access}/s"),
+        observe_rate);
+    add(meter->CreateDoubleObservableGauge(
+          "hot_keys.share", "Fraction of all accesses going to each of the hottest keys", "1"),
+        observe_share);
+    add(meter->CreateDoubleObservableGauge(
+          "hot_keys.access_rate", "Accesses per second over all keys", "{access}/s"),
+        observe_access_rate);
+  }
+
+  hot_key_instruments(const hot_key_instruments&) = delete;
+  auto operator=(const hot_key_instruments&) -> hot_key_instruments& = delete;
+
+  ~hot_key_instruments()
+  {
+    for (auto& [instrument, callback] : instruments_) {
+      instrument->RemoveCallback(callback, state_);
+    }
+  }
+
+private:
+  using instrument_ptr =
+    opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>;
+
+  void add(instrument_ptr instrument, opentelemetry::metrics::ObservableCallbackPtr callback)
+  {
+    instrument->AddCallback(callback, state_);
+    instruments_.emplace_back(std::move(instrument), callback);
+  }
+
+  void* state_;
+  std::vector<std::pair<instrument_ptr, opentelemetry::metrics::ObservableCallbackPtr>>
+    instruments_{};
+};
+
+auto
+make_item_id(std::size_t index) -> std::string
+{
+  return "item::" + std::to_string(index);
+}
+
+struct worker_stats {
+  std::uint64_t gets{ 0 };
+  std::uint64_t upserts{ 0 };
+  std::uint64_t errors{ 0 };
+};
+
+auto
+run_worker(const program_config& config,
+           const hot_key_tracking_collection& collection,
+           const key_distribution& distribution,
+           std::size_t worker_index,
+           std::size_t operations) -> worker_stats
+{
+  worker_stats stats{};
+  std::mt19937_64 engine{ std::random_device{}() ^ worker_index };
+  for (std::size_t op = 1; op <= operations; ++op) {
+    const auto index = static_cast<std::size_t>(distribution.next(engine));
+    if (config.write_every > 0 && op % config.write_every == 0) {
+      ++stats.upserts;
+      const tao::json::value item{
+        { "name", "Item " + std::to_string(index) },
+        { "quantity", engine() % 1000 },
+      };
+      if (auto [err, resp] = collection.upsert(make_item_id(index), item).get(); err.ec()) {
+        ++stats.errors;
+      }
+      continue;
+    }
+    ++stats.gets;
+    // Items that have not been written yet are not found; those reads are load too and
+    // their keys are recorded all the same.
+    if (auto [err, resp] = collection.get(make_item_id(index)).get();
+        err.ec() && err.ec() != couchbase::errc::key_value::document_not_found) {
+      ++stats.errors;
+    }
+  }
+  return stats;
+}
+} // namespace
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+  // The meter must be installed before connect(); see inventory_with_opentelemetry.cpp.
+  auto meter_provider = apply_opentelemetry_meter_options(
+    options,
+    { k_service_name, k_service_version, config.metrics_endpoint, config.metrics_export_interval });
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  hot_key_detector_options detector_options{};
+  detector_options.top_k = config.top_k;
+  detector_options.merge_interval = config.hot_key_window;
+  hot_key_detector detector{ detector_options };
+  const hot_key_tracking_collection tracked{ collection, detector };
+  const auto distribution = key_distribution::zipfian(config.num_items, config.zipf_theta);
+
+  worker_stats total{};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    const hot_key_instruments instruments{ detector };
+
+    std::vector<worker_stats> per_worker(config.num_threads);
+    std::vector<std::thread> workers;
+    workers.reserve(config.num_threads);
+    for (std::size_t i = 0; i < config.num_threads; ++i) {
+      const auto operations = config.num_operations / config.num_threads +
+                              (i < config.num_operations % config.num_threads ? 1 : 0);
+      workers.emplace_back([&, i, operations] {
+        per_worker[i] = run_worker(config, tracked, distribution, i, operations);
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (const auto& stats : per_worker) {
+      total.gets += stats.gets;
+      total.upserts += stats.upserts;
+      total.errors += stats.errors;
+    }
+
+    // Close the last window and export it while the callbacks are still attached.
+    detector.merge();
+    meter_provider->ForceFlush();
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Operations: " << total.gets << " gets, " << total.upserts << " upserts, "
+            << total.errors << " errors in " << elapsed.count() << "s\n";
+  const auto snapshot = detector.snapshot();
+  std::cout << "Hottest keys of the last " << snapshot.window.count() << "ms window ("
+            << snapshot.accesses << " accesses):\n";
+  for (std::size_t rank = 0; rank < snapshot.keys.size(); ++rank) {
+    const auto& key = snapshot.keys[rank];
+    std::cout << "  " << std::setw(2) << rank + 1 << ". " << std::left << std::setw(16) << key.key
+              << std::right << std::setw(10) << key.rate << "/s  " << key.share * 100 << "%\n";
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_ITEMS"); val != nullptr) {
+    config.num_items = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("WRITE_EVERY"); val != nullptr) {
+    config.write_every = std::stoul(val);
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("TOP_K"); val != nullptr) {
+    config.top_k = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("HOT_KEY_WINDOW_MS"); val != nullptr) {
+    config.hot_key_window = std::chrono::milliseconds{ std::max<std::size_t>(std::stoul(val), 1) };
+  }
+  if (const auto* val = getenv("OTEL_METRICS_ENDPOINT"); val != nullptr) {
+    config.metrics_endpoint = val;
+  }
+  if (const auto* val = getenv("OTEL_METRICS_READER_EXPORT_INTERVAL_MS"); val != nullptr) {
+    config.metrics_export_interval = std::chrono::milliseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "                     CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "                             USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "                              PASSWORD: [HIDDEN]\n";
+  std::cout << "                           BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "                            SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "                       COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "                             NUM_ITEMS: " << num_items << "\n";
+  std::cout << "                           NUM_THREADS: " << num_threads << "\n";
+  std::cout << "                        NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "                           WRITE_EVERY: " << write_every << "\n";
+  std::cout << "                            ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "                                 TOP_K: " << top_k << "\n";
+  std::cout << "                     HOT_KEY_WINDOW_MS: " << hot_key_window.count() << "\n";
+  std::cout << "                 OTEL_METRICS_ENDPOINT: "
+            << (metrics_endpoint ? quote(*metrics_endpoint) : "[DEFAULT]") << "\n";
+  std::cout << "OTEL_METRICS_READER_EXPORT_INTERVAL_MS: " << metrics_export_interval.count()
+            << "\n";
+  std::cout << "                               VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "                               PROFILE: " << (profile ? quote(*profile) : "[NONE]")
+            << "\n\n";
+}
@@ -0,0 +1,162 @@
+/*
+ * inventory_delta — sub-document updates for inventory item documents
+ *
+ * Inventory items are JSON documents of the form
+ *
+ *   { "name": ..., "sku": ..., "category": ..., "quantity": <integer>, "price": ... }
+ *
+ * often with much larger descriptive fields next to them.  Changing the quantity by
+ * upserting the whole item sends every byte of the document for a change of a few
+ * bytes, and a CAS-checked read-modify-write fetches and decodes all of it as well.
+ *
+ * apply_inventory_update() expresses the change as a mutate_in instead: the quantity is
+ * adjusted with a server-side counter operation (atomic, so no CAS is needed) and the
+ * other fields that change are replaced by path.  Only the spec paths and new values go
+ * over the wire.  When the counter is part of the update, the new quantity is returned
+ * as the content of spec 0 of the mutate_in_result.  A quantity_delta of INT64_MIN has
+ * no positive counterpart to decrement by and fails with invalid_argument.
+ *
+ * reserve_stock() covers changes that depend on the current value (take `amount` units
+ * only if that many are available).  It reads just the quantity with lookup_in and
+ * writes the new value with a CAS-guarded mutate_in, retrying from the lookup when
+ * another writer got in first, so each retry costs two small round trips instead of a
+ * full get and replace.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+struct inventory_update {
+  std::int64_t quantity_delta{ 0 };
+  std::optional<double> price{};
+  std::optional<std::string> name{};
+  std::optional<std::string> category{};
+
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return quantity_delta == 0 && !price && !name && !category;
+  }
+
+  // The counter specs take the magnitude of the delta as a positive int64_t, which
+  // INT64_MIN does not have.
+  [[nodiscard]] auto valid() const -> bool
+  {
+    return quantity_delta != std::numeric_limits<std::int64_t>::min();
+  }
+};
+
+// The update must be valid() and not empty(): a mutate_in needs at least one spec.
+inline auto
+make_inventory_specs(const inventory_update& update) -> couchbase::mutate_in_specs
+{
+  couchbase::mutate_in_specs specs{};
+  if (update.quantity_delta > 0) {
+    specs.push_back(couchbase::mutate_in_specs::increment("quantity", update.quantity_delta));
+  } else if (update.quantity_delta < 0) {
+    specs.push_back(couchbase::mutate_in_specs::decrement("quantity", -update.quantity_delta));
+  }
+  if (update.price) {
+    specs.push_back(couchbase::mutate_in_specs::replace("price", *update.price));
+  }
+  if (update.name) {
+    specs.push_back(couchbase::mutate_in_specs::replace("name", *update.name));
+  }
+  if (update.category) {
+    specs.push_back(couchbase::mutate_in_specs::replace("category", *update.category));
+  }
+  return specs;
+}
+
+inline void
+apply_inventory_update(const couchbase::collection& collection,
+                       std::string id,
+                       const inventory_update& update,
+                       const couchbase::mutate_in_options& options,
+                       couchbase::mutate_in_handler&& handler)
+{
+  if (!update.valid()) {
+    return handler(couchbase::error{ couchbase::errc::common::invalid_argument,
+                                     "apply_inventory_update: quantity_delta out of range" },
+                   {});
+  }
+  collection.mutate_in(std::move(id), make_inventory_specs(update), options, std::move(handler));
+}
+
+inline auto
+apply_inventory_update(const couchbase::collection& collection,
+                       std::string id,
+                       const inventory_update& update,
+                       const couchbase::mutate_in_options& options = {})
+  -> std::future<std::pair<couchbase::error, couchbase::mutate_in_result>>
+{
+  auto barrier =
+    std::make_shared<std::promise<std::pair<couchbase::error, couchbase::mutate_in_result>>>();
+  auto future = barrier->get_future();
+  apply_inventory_update(
+    collection, std::move(id), update, options, [barrier](auto err, auto resp) {
+      barrier->set_value({ std::move(err), std::move(resp) });
+    });
+  return future;
+}
+
+struct reserve_stock_result {
+  couchbase::error error{};
+  bool reserved{ false };     // false when fewer than `amount` units were available
+  std::int64_t quantity{ 0 }; // quantity after the reservation (or the one seen)
+  std::size_t attempts{ 0 };  // lookup/mutate rounds, 1 without contention
+};
+
+// Takes `amount` units of item `id` if at least that many are in stock.  Gives up with
+// the cas_mismatch error after `max_attempts` rounds lost to concurrent writers.
+inline auto
+reserve_stock(const couchbase::collection& collection,
+              const std::string& id,
+              std::int64_t amount,
+              std::size_t max_attempts = 16) -> reserve_stock_result
+{
+  reserve_stock_result result{};
+  while (result.attempts < max_attempts) {
+    ++result.attempts;
+    auto [lookup_err, current] =
+      collection
+        .lookup_in(id, couchbase::lookup_in_specs{ couchbase::lookup_in_specs::get("quantity") })
+        .get();
+    if (lookup_err.ec()) {
+      result.error = lookup_err;
+      return result;
+    }
+    result.quantity = current.content_as<std::int64_t>(0);
+    if (result.quantity < amount) {
+      return result;
+    }
+
+    auto [mutate_err, resp] =
+      collection
+        .mutate_in(id,
+                   couchbase::mutate_in_specs{ couchbase::mutate_in_specs::replace(
+                     "quantity", result.quantity - amount) },
+                   couchbase::mutate_in_options{}.cas(current.cas()))
+        .get();
+    if (mutate_err.ec() == couchbase::errc::common::cas_mismatch) {
+      continue;
+    }
+    result.error = mutate_err;
+    if (!mutate_err.ec()) {
+      result.reserved = true;
+      result.quantity -= amount;
+    }
+    return result;
+  }
+  result.error = couchbase::error{ couchbase::errc::common::cas_mismatch,
+                                   "reserve_stock: too many concurrent updates" };
+  return result;
+}
@@ -0,0 +1,369 @@
+/*
+ * inventory_delta_bench — full-document upserts vs sub-document deltas for inventory items
+ *
+ * The inventory loop in inventory_with_opentelemetry.cpp upserts the whole item even
+ * when only its quantity changes.  This benchmark measures what that costs as items
+ * grow: for every size in DOCUMENT_SIZES it creates one item whose "description" pads
+ * it to that size and times OPS_PER_SIZE quantity changes made four ways:
+ *
+ *   upsert         blind full-document upsert of the item with the new quantity
+ *   subdoc         apply_inventory_update() — a mutate_in counter on "quantity"
+ *   get+replace    CAS read-modify-write of the full document (get, decode, replace)
+ *   lookup+mutate  reserve_stock() — lookup_in of "quantity", CAS-guarded mutate_in
+ *
+ * The first two are blind writes; the last two are conditional (take one unit only if
+ * stock is left) and retry when their CAS is stale.  While the conditional phases run,
+ * CONTENDERS background threads keep incrementing a separate counter in the same item,
+ * so CAS conflicts actually happen; the "attempts" column shows how many rounds each
+ * change needed on average, and every round of get+replace moves the whole document
+ * twice.  Set CONTENDERS=0 to measure without conflicts.
+ *
+ * As in kv_bench, only one measured operation is outstanding at a time and latencies
+ * are reported in microseconds from a latency_histogram.  The item of each size is
+ * removed after its phases.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   DOCUMENT_SIZES   comma-separated item sizes in bytes (default: 1024,10240,102400)
+ *   OPS_PER_SIZE     measured changes per size and method (default: 200)
+ *   CONTENDERS       background writers during the CAS phases (default: 1)
+ *   KEY_PREFIX       document ID prefix (default: "inventory_delta_bench::")
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "inventory_delta.hxx"
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::vector<std::size_t> document_sizes{ 1024, 10240, 102400 };
+  std::size_t ops_per_size{ 200 };
+  std::size_t contenders{ 1 };
+  std::string key_prefix{ "inventory_delta_bench::" };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct method_result {
+  std::string method;
+  std::size_t document_size;
+  latency_histogram latency{};
+  std::uint64_t attempts{ 0 };
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+};
+
+constexpr std::int64_t initial_quantity{ 1'000'000'000 };
+
+auto
+make_item(const std::string& sku, std::size_t size, std::int64_t quantity) -> tao::json::value
+{
+  tao::json::value item{
+    { "name", "Widget Pro" }, { "sku", sku },     { "category", "widgets" },
+    { "quantity", quantity }, { "price", 29.99 }, { "views", 0 },
+  };
+  const auto encoded_size = tao::json::to_string(item).size() + 17; // ,"description":""
+  item["description"] = std::string(size > encoded_size ? size - encoded_size : 0, 'x');
+  return item;
+}
+
+// Times `change()` `count` times.  The callable returns the error of the change and the
+// number of attempts it took.
+template<typename Change>
+auto
+measure(const std::string& method, std::size_t size, std::size_t count, Change&& change)
+  -> method_result
+{
+  method_result result{ method, size };
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto [err, attempts] = change();
+    result.latency.record(std::chrono::steady_clock::now() - start);
+    result.attempts += attempts;
+    if (err.ec()) {
+      ++result.errors;
+      result.last_error = err.message();
+    }
+  }
+  return result;
+}
+
+// Keeps `count` threads incrementing "views" of `id` until destroyed.
+class contenders
+{
+public:
+  contenders(const couchbase::collection& collection, std::string id, std::size_t count)
+  {
+    for (std::size_t i = 0; i < count; ++i) {
+      threads_.emplace_back([this, &collection, id] {
+        while (!stop_) {
+          collection
+            .mutate_in(id,
+                       couchbase::mutate_in_specs{
+                         couchbase::mutate_in_specs::increment("views", 1) })
+            .get();
+        }
+      });
+    }
+  }
+
+  contenders(const contenders&) = delete;
+  auto operator=(const contenders&) -> contenders& = delete;
+
+  ~contenders()
+  {
+    stop_ = true;
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+private:
+  std::atomic_bool stop_{ false };
+  std::vector<std::thread> threads_{};
+};
+
+auto
+run_size(const couchbase::collection& collection, const program_config& config, std::size_t size)
+  -> std::vector<method_result>
+{
+  const auto id = config.key_prefix + std::to_string(size);
+  const auto sku = "WIDGET-" + std::to_string(size);
+  std::vector<method_result> results;
+  if (auto [err, resp] = collection.upsert(id, make_item(sku, size, initial_quantity)).get();
+      err.ec()) {
+    std::cout << "Unable to create " << program_config::quote(id) << ": " << err.message()
+              << "\n";
+    return results;
+  }
+
+  // The blind upsert knows the quantity it writes; the body is built outside the timer,
+  // as an application holding the item would.
+  std::int64_t quantity{ initial_quantity };
+  results.emplace_back(measure("upsert", size, config.ops_per_size, [&] {
+    const auto item = make_item(sku, size, --quantity);
+    return std::pair{ collection.upsert(id, item).get().first, std::uint64_t{ 1 } };
+  }));
+  results.emplace_back(measure("subdoc", size, config.ops_per_size, [&] {
+    return std::pair{ apply_inventory_update(collection, id, { -1 }).get().first,
+                      std::uint64_t{ 1 } };
+  }));
+
+  {
+    const contenders background{ collection, id, config.contenders };
+    results.emplace_back(measure("get+replace", size, config.ops_per_size, [&] {
+      std::uint64_t attempts{ 0 };
+      while (true) {
+        ++attempts;
+        auto [get_err, current] = collection.get(id, {}).get();
+        if (get_err.ec()) {
+          return std::pair{ get_err, attempts };
+        }
+        auto item = current.content_as<tao::json::value>();
+        const auto available = item.at("quantity").as<std::int64_t>();
+        if (available < 1) {
+          return std::pair{ couchbase::error{}, attempts };
+        }
+        item["quantity"] = available - 1;
+        auto [replace_err, resp] =
+          collection.replace(id, item, couchbase::replace_options{}.cas(current.cas())).get();
+        if (replace_err.ec() != couchbase::errc::common::cas_mismatch) {
+          return std::pair{ replace_err, attempts };
+        }
+      }
+    }));
+    results.emplace_back(measure("lookup+mutate", size, config.ops_per_size, [&] {
+      const auto reservation = reserve_stock(collection, id, 1);
+      return std::pair{ reservation.error, std::uint64_t{ reservation.attempts } };
+    }));
+  }
+
+  collection.remove(id, {}).get();
+  return results;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_table(const std::vector<method_result>& results)
+{
+  std::cout << "latencies in microseconds\n";
+  std::cout << std::setw(14) << "method" << std::setw(10) << "size" << std::setw(8) << "count"
+            << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(10) << "max" << std::setw(10) << "attempts" << std::setw(8) << "errors"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto& r : results) {
+    const auto& h = r.latency;
+    const auto attempts =
+      h.count() > 0 ? static_cast<double>(r.attempts) / static_cast<double>(h.count()) : 0.0;
+    std::cout << std::setw(14) << r.method << std::setw(10) << r.document_size << std::setw(8)
+              << h.count() << std::setw(10) << to_micros(h.mean()) << std::setw(10)
+              << to_micros(h.value_at_percentile(50)) << std::setw(10)
+              << to_micros(h.value_at_percentile(99)) << std::setw(10) << to_micros(h.max())
+              << std::setw(10) << std::setprecision(2) << attempts << std::setprecision(1)
+              << std::setw(8) << r.errors << "\n";
+    if (!r.last_error.empty()) {
+      std::cout << "          last error: " << r.last_error << "\n";
+    }
+  }
+  std::cout << "\n";
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  std::vector<method_result> results;
+  for (const auto size : config.document_sizes) {
+    for (auto& result : run_size(collection, config, size)) {
+      results.emplace_back(std::move(result));
+    }
+  }
+
+  print_table(results);
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZES"); val != nullptr) {
+    config.document_sizes.clear();
+    std::istringstream input(val);
+    std::string size;
+    while (std::getline(input, size, ',')) {
+      if (!size.empty()) {
+        config.document_sizes.emplace_back(std::stoul(size));
+      }
+    }
+  }
+  if (const auto* val = getenv("OPS_PER_SIZE"); val != nullptr) {
+    config.ops_per_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("CONTENDERS"); val != nullptr) {
+    config.contenders = std::stoul(val);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string sizes;
+  for (const auto size : document_sizes) {
+    sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "     DOCUMENT_SIZES: " << sizes << "\n";
+  std::cout << "       OPS_PER_SIZE: " << ops_per_size << "\n";
+  std::cout << "         CONTENDERS: " << contenders << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -108,6 +108,12 @@
  *      OTEL_VERBOSE=true  — print OTel SDK internal warnings/errors to stderr
  *      VERBOSE=true       — enable Couchbase SDK trace-level logging to stderr
  *
+ *    Workload shape:
+ *      NUM_ITERATIONS=1000 — number of upsert+get iterations
+ *      PIPELINE_DEPTH=1    — iterations kept in flight at once.  The default runs
+ *                            them strictly one after another; larger values switch
+ *                            to the pipelined mode described in main().
+ *
  * ============================================================================
  * Where to see the generated traces and metrics
  * ============================================================================
@@ -190,9 +196,12 @@
 
 #include <tao/json.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
 namespace
@@ -411,6 +420,10 @@ struct program_config {
   bool otel_verbose{ false };
   // Number of iterations to run the main upsert/get loop.  Env: NUM_ITERATIONS  (default: 1000)
   std::size_t num_iterations{ 1000 };
+  // Maximum number of iterations in flight at once.  1 runs the loop sequentially with
+  // blocking .get() calls; larger values use the SDK's callback API to keep a window of
+  // iterations outstanding.  Env: PIPELINE_DEPTH  (default: 1)
+  std::size_t pipeline_depth{ 1 };
 
   opentelemetry_metrics_config metrics_config{};
   opentelemetry_traces_config traces_config{};
@@ -772,63 +785,161 @@ main()
       std::cout << "   " << std::flush;
     };
 
-    for (std::size_t iteration = 0; iteration < config.num_iterations; ++iteration) {
-      const std::string document_id{ "item::WIDGET-" + std::to_string(iteration) };
+    if (config.pipeline_depth <= 1) {
+      for (std::size_t iteration = 0; iteration < config.num_iterations; ++iteration) {
+        const std::string document_id{ "item::WIDGET-" + std::to_string(iteration) };
+
+        const auto iter_start = std::chrono::steady_clock::now();
+
+        auto top_span = tracer->StartSpan("update-inventory");
+
+        // WithActiveSpan sets top_span as the active span on the current thread's context.
+        // Any OTel-instrumented library called from this scope that does automatic
+        // context propagation will automatically use top_span as its parent.
+        auto scope = tracer->WithActiveSpan(top_span);
+
+        // otel_request_span bridges the OTel Span type to the
+        // couchbase::tracing::request_span interface expected by the SDK's parent_span option.
+        auto cb_parent = std::make_shared<couchbase::tracing::otel_request_span>(top_span);
+
+        {
+          const tao::json::value item{
+            { "name", "Widget Pro" }, { "sku", "WIDGET-001" }, { "category", "widgets" },
+            { "quantity", 42 },       { "price", 29.99 },
+          };
+
+          // parent_span(cb_parent) attaches this operation to the "update-inventory" trace.
+          // The SDK emits an "upsert" child span with "request_encoding" and
+          // "dispatch_to_server" grandchildren capturing serialization and the
+          // server round-trip duration.
+          auto [err, resp] =
+            collection.upsert(document_id, item, couchbase::upsert_options{}.parent_span(cb_parent))
+              .get();
+          if (err.ec()) {
+            ++error_count;
+            last_error = "upsert: " + err.message();
+          }
+        }
+        {
+          // Same parent span as the upsert: both operations appear under the same root
+          // trace in Jaeger, making it easy to see the full sequence at a glance.
+          // The SDK emits a "get" child span with a "dispatch_to_server" grandchild.
+          auto [err, resp] =
+            collection.get(document_id, couchbase::get_options{}.parent_span(cb_parent)).get();
+          if (err.ec()) {
+            ++error_count;
+            last_error = "get: " + err.message();
+          }
+        }
+
+        print_progress(iteration);
 
-      const auto iter_start = std::chrono::steady_clock::now();
+        // Mark the root span successful and close it.  The SDK child spans (upsert,
+        // get) are already ended by the time collection.upsert/get return.
+        top_span->SetStatus(opentelemetry::trace::StatusCode::kOk);
+        top_span->End();
 
-      auto top_span = tracer->StartSpan("update-inventory");
+        const auto iter_elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       std::chrono::steady_clock::now() - iter_start)
+                                       .count();
+        iteration_duration->Record(iter_elapsed_ms, opentelemetry::context::Context{});
+      }
+    } else {
+      // --- Pipelined mode (PIPELINE_DEPTH > 1) ---
+      // The sequential loop above waits for a full round trip per operation.  Here the
+      // callback overloads of upsert/get are used instead, and up to pipeline_depth
+      // iterations are kept outstanding: the main thread only blocks when the window is
+      // full.  Within one iteration the get is issued from the upsert's completion
+      // handler, so every read still observes the write of the same document.
+      //
+      // Each iteration keeps its own "update-inventory" root span.  Because completions
+      // run on SDK I/O threads, the span is ended — and the iteration duration recorded —
+      // in the get handler rather than on the main thread.
+      std::mutex window_mutex;
+      std::condition_variable window_cv;
+      std::size_t in_flight{ 0 };
+      std::size_t completed{ 0 };
+      std::size_t pipeline_error_count{ 0 };
+      std::string pipeline_last_error{};
+
+      const auto record_error = [&](std::string message) {
+        const std::scoped_lock lock(window_mutex);
+        ++pipeline_error_count;
+        pipeline_last_error = std::move(message);
+      };
+
+      // Must be called with window_mutex held: the shared counters are copied into the
+      // variables that print_progress reads.
+      const auto report_progress = [&]() {
+        error_count = pipeline_error_count;
+        last_error = pipeline_last_error;
+        if (completed > 0) {
+          print_progress(completed - 1);
+        }
+      };
+
+      for (std::size_t iteration = 0; iteration < config.num_iterations; ++iteration) {
+        {
+          std::unique_lock lock(window_mutex);
+          window_cv.wait(lock, [&] {
+            return in_flight < config.pipeline_depth;
+          });
+          ++in_flight;
+          report_progress();
+        }
 
-      // WithActiveSpan sets top_span as the active span on the current thread's context.
-      // Any OTel-instrumented library called from this scope that does automatic
-      // context propagation will automatically use top_span as its parent.
-      auto scope = tracer->WithActiveSpan(top_span);
+        const std::string document_id{ "item::WIDGET-" + std::to_string(iteration) };
+        const auto iter_start = std::chrono::steady_clock::now();
 
-      // otel_request_span bridges the OTel Span type to the
-      // couchbase::tracing::request_span interface expected by the SDK's parent_span option.
-      auto cb_parent = std::make_shared<couchbase::tracing::otel_request_span>(top_span);
+        auto top_span = tracer->StartSpan("update-inventory");
+        auto scope = tracer->WithActiveSpan(top_span);
+        auto cb_parent = std::make_shared<couchbase::tracing::otel_request_span>(top_span);
 
-      {
         const tao::json::value item{
           { "name", "Widget Pro" }, { "sku", "WIDGET-001" }, { "category", "widgets" },
           { "quantity", 42 },       { "price", 29.99 },
         };
 
-        // parent_span(cb_parent) attaches this operation to the "update-inventory" trace.
-        // The SDK emits an "upsert" child span with "request_encoding" and
-        // "dispatch_to_server" grandchildren capturing serialization and the
-        // server round-trip duration.
-        auto [err, resp] =
-          collection.upsert(document_id, item, couchbase::upsert_options{}.parent_span(cb_parent))
-            .get();
-        if (err.ec()) {
-          ++error_count;
-          last_error = "upsert: " + err.message();
-        }
-      }
-      {
-        // Same parent span as the upsert: both operations appear under the same root
-        // trace in Jaeger, making it easy to see the full sequence at a glance.
-        // The SDK emits a "get" child span with a "dispatch_to_server" grandchild.
-        auto [err, resp] =
-          collection.get(document_id, couchbase::get_options{}.parent_span(cb_parent)).get();
-        if (err.ec()) {
-          ++error_count;
-          last_error = "get: " + err.message();
-        }
+        collection.upsert(
+          document_id,
+          item,
+          couchbase::upsert_options{}.parent_span(cb_parent),
+          [&, document_id, top_span, cb_parent, iter_start](auto upsert_err, auto /* resp */) {
+            if (upsert_err.ec()) {
+              record_error("upsert: " + upsert_err.message());
+            }
+            collection.get(
+              document_id,
+              couchbase::get_options{}.parent_span(cb_parent),
+              [&, top_span, iter_start](auto get_err, auto /* resp */) {
+                if (get_err.ec()) {
+                  record_error("get: " + get_err.message());
+                }
+
+                top_span->SetStatus(opentelemetry::trace::StatusCode::kOk);
+                top_span->End();
+
+                const auto iter_elapsed_ms =
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - iter_start)
+                    .count();
+                iteration_duration->Record(iter_elapsed_ms, opentelemetry::context::Context{});
+
+                // Notify while still holding the mutex: once the main thread observes the
+                // last completion it leaves this scope and destroys window_cv.
+                const std::scoped_lock lock(window_mutex);
+                --in_flight;
+                ++completed;
+                window_cv.notify_all();
+              });
+          });
       }
 
-      print_progress(iteration);
-
-      // Mark the root span successful and close it.  The SDK child spans (upsert,
-      // get) are already ended by the time collection.upsert/get return.
-      top_span->SetStatus(opentelemetry::trace::StatusCode::kOk);
-      top_span->End();
-
-      const auto iter_elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                     std::chrono::steady_clock::now() - iter_start)
-                                     .count();
-      iteration_duration->Record(iter_elapsed_ms, opentelemetry::context::Context{});
+      std::unique_lock lock(window_mutex);
+      window_cv.wait(lock, [&] {
+        return completed == config.num_iterations;
+      });
+      report_progress();
     }
     std::cout << "\n";
   }
@@ -1002,6 +1113,9 @@ program_config::create_from_env() -> program_config
   if (const auto* val = getenv("NUM_ITERATIONS"); val != nullptr) {
     config.num_iterations = std::stoul(val);
   }
+  if (const auto* val = getenv("PIPELINE_DEPTH"); val != nullptr) {
+    config.pipeline_depth = std::max<std::size_t>(std::stoul(val), 1);
+  }
 
   opentelemetry_metrics_config::fill_from_env(config.metrics_config);
   opentelemetry_traces_config::fill_from_env(config.traces_config);
@@ -1021,6 +1135,7 @@ program_config::dump()
   std::cout << "          VERBOSE: " << std::boolalpha << verbose << "\n";
   std::cout << "     OTEL_VERBOSE: " << std::boolalpha << otel_verbose << "\n";
   std::cout << "   NUM_ITERATIONS: " << num_iterations << "\n";
+  std::cout << "   PIPELINE_DEPTH: " << pipeline_depth << "\n";
   std::cout << "          PROFILE: " << quote(profile) << "\n";
   std::cout << "\n";
 
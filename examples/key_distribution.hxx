@@ -0,0 +1,190 @@
+/*
+ * key_distribution — picks key indices in [0, key_space) for workload generators
+ *
+ *   uniform  every key is equally likely.
+ *   zipfian  key k is chosen with probability proportional to 1 / (k + 1)^theta.  Uses
+ *            the rejection-free method from Gray et al., "Quickly Generating
+ *            Billion-Record Synthetic Databases" (the YCSB generator), so next() is
+ *            O(1) after an O(key_space) setup.  theta = 0.99 matches YCSB's default;
+ *            with it roughly the hottest 1% of keys receives half the traffic.
+ *   hotspot  hot_op_fraction of the operations go to the first hot_set_fraction of
+ *            the key space, the rest to the remaining keys, both uniformly.
+ *
+ * Index 0 is always the hottest key.  next() is const and takes the caller's random
+ * engine, so one instance can be shared by any number of threads as long as each
+ * thread brings its own engine.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+enum class key_distribution_type {
+  uniform,
+  zipfian,
+  hotspot,
+};
+
+inline auto
+key_distribution_type_from_string(std::string_view name) -> std::optional<key_distribution_type>
+{
+  if (name == "uniform") {
+    return key_distribution_type::uniform;
+  }
+  if (name == "zipfian" || name == "zipf") {
+    return key_distribution_type::zipfian;
+  }
+  if (name == "hotspot") {
+    return key_distribution_type::hotspot;
+  }
+  return {};
+}
+
+inline auto
+to_string(key_distribution_type type) -> std::string
+{
+  switch (type) {
+    case key_distribution_type::uniform:
+      return "uniform";
+    case key_distribution_type::zipfian:
+      return "zipfian";
+    case key_distribution_type::hotspot:
+      return "hotspot";
+  }
+  return "unknown";
+}
+
+class key_distribution
+{
+public:
+  static auto uniform(std::uint64_t key_space) -> key_distribution
+  {
+    return { key_distribution_type::uniform, key_space };
+  }
+
+  static auto zipfian(std::uint64_t key_space, double theta = 0.99) -> key_distribution
+  {
+    // theta must stay below 1, where the generator's closed form breaks down
+    theta = std::clamp(theta, 0.0, 0.999);
+    key_distribution dist{ key_distribution_type::zipfian, key_space };
+    dist.theta_ = theta;
+    dist.zeta_n_ = zeta(dist.key_space_, theta);
+    const double zeta_2 = zeta(2, theta);
+    dist.alpha_ = 1.0 / (1.0 - theta);
+    dist.eta_ = (1.0 - std::pow(2.0 / static_cast<double>(dist.key_space_), 1.0 - theta)) /
+                (1.0 - zeta_2 / dist.zeta_n_);
+    return dist;
+  }
+
+  static auto hotspot(std::uint64_t key_space,
+                      double hot_set_fraction = 0.2,
+                      double hot_op_fraction = 0.8) -> key_distribution
+  {
+    key_distribution dist{ key_distribution_type::hotspot, key_space };
+    dist.hot_set_size_ = std::clamp<std::uint64_t>(
+      static_cast<std::uint64_t>(static_cast<double>(dist.key_space_) * hot_set_fraction),
+      1,
+      dist.key_space_);
+    dist.hot_op_fraction_ = std::clamp(hot_op_fraction, 0.0, 1.0);
+    return dist;
+  }
+
+  static auto create(key_distribution_type type, std::uint64_t key_space, double theta = 0.99)
+    -> key_distribution
+  {
+    switch (type) {
+      case key_distribution_type::zipfian:
+        return zipfian(key_space, theta);
+      case key_distribution_type::hotspot:
+        return hotspot(key_space);
+      case key_distribution_type::uniform:
+        break;
+    }
+    return uniform(key_space);
+  }
+
+  [[nodiscard]] auto type() const -> key_distribution_type
+  {
+    return type_;
+  }
+
+  [[nodiscard]] auto key_space() const -> std::uint64_t
+  {
+    return key_space_;
+  }
+
+  template<typename RandomEngine>
+  auto next(RandomEngine& engine) const -> std::uint64_t
+  {
+    switch (type_) {
+      case key_distribution_type::zipfian:
+        return next_zipfian(engine);
+      case key_distribution_type::hotspot:
+        return next_hotspot(engine);
+      case key_distribution_type::uniform:
+        break;
+    }
+    return std::uniform_int_distribution<std::uint64_t>(0, key_space_ - 1)(engine);
+  }
+
+private:
+  key_distribution(key_distribution_type type, std::uint64_t key_space)
+    : type_{ type }
+    , key_space_{ std::max<std::uint64_t>(key_space, 1) }
+  {
+  }
+
+  static auto zeta(std::uint64_t n, double theta) -> double
+  {
+    double sum{ 0 };
+    for (std::uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  template<typename RandomEngine>
+  auto next_zipfian(RandomEngine& engine) const -> std::uint64_t
+  {
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(engine);
+    const double uz = u * zeta_n_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return std::min<std::uint64_t>(1, key_space_ - 1);
+    }
+    const auto index = static_cast<std::uint64_t>(static_cast<double>(key_space_) *
+                                                  std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(index, key_space_ - 1);
+  }
+
+  template<typename RandomEngine>
+  auto next_hotspot(RandomEngine& engine) const -> std::uint64_t
+  {
+    const bool hot = std::uniform_real_distribution<double>(0.0, 1.0)(engine) < hot_op_fraction_;
+    if (hot || hot_set_size_ == key_space_) {
+      return std::uniform_int_distribution<std::uint64_t>(0, hot_set_size_ - 1)(engine);
+    }
+    return std::uniform_int_distribution<std::uint64_t>(hot_set_size_, key_space_ - 1)(engine);
+  }
+
+  key_distribution_type type_;
+  std::uint64_t key_space_;
+
+  // zipfian
+  double theta_{ 0 };
+  double zeta_n_{ 0 };
+  double alpha_{ 0 };
+  double eta_{ 0 };
+
+  // hotspot
+  std::uint64_t hot_set_size_{ 0 };
+  double hot_op_fraction_{ 0 };
+};
@@ -0,0 +1,363 @@
+/*
+ * kv_batch — vBucket-grouped batch gets vs get_multi() in arbitrary order
+ *
+ * Seeds NUM_DOCUMENTS documents, then reads them ROUNDS times in batches of BATCH_SIZE
+ * random IDs, alternating between get_multi() (kv_multi.hxx), which dispatches the
+ * batch in the order given, and get_batch() (kv_batch.hxx), which dispatches it grouped
+ * by vBucket.  Both use a window of WINDOW operations.  For each it prints the best
+ * throughput of all rounds and, per operation:
+ *
+ *   tcp out/in   TCP segments sent/received by the whole host (/proc/net/snmp); fewer
+ *                segments per operation means requests were packed more densely
+ *   csw          voluntary context switches of this process (/proc/self/status),
+ *                roughly one per wake-up of an I/O thread that found work
+ *
+ * Both are Linux-only and shown as "n/a" elsewhere; run the program on an otherwise
+ * quiet host, since the TCP counters are not per process.  For exact system call counts
+ * run it under `strace -f -c -e trace=network,epoll_wait`.
+ *
+ * On a single node every request goes to the same connection anyway, so the difference
+ * is small.  On several nodes it needs a BATCH_SIZE well above NUM_VBUCKETS (with the
+ * defaults a vBucket gets about one key per batch, and grouping does nothing), and a
+ * cluster whose nodes own contiguous ranges of vBuckets; see kv_batch.hxx.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_DOCUMENTS   documents to seed and read (default: 10000)
+ *   DOCUMENT_SIZE   approximate size of a document in bytes (default: 256)
+ *   BATCH_SIZE      IDs per batch (default: 1000)
+ *   ROUNDS          rounds of both modes (default: 3)
+ *   WINDOW          maximum operations in flight (default: 1024)
+ *   NUM_VBUCKETS    vBuckets of the bucket, 64 for a server on macOS (default: 1024)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "kv_batch.hxx"
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_documents{ 10000 };
+  std::size_t document_size{ 256 };
+  std::size_t batch_size{ 1000 };
+  std::size_t rounds{ 3 };
+  std::size_t window{ 1024 };
+  std::uint16_t num_vbuckets{ 1024 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+make_document_id(std::size_t index) -> std::string
+{
+  return "kv_batch::" + std::to_string(index);
+}
+
+struct counters {
+  std::optional<std::uint64_t> tcp_out{};
+  std::optional<std::uint64_t> tcp_in{};
+  std::optional<std::uint64_t> context_switches{};
+};
+
+// Reads the Tcp OutSegs/InSegs columns of /proc/net/snmp and this process'
+// voluntary_ctxt_switches from /proc/self/status.
+auto
+read_counters() -> counters
+{
+  counters result{};
+  if (std::ifstream snmp{ "/proc/net/snmp" }; snmp) {
+    std::string header;
+    std::string values;
+    while (std::getline(snmp, header) && std::getline(snmp, values)) {
+      if (header.rfind("Tcp:", 0) != 0) {
+        continue;
+      }
+      std::istringstream names{ header };
+      std::istringstream numbers{ values };
+      std::string name;
+      std::string number;
+      while (names >> name && numbers >> number) {
+        if (name == "OutSegs") {
+          result.tcp_out = std::stoull(number);
+        } else if (name == "InSegs") {
+          result.tcp_in = std::stoull(number);
+        }
+      }
+    }
+  }
+  if (std::ifstream status{ "/proc/self/status" }; status) {
+    std::string line;
+    while (std::getline(status, line)) {
+      if (line.rfind("voluntary_ctxt_switches:", 0) == 0) {
+        result.context_switches = std::stoull(line.substr(line.find(':') + 1));
+      }
+    }
+  }
+  return result;
+}
+
+struct mode_result {
+  double best_rate{ 0 };
+  std::uint64_t operations{ 0 };
+  std::uint64_t errors{ 0 };
+  std::optional<std::uint64_t> tcp_out{ 0 };
+  std::optional<std::uint64_t> tcp_in{ 0 };
+  std::optional<std::uint64_t> context_switches{ 0 };
+};
+
+void
+accumulate(std::optional<std::uint64_t>& total,
+           const std::optional<std::uint64_t>& before,
+           const std::optional<std::uint64_t>& after)
+{
+  if (total && before && after) {
+    *total += *after - *before;
+  } else {
+    total.reset();
+  }
+}
+
+template<typename Fetch>
+void
+run_round(const std::vector<std::vector<std::string>>& batches, Fetch&& fetch, mode_result& mode)
+{
+  const auto before = read_counters();
+  const auto start = std::chrono::steady_clock::now();
+  std::uint64_t operations{ 0 };
+  for (const auto& batch : batches) {
+    for (const auto& [id, entry] : fetch(batch)) {
+      ++operations;
+      if (entry.error.ec()) {
+        ++mode.errors;
+      }
+    }
+  }
+  const auto seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const auto after = read_counters();
+
+  mode.operations += operations;
+  if (seconds > 0) {
+    mode.best_rate = std::max(mode.best_rate, static_cast<double>(operations) / seconds);
+  }
+  accumulate(mode.tcp_out, before.tcp_out, after.tcp_out);
+  accumulate(mode.tcp_in, before.tcp_in, after.tcp_in);
+  accumulate(mode.context_switches, before.context_switches, after.context_switches);
+}
+
+void
+print_mode(const std::string& name, const mode_result& mode)
+{
+  const auto per_operation = [&mode](const std::optional<std::uint64_t>& value) -> std::string {
+    if (!value || mode.operations == 0) {
+      return "n/a";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << static_cast<double>(*value) / static_cast<double>(mode.operations);
+    return out.str();
+  };
+  std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+            << std::setprecision(0) << std::setw(10) << mode.best_rate << " ops/s, per op: tcp out "
+            << per_operation(mode.tcp_out) << ", tcp in " << per_operation(mode.tcp_in)
+            << ", csw " << per_operation(mode.context_switches) << " (" << mode.operations
+            << " gets, " << mode.errors << " errors)\n";
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  {
+    std::vector<std::pair<std::string, tao::json::value>> documents;
+    documents.reserve(config.num_documents);
+    for (std::size_t i = 0; i < config.num_documents; ++i) {
+      documents.emplace_back(make_document_id(i),
+                             tao::json::value{
+                               { "index", i },
+                               { "payload", std::string(config.document_size, 'x') },
+                             });
+    }
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : upsert_multi(collection, documents, {}, config.window)) {
+      if (entry.error.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "Seeded " << config.num_documents - failed << " documents (" << failed
+              << " failed)\n";
+  }
+
+  // The same random batches for both modes.
+  std::vector<std::string> ids;
+  ids.reserve(config.num_documents);
+  for (std::size_t i = 0; i < config.num_documents; ++i) {
+    ids.push_back(make_document_id(i));
+  }
+  std::shuffle(ids.begin(), ids.end(), std::mt19937_64{ 42 });
+  std::vector<std::vector<std::string>> batches;
+  for (std::size_t i = 0; i < ids.size(); i += config.batch_size) {
+    const auto end = std::min(i + config.batch_size, ids.size());
+    batches.emplace_back(ids.begin() + static_cast<std::ptrdiff_t>(i),
+                         ids.begin() + static_cast<std::ptrdiff_t>(end));
+  }
+
+  mode_result unordered{};
+  mode_result grouped{};
+  for (std::size_t round = 0; round < config.rounds; ++round) {
+    run_round(
+      batches,
+      [&](const auto& batch) {
+        return get_multi(collection, batch, {}, config.window);
+      },
+      unordered);
+    run_round(
+      batches,
+      [&](const auto& batch) {
+        return get_batch(collection, batch, {}, config.window, config.num_vbuckets);
+      },
+      grouped);
+  }
+  print_mode("get_multi", unordered);
+  print_mode("get_batch", grouped);
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::stoul(val);
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZE"); val != nullptr) {
+    config.document_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("BATCH_SIZE"); val != nullptr) {
+    config.batch_size = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("ROUNDS"); val != nullptr) {
+    config.rounds = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("WINDOW"); val != nullptr) {
+    config.window = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_VBUCKETS"); val != nullptr) {
+    config.num_vbuckets =
+      static_cast<std::uint16_t>(std::clamp<unsigned long>(std::stoul(val), 1, 1024));
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "      NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "      DOCUMENT_SIZE: " << document_size << "\n";
+  std::cout << "         BATCH_SIZE: " << batch_size << "\n";
+  std::cout << "             ROUNDS: " << rounds << "\n";
+  std::cout << "             WINDOW: " << window << "\n";
+  std::cout << "       NUM_VBUCKETS: " << num_vbuckets << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
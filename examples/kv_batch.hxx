@@ -0,0 +1,83 @@
+/*
+ * kv_batch — multi-document gets dispatched in vBucket order
+ *
+ * get_multi() (kv_multi.hxx) dispatches the IDs in the order it is given them.  For a
+ * large batch of unrelated keys that order is effectively random with respect to the
+ * cluster: consecutive requests go to different nodes, so each node's connection sees
+ * its requests trickle in one at a time, and the SDK ends up writing them to the socket
+ * in many small writes.
+ *
+ * get_batch() sorts the batch by vBucket before dispatching it, so the requests for
+ * one vBucket, which all go to the node that owns it, are handed to the SDK back to
+ * back.  How much that helps depends on two things this file cannot check:
+ *
+ *   - a group only forms a burst when the batch is much larger than `vbucket_count`.
+ *     A batch of 1000 random keys over 1024 vBuckets has about one key per vBucket, so
+ *     the groups are single requests.
+ *   - consecutive groups only go to the same node if the cluster assigns vBuckets to
+ *     nodes in contiguous ranges.  Nothing guarantees that, and the public SDK API
+ *     does not expose the vBucket map that would allow grouping by node directly.
+ *     This is the only source of node-level grouping.
+ *
+ * The vBucket of a key is computed as the SDK computes it, but only for the right
+ * `vbucket_count`: 1024 on Linux and Windows servers, 64 on macOS.  A wrong count still
+ * returns every document; it silently scatters the groups, and the batch degrades to
+ * the arbitrary order of get_multi().
+ *
+ * The window should be large enough to hold whole groups (a few times the batch size
+ * divided by vbucket_count); otherwise a group is split whenever the window fills up.
+ */
+
+#pragma once
+
+#include "crc32.hxx"
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// The vBucket the SDK routes `key` to: bits 16..30 of the key's CRC-32, modulo the
+// number of vBuckets.
+inline auto
+vbucket_for_key(std::string_view key, std::uint16_t vbucket_count = 1024) -> std::uint16_t
+{
+  const auto crc = crc32(key);
+  const auto count = std::max<std::uint16_t>(vbucket_count, 1);
+  return static_cast<std::uint16_t>(((crc >> 16) & 0x7fff) % count);
+}
+
+// Fetches every ID in `ids` concurrently, dispatching them grouped by vBucket.  Results
+// are the same as those of get_multi().
+template<typename Range>
+auto
+get_batch(const couchbase::collection& collection,
+          const Range& ids,
+          const couchbase::get_options& options = {},
+          std::size_t window_size = 1024,
+          std::uint16_t vbucket_count = 1024) -> multi_result<get_multi_entry>
+{
+  std::vector<std::pair<std::uint16_t, std::string_view>> ordered;
+  std::unordered_set<std::string_view> seen;
+  for (const auto& id : ids) {
+    const std::string_view view{ id };
+    if (seen.insert(view).second) {
+      ordered.emplace_back(vbucket_for_key(view, vbucket_count), view);
+    }
+  }
+  // Stable, so the IDs of one vBucket keep the caller's order.
+  std::stable_sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+
+  std::vector<std::string_view> sorted;
+  sorted.reserve(ordered.size());
+  for (const auto& [vbucket, id] : ordered) {
+    sorted.push_back(id);
+  }
+  return get_multi(collection, sorted.begin(), sorted.end(), options, window_size);
+}
@@ -0,0 +1,378 @@
+/*
+ * kv_bench — KV latency microbenchmark with HDR-style histograms
+ *
+ * Measures the round-trip latency of get, upsert, replace and remove for a sweep of
+ * document sizes (64 B to 1 MiB by default).  For every size the benchmark works on
+ * OPS_PER_SIZE keys and runs four phases one after another: upsert every key, get
+ * every key, replace every key, remove every key.  Each operation is timed with
+ * steady_clock at nanosecond resolution and recorded into a latency_histogram, so the
+ * reported percentiles keep microsecond precision down to the fastest operations
+ * (the millisecond histogram in inventory_with_opentelemetry rounds most local
+ * operations to 0 or 1).
+ *
+ * Only one operation is outstanding at a time: this is a latency benchmark, not a
+ * throughput one (see workload_driver for that).  WARMUP_OPS unmeasured upserts and
+ * gets run first so that connection setup and cold caches do not end up in the tail.
+ *
+ * The benchmark needs nothing but a reachable KV service: the defaults target a local
+ * single-node server on 127.0.0.1 (for example the couchbase/server container) and
+ * the "default" bucket, and the documents it creates are removed by its last phase.
+ *
+ * A table is printed for humans; the same numbers are emitted as JSON (on stdout, and
+ * into RESULT_FILE when set) so that runs can be stored and compared for regressions.
+ * All latencies in the JSON are microseconds.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   DOCUMENT_SIZES   comma-separated sizes in bytes
+ *                    (default: 64,256,1024,4096,16384,65536,262144,1048576)
+ *   OPS_PER_SIZE     measured operations per size and operation (default: 200)
+ *   WARMUP_OPS       unmeasured operations before the sweep (default: 50)
+ *   KEY_PREFIX       document ID prefix (default: "kv_bench::")
+ *   RESULT_FILE      also write the JSON report to this file
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::vector<std::size_t> document_sizes{ 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+  std::size_t ops_per_size{ 200 };
+  std::size_t warmup_ops{ 50 };
+  std::string key_prefix{ "kv_bench::" };
+  std::optional<std::string> result_file{};
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct operation_result {
+  std::string operation;
+  std::size_t document_size;
+  latency_histogram latency{};
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+  std::chrono::nanoseconds elapsed{};
+};
+
+auto
+make_document_id(const program_config& config, std::size_t size, std::size_t index)
+  -> std::string
+{
+  return config.key_prefix + std::to_string(size) + "::" + std::to_string(index);
+}
+
+auto
+make_payload(std::size_t size, std::size_t salt) -> couchbase::codec::binary
+{
+  couchbase::codec::binary payload(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    payload[i] = static_cast<std::byte>((i + salt) & 0xffU);
+  }
+  return payload;
+}
+
+// Runs `operation(index)` for every key, timing each call individually.  The callable
+// returns the couchbase::error of the operation it performed.
+template<typename Operation>
+auto
+measure(const std::string& name, std::size_t size, std::size_t count, Operation&& operation)
+  -> operation_result
+{
+  operation_result result{ name, size };
+  const auto phase_start = std::chrono::steady_clock::now();
+  for (std::size_t index = 0; index < count; ++index) {
+    const auto start = std::chrono::steady_clock::now();
+    const couchbase::error err = operation(index);
+    result.latency.record(std::chrono::steady_clock::now() - start);
+    if (err.ec()) {
+      ++result.errors;
+      result.last_error = err.message();
+    }
+  }
+  result.elapsed = std::chrono::steady_clock::now() - phase_start;
+  return result;
+}
+
+auto
+run_size(const couchbase::collection& collection, const program_config& config, std::size_t size)
+  -> std::vector<operation_result>
+{
+  using transcoder = couchbase::codec::raw_binary_transcoder;
+
+  const auto initial = make_payload(size, 0);
+  const auto updated = make_payload(size, 1);
+  const auto id = [&config, size](std::size_t index) {
+    return make_document_id(config, size, index);
+  };
+
+  std::vector<operation_result> results;
+  results.emplace_back(measure("upsert", size, config.ops_per_size, [&](std::size_t index) {
+    return collection.upsert<transcoder>(id(index), initial, {}).get().first;
+  }));
+  results.emplace_back(measure("get", size, config.ops_per_size, [&](std::size_t index) {
+    return collection.get(id(index), {}).get().first;
+  }));
+  results.emplace_back(measure("replace", size, config.ops_per_size, [&](std::size_t index) {
+    return collection.replace<transcoder>(id(index), updated, {}).get().first;
+  }));
+  results.emplace_back(measure("remove", size, config.ops_per_size, [&](std::size_t index) {
+    return collection.remove(id(index), {}).get().first;
+  }));
+  return results;
+}
+
+void
+warm_up(const couchbase::collection& collection, const program_config& config)
+{
+  const auto payload = make_payload(1024, 0);
+  const auto document_id = config.key_prefix + "warmup";
+  for (std::size_t i = 0; i < config.warmup_ops; ++i) {
+    collection.upsert<couchbase::codec::raw_binary_transcoder>(document_id, payload, {}).get();
+    collection.get(document_id, {}).get();
+  }
+  collection.remove(document_id, {}).get();
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_table(const std::vector<operation_result>& results)
+{
+  std::cout << "latencies in microseconds\n";
+  std::cout << std::setw(8) << "op" << std::setw(10) << "size" << std::setw(8) << "count"
+            << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::setw(8) << "errors"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto& r : results) {
+    const auto& h = r.latency;
+    std::cout << std::setw(8) << r.operation << std::setw(10) << r.document_size << std::setw(8)
+              << h.count() << std::setw(10) << to_micros(h.mean()) << std::setw(10)
+              << to_micros(h.value_at_percentile(50)) << std::setw(10)
+              << to_micros(h.value_at_percentile(99)) << std::setw(10)
+              << to_micros(h.value_at_percentile(99.9)) << std::setw(10) << to_micros(h.max())
+              << std::setw(8) << r.errors << "\n";
+    if (!r.last_error.empty()) {
+      std::cout << "          last error: " << r.last_error << "\n";
+    }
+  }
+  std::cout << "\n";
+}
+
+auto
+to_json(const program_config& config, const std::vector<operation_result>& results)
+  -> tao::json::value
+{
+  tao::json::value sizes = tao::json::empty_array;
+  for (const auto size : config.document_sizes) {
+    sizes.emplace_back(size);
+  }
+
+  tao::json::value entries = tao::json::empty_array;
+  for (const auto& r : results) {
+    const auto& h = r.latency;
+    const auto seconds = std::chrono::duration<double>(r.elapsed).count();
+    entries.emplace_back(tao::json::value{
+      { "operation", r.operation },
+      { "document_size", r.document_size },
+      { "count", h.count() },
+      { "errors", r.errors },
+      { "ops_per_second", seconds > 0 ? static_cast<double>(h.count()) / seconds : 0.0 },
+      { "min_us", to_micros(h.min()) },
+      { "mean_us", to_micros(h.mean()) },
+      { "p50_us", to_micros(h.value_at_percentile(50)) },
+      { "p99_us", to_micros(h.value_at_percentile(99)) },
+      { "p999_us", to_micros(h.value_at_percentile(99.9)) },
+      { "max_us", to_micros(h.max()) },
+    });
+  }
+
+  return tao::json::value{
+    { "benchmark", "kv_bench" },
+    { "config",
+      {
+        { "connection_string", config.connection_string },
+        { "bucket_name", config.bucket_name },
+        { "scope_name", config.scope_name },
+        { "collection_name", config.collection_name },
+        { "document_sizes", sizes },
+        { "ops_per_size", config.ops_per_size },
+        { "warmup_ops", config.warmup_ops },
+      } },
+    { "results", entries },
+  };
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  warm_up(collection, config);
+
+  std::vector<operation_result> results;
+  for (const auto size : config.document_sizes) {
+    for (auto& result : run_size(collection, config, size)) {
+      results.emplace_back(std::move(result));
+    }
+  }
+
+  print_table(results);
+
+  const auto report = tao::json::to_string(to_json(config, results), 2);
+  std::cout << report << "\n";
+  if (config.result_file) {
+    std::ofstream out(*config.result_file);
+    out << report << "\n";
+    if (!out) {
+      std::cout << "Unable to write " << program_config::quote(*config.result_file) << "\n";
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZES"); val != nullptr) {
+    config.document_sizes.clear();
+    std::istringstream input(val);
+    std::string size;
+    while (std::getline(input, size, ',')) {
+      if (!size.empty()) {
+        config.document_sizes.emplace_back(std::stoul(size));
+      }
+    }
+  }
+  if (const auto* val = getenv("OPS_PER_SIZE"); val != nullptr) {
+    config.ops_per_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("WARMUP_OPS"); val != nullptr) {
+    config.warmup_ops = std::stoul(val);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("RESULT_FILE"); val != nullptr) {
+    config.result_file = val;
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string sizes;
+  for (const auto size : document_sizes) {
+    sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "     DOCUMENT_SIZES: " << sizes << "\n";
+  std::cout << "       OPS_PER_SIZE: " << ops_per_size << "\n";
+  std::cout << "         WARMUP_OPS: " << warmup_ops << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "        RESULT_FILE: " << (result_file ? quote(*result_file) : "[NONE]") << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
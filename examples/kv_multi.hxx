@@ -0,0 +1,180 @@
+/*
+ * kv_multi — concurrent multi-document get/upsert over the callback API
+ *
+ * Fetching N documents with collection.get(...).get() in a loop costs N round trips.
+ * get_multi() and upsert_multi() dispatch the operations concurrently instead, keeping
+ * at most `window` of them outstanding, and block until every key has completed.
+ *
+ * Results come back as an unordered_map keyed by document ID.  Every key gets its own
+ * entry with its own couchbase::error, so a missing document or a timeout on one key
+ * never fails the batch.  All entries are created before the first operation is
+ * dispatched; completion handlers then move the SDK result straight into their slot,
+ * without locking the map and without copying document bodies.  Duplicate IDs in the
+ * input are fetched (or written) once.
+ *
+ * upsert_multi() encodes each document with the chosen transcoder on the calling
+ * thread and hands the encoded bytes to the SDK by move, so documents are not copied
+ * either.
+ *
+ * Both helpers block the calling thread, so they must not be called from an SDK
+ * completion handler.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/default_json_transcoder.hxx>
+
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct get_multi_entry {
+  couchbase::error error{};
+  std::optional<couchbase::get_result> result{}; // empty when error is set
+};
+
+struct upsert_multi_entry {
+  couchbase::error error{};
+  std::optional<couchbase::mutation_result> result{}; // empty when error is set
+};
+
+template<typename Entry>
+using multi_result = std::unordered_map<std::string, Entry>;
+
+namespace kv_multi_detail
+{
+// Bounds the number of outstanding operations and waits for all of them to finish.
+class window
+{
+public:
+  explicit window(std::size_t size)
+    : size_{ size == 0 ? 1 : size }
+  {
+  }
+
+  void acquire()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return in_flight_ < size_;
+    });
+    ++in_flight_;
+  }
+
+  void release()
+  {
+    // Notify while holding the mutex: the waiter in drain() destroys this object as
+    // soon as it observes the last release.
+    const std::scoped_lock lock(mutex_);
+    --in_flight_;
+    cv_.notify_all();
+  }
+
+  void drain()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return in_flight_ == 0;
+    });
+  }
+
+private:
+  const std::size_t size_;
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::size_t in_flight_{ 0 };
+};
+} // namespace kv_multi_detail
+
+// Fetches every ID in [first, last) concurrently.  *first must be convertible to
+// std::string (std::string, std::string_view, const char*).
+template<typename InputIt,
+         typename = typename std::iterator_traits<InputIt>::iterator_category>
+auto
+get_multi(const couchbase::collection& collection,
+          InputIt first,
+          InputIt last,
+          const couchbase::get_options& options = {},
+          std::size_t window_size = 128) -> multi_result<get_multi_entry>
+{
+  multi_result<get_multi_entry> results;
+  if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                  typename std::iterator_traits<InputIt>::iterator_category>) {
+    results.reserve(static_cast<std::size_t>(std::distance(first, last)));
+  }
+  std::vector<typename multi_result<get_multi_entry>::value_type*> slots;
+  for (; first != last; ++first) {
+    if (auto [it, inserted] = results.try_emplace(std::string(*first)); inserted) {
+      slots.push_back(&*it);
+    }
+  }
+
+  kv_multi_detail::window window{ window_size };
+  for (auto* slot : slots) {
+    window.acquire();
+    collection.get(slot->first, options, [slot, &window](auto err, auto resp) {
+      slot->second.error = err;
+      if (!err.ec()) {
+        slot->second.result.emplace(std::move(resp));
+      }
+      window.release();
+    });
+  }
+  window.drain();
+  return results;
+}
+
+template<typename Range>
+auto
+get_multi(const couchbase::collection& collection,
+          const Range& ids,
+          const couchbase::get_options& options = {},
+          std::size_t window_size = 128) -> multi_result<get_multi_entry>
+{
+  return get_multi(collection, std::begin(ids), std::end(ids), options, window_size);
+}
+
+// Writes every (id, document) pair in `documents` concurrently.  When an ID appears
+// more than once, only its first document is written.
+template<typename Transcoder = couchbase::codec::default_json_transcoder, typename Documents>
+auto
+upsert_multi(const couchbase::collection& collection,
+             const Documents& documents,
+             const couchbase::upsert_options& options = {},
+             std::size_t window_size = 128) -> multi_result<upsert_multi_entry>
+{
+  multi_result<upsert_multi_entry> results;
+  results.reserve(std::size(documents));
+  std::vector<std::pair<typename multi_result<upsert_multi_entry>::value_type*,
+                        couchbase::codec::encoded_value>>
+    pending;
+  pending.reserve(std::size(documents));
+  for (const auto& [id, document] : documents) {
+    if (auto [it, inserted] = results.try_emplace(std::string(id)); inserted) {
+      pending.emplace_back(&*it, Transcoder::encode(document));
+    }
+  }
+
+  kv_multi_detail::window window{ window_size };
+  for (auto& [slot, encoded] : pending) {
+    window.acquire();
+    collection.upsert(
+      slot->first, std::move(encoded), options, [slot = slot, &window](auto err, auto resp) {
+        slot->second.error = err;
+        if (!err.ec()) {
+          slot->second.result.emplace(std::move(resp));
+        }
+        window.release();
+      });
+  }
+  window.drain();
+  return results;
+}
@@ -0,0 +1,168 @@
+/*
+ * latency_histogram — fixed-size, log-linear latency histogram (HDR style)
+ *
+ * Values are recorded in nanoseconds into buckets laid out like HdrHistogram: every
+ * power of two is split into 2^sub_bucket_bits linear sub-buckets, so the relative
+ * error of any reported value is bounded by 2^-sub_bucket_bits (≈0.8% with the
+ * default of 7 bits) over the whole range from 1 ns to several centuries, while the
+ * histogram itself stays a flat array of ~7 400 counters.
+ *
+ * Recording is a couple of shifts and one increment, with no allocation, so it is
+ * cheap enough to call on every operation.  The class is not thread-safe: give each
+ * worker thread its own instance and merge() them once the run is over.
+ *
+ * Percentiles are reported as the highest value equivalent to the bucket they fall
+ * in (as HdrHistogram does), so they never understate the latency that was observed.
+ * min() and max() are tracked exactly.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class latency_histogram
+{
+public:
+  static constexpr std::uint32_t sub_bucket_bits{ 7 };
+
+  latency_histogram()
+    : counts_(bucket_count(), 0)
+  {
+  }
+
+  void record(std::chrono::nanoseconds latency)
+  {
+    record_value(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0)), 1);
+  }
+
+  void record_value(std::uint64_t value, std::uint64_t times)
+  {
+    if (times == 0) {
+      return;
+    }
+    counts_[index_of(value)] += times;
+    total_count_ += times;
+    total_sum_ += static_cast<double>(value) * static_cast<double>(times);
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const latency_histogram& other)
+  {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+    total_sum_ += other.total_sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void reset()
+  {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_count_ = 0;
+    total_sum_ = 0;
+    min_ = std::numeric_limits<std::uint64_t>::max();
+    max_ = 0;
+  }
+
+  [[nodiscard]] auto count() const -> std::uint64_t
+  {
+    return total_count_;
+  }
+
+  [[nodiscard]] auto min() const -> std::chrono::nanoseconds
+  {
+    return std::chrono::nanoseconds{ total_count_ == 0 ? 0 : static_cast<std::int64_t>(min_) };
+  }
+
+  [[nodiscard]] auto max() const -> std::chrono::nanoseconds
+  {
+    return std::chrono::nanoseconds{ static_cast<std::int64_t>(max_) };
+  }
+
+  [[nodiscard]] auto mean() const -> std::chrono::nanoseconds
+  {
+    if (total_count_ == 0) {
+      return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::nanoseconds{ static_cast<std::int64_t>(
+      total_sum_ / static_cast<double>(total_count_)) };
+  }
+
+  // percentile is in [0, 100], e.g. 99.9
+  [[nodiscard]] auto value_at_percentile(double percentile) const -> std::chrono::nanoseconds
+  {
+    if (total_count_ == 0) {
+      return std::chrono::nanoseconds::zero();
+    }
+    const double clamped = std::clamp(percentile, 0.0, 100.0);
+    const auto rank = std::max<std::uint64_t>(
+      static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total_count_))),
+      1);
+    std::uint64_t seen{ 0 };
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::chrono::nanoseconds{ static_cast<std::int64_t>(
+          std::min(highest_equivalent_value(i), max_)) };
+      }
+    }
+    return max();
+  }
+
+private:
+  static constexpr std::uint64_t sub_bucket_count{ std::uint64_t{ 1 } << sub_bucket_bits };
+  static constexpr std::uint64_t sub_bucket_mask{ sub_bucket_count - 1 };
+
+  static constexpr auto bucket_count() -> std::size_t
+  {
+    // values below sub_bucket_count map 1:1, every higher power of two adds one row
+    return static_cast<std::size_t>((64 - sub_bucket_bits + 1) << sub_bucket_bits);
+  }
+
+  static auto most_significant_bit(std::uint64_t value) -> std::uint32_t
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63U - static_cast<std::uint32_t>(__builtin_clzll(value));
+#else
+    std::uint32_t bit{ 0 };
+    while (value >>= 1U) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  static auto index_of(std::uint64_t value) -> std::size_t
+  {
+    if (value < sub_bucket_count) {
+      return static_cast<std::size_t>(value);
+    }
+    const std::uint32_t shift = most_significant_bit(value) - sub_bucket_bits;
+    return static_cast<std::size_t>(((std::uint64_t{ shift } + 1) << sub_bucket_bits) |
+                                    ((value >> shift) & sub_bucket_mask));
+  }
+
+  static auto highest_equivalent_value(std::size_t index) -> std::uint64_t
+  {
+    if (index < sub_bucket_count) {
+      return index;
+    }
+    const std::uint64_t shift = (index >> sub_bucket_bits) - 1;
+    const std::uint64_t lowest = ((index & sub_bucket_mask) | sub_bucket_count) << shift;
+    return lowest + ((std::uint64_t{ 1 } << shift) - 1);
+  }
+
+  std::vector<std::uint64_t> counts_;
+  std::uint64_t total_count_{ 0 };
+  double total_sum_{ 0 };
+  std::uint64_t min_{ std::numeric_limits<std::uint64_t>::max() };
+  std::uint64_t max_{ 0 };
+};
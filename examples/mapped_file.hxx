@@ -0,0 +1,99 @@
+/*
+ * mapped_file — read-only memory mapping of a whole file (POSIX)
+ *
+ * The kernel pages the file in on demand and can drop the pages again under memory
+ * pressure, since they are backed by the file: mapping a multi-gigabyte input costs
+ * address space, not private memory.  map_file() returns the mapping as external_bytes
+ * (external_bytes.hxx) that own it, so documents can be uploaded straight from the page
+ * cache and the mapping goes away with the last view of it.
+ */
+
+#pragma once
+
+#include "external_bytes.hxx"
+
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class mapped_file
+{
+public:
+  explicit mapped_file(const std::string& path)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error_ = std::error_code(errno, std::generic_category());
+      return;
+    }
+    struct stat info {
+    };
+    if (::fstat(fd, &info) != 0) {
+      error_ = std::error_code(errno, std::generic_category());
+      ::close(fd);
+      return;
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+      void* address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED) {
+        error_ = std::error_code(errno, std::generic_category());
+        size_ = 0;
+      } else {
+        data_ = static_cast<const char*>(address);
+        // Readers go through the file front to back.
+        ::madvise(address, size_, MADV_SEQUENTIAL);
+      }
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+  ~mapped_file()
+  {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  [[nodiscard]] auto error() const -> std::error_code
+  {
+    return error_;
+  }
+
+  [[nodiscard]] auto contents() const -> std::string_view
+  {
+    return { data_, size_ };
+  }
+
+private:
+  const char* data_{ nullptr };
+  std::size_t size_{ 0 };
+  std::error_code error_{};
+};
+
+inline auto
+map_file(const std::string& path) -> std::pair<std::error_code, external_bytes>
+{
+  auto file = std::make_shared<const mapped_file>(path);
+  if (file->error()) {
+    return { file->error(), {} };
+  }
+  const auto contents = file->contents();
+  return { {},
+           external_bytes{ reinterpret_cast<const std::byte*>(contents.data()),
+                           contents.size(),
+                           std::move(file) } };
+}
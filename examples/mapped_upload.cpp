@@ -0,0 +1,347 @@
+/*
+ * mapped_upload — uploading a file as a binary document, copied vs memory-mapped
+ *
+ * Uploads INPUT_FILE (or, without it, a generated file of FILE_SIZE bytes in the
+ * temporary directory) UPLOADS times under DOCUMENT_ID in two ways:
+ *
+ *   vector  the file is read into an std::vector<std::byte> and written with
+ *           upsert<raw_binary_transcoder>(), as in minimal_with_char_array.cpp
+ *   mapped  the file is mapped with map_file() (mapped_file.hxx) and written with
+ *           upsert_external() (external_bytes.hxx), which copies it once from the page
+ *           cache into the request and keeps the mapping alive until the write is done
+ *
+ * For each it prints the time per upload and the peak growth of the process' anonymous
+ * (private) memory while uploading, sampled from /proc/self/status every millisecond
+ * (Linux only).  File-backed pages of the mapping are not counted: the kernel can drop
+ * them at any time.  The document is read back once and compared with the file.
+ *
+ * The file must fit in one document (20 MiB); blob_store.cpp stores larger ones.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   INPUT_FILE   file to upload
+ *   FILE_SIZE    size of the generated file in bytes (default: 16777216)
+ *   UPLOADS      uploads per approach (default: 5)
+ *   DOCUMENT_ID  ID of the document (default: "mapped_upload::file")
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_binary_transcoder.hxx>
+#include <couchbase/logger.hxx>
+
+#include "external_bytes.hxx"
+#include "mapped_file.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::optional<std::string> input_file{};
+  std::size_t file_size{ 16 * 1024 * 1024 };
+  std::size_t uploads{ 5 };
+  std::string document_id{ "mapped_upload::file" };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+// RssAnon of this process in KiB, if /proc/self/status has it.
+auto
+read_anonymous_rss() -> std::optional<std::uint64_t>
+{
+  std::ifstream status{ "/proc/self/status" };
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("RssAnon:", 0) == 0) {
+      return std::stoull(line.substr(line.find(':') + 1));
+    }
+  }
+  return {};
+}
+
+// Samples RssAnon every millisecond while alive and remembers the highest value.
+class rss_sampler
+{
+public:
+  rss_sampler()
+    : baseline_{ read_anonymous_rss() }
+    , thread_{ [this] {
+      while (!stopped_) {
+        if (const auto rss = read_anonymous_rss(); rss && *rss > peak_) {
+          peak_ = *rss;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+      }
+    } }
+  {
+  }
+
+  rss_sampler(const rss_sampler&) = delete;
+  auto operator=(const rss_sampler&) -> rss_sampler& = delete;
+
+  ~rss_sampler()
+  {
+    stop();
+  }
+
+  // Peak growth over the value at construction, in KiB.
+  auto stop() -> std::optional<std::uint64_t>
+  {
+    if (!stopped_.exchange(true)) {
+      thread_.join();
+    }
+    if (!baseline_ || peak_ == 0) {
+      return {};
+    }
+    return peak_ > *baseline_ ? peak_ - *baseline_ : 0;
+  }
+
+private:
+  std::optional<std::uint64_t> baseline_;
+  std::atomic_bool stopped_{ false };
+  std::atomic_uint64_t peak_{ 0 };
+  std::thread thread_;
+};
+
+auto
+generate_file(const std::string& path, std::size_t size) -> bool
+{
+  std::ofstream out(path, std::ios::binary);
+  std::mt19937_64 engine{ 42 };
+  std::array<char, 64 * 1024> block{};
+  for (std::size_t written = 0; written < size && out; written += block.size()) {
+    for (std::size_t i = 0; i < block.size(); i += sizeof(std::uint64_t)) {
+      const auto word = engine();
+      std::memcpy(block.data() + i, &word, sizeof(word));
+    }
+    out.write(block.data(), static_cast<std::streamsize>(std::min(block.size(), size - written)));
+  }
+  return static_cast<bool>(out);
+}
+
+auto
+read_file(const std::string& path) -> couchbase::codec::binary
+{
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  couchbase::codec::binary bytes(static_cast<std::size_t>(in.tellg()));
+  in.seekg(0);
+  in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return bytes;
+}
+
+void
+print_result(const std::string& name,
+             std::size_t uploads,
+             std::size_t errors,
+             std::chrono::steady_clock::duration elapsed,
+             std::optional<std::uint64_t> peak_kib)
+{
+  const auto millis = std::chrono::duration<double, std::milli>(elapsed).count() /
+                      static_cast<double>(std::max<std::size_t>(uploads, 1));
+  std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setprecision(2) << millis << " ms per upload, peak anonymous memory +";
+  if (peak_kib) {
+    std::cout << std::setprecision(1) << static_cast<double>(*peak_kib) / 1024 << " MiB";
+  } else {
+    std::cout << "n/a";
+  }
+  std::cout << " (" << errors << " errors)\n";
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  std::string path;
+  if (config.input_file) {
+    path = *config.input_file;
+  } else {
+    path = (std::filesystem::temp_directory_path() / "mapped_upload.bin").string();
+    if (!generate_file(path, config.file_size)) {
+      std::cout << "Unable to write " << program_config::quote(path) << "\n";
+      cluster.close().get();
+      return EXIT_FAILURE;
+    }
+  }
+
+  {
+    std::size_t errors{ 0 };
+    rss_sampler sampler;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < config.uploads; ++i) {
+      const auto bytes = read_file(path);
+      auto [err, resp] = collection
+                           .upsert<couchbase::codec::raw_binary_transcoder>(
+                             config.document_id, bytes, {})
+                           .get();
+      if (err.ec()) {
+        ++errors;
+        std::cout << "  vector upload failed: " << err.message() << "\n";
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    print_result("vector", config.uploads, errors, elapsed, sampler.stop());
+  }
+
+  {
+    std::size_t errors{ 0 };
+    rss_sampler sampler;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < config.uploads; ++i) {
+      auto [map_err, bytes] = map_file(path);
+      if (map_err) {
+        ++errors;
+        std::cout << "  unable to map " << program_config::quote(path) << ": "
+                  << map_err.message() << "\n";
+        continue;
+      }
+      // The mapping is released by upsert_external() once the write has completed.
+      auto [err, resp] = upsert_external(collection, config.document_id, std::move(bytes)).get();
+      if (err.ec()) {
+        ++errors;
+        std::cout << "  mapped upload failed: " << err.message() << "\n";
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    print_result("mapped", config.uploads, errors, elapsed, sampler.stop());
+  }
+
+  if (auto [err, resp] = collection.get(config.document_id, {}).get(); err.ec()) {
+    std::cout << "GET failed: " << err.message() << "\n";
+  } else {
+    const auto stored = resp.content_as<external_binary_transcoder>();
+    std::cout << "Stored document " << (stored == read_file(path) ? "matches" : "DIFFERS from")
+              << " the file\n";
+  }
+
+  collection.remove(config.document_id, {}).get();
+  if (!config.input_file) {
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("INPUT_FILE"); val != nullptr) {
+    config.input_file = val;
+  }
+  if (const auto* val = getenv("FILE_SIZE"); val != nullptr) {
+    config.file_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("UPLOADS"); val != nullptr) {
+    config.uploads = std::stoul(val);
+  }
+  if (const auto* val = getenv("DOCUMENT_ID"); val != nullptr) {
+    config.document_id = val;
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "         INPUT_FILE: " << (input_file ? quote(*input_file) : "[NONE]") << "\n";
+  std::cout << "          FILE_SIZE: " << file_size << "\n";
+  std::cout << "            UPLOADS: " << uploads << "\n";
+  std::cout << "        DOCUMENT_ID: " << quote(document_id) << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
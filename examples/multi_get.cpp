@@ -0,0 +1,226 @@
+/*
+ * multi_get — batch reads and writes with get_multi()/upsert_multi()
+ *
+ * Request handlers frequently need tens or hundreds of documents by key.  Fetching
+ * them with one blocking collection.get(...).get() after another, as minimal.cpp does
+ * for a single document, pays one network round trip per key.  The helpers in
+ * kv_multi.hxx dispatch the whole batch concurrently through the callback API (with
+ * at most WINDOW operations outstanding) and return a key→result map in which every
+ * key carries its own error.
+ *
+ * The program writes NUM_DOCUMENTS documents with upsert_multi(), reads them back
+ * once sequentially and once with get_multi() — adding one ID that does not exist to
+ * show a per-key error — and prints the time taken by each approach.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_DOCUMENTS   documents per batch (default: 200)
+ *   WINDOW          maximum operations in flight (default: 64)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "kv_multi.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_documents{ 200 };
+  std::size_t window{ 64 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+elapsed_ms(std::chrono::steady_clock::time_point start) -> double
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  std::vector<std::pair<std::string, tao::json::value>> documents;
+  documents.reserve(config.num_documents);
+  for (std::size_t i = 0; i < config.num_documents; ++i) {
+    documents.emplace_back("multi_get::" + std::to_string(i),
+                           tao::json::value{
+                             { "index", i },
+                             { "name", "document " + std::to_string(i) },
+                           });
+  }
+
+  std::cout << std::fixed << std::setprecision(2);
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const auto results = upsert_multi(collection, documents, {}, config.window);
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : results) {
+      if (entry.error.ec()) {
+        ++failed;
+        std::cout << "  upsert " << id << ": " << entry.error.message() << "\n";
+      }
+    }
+    std::cout << "upsert_multi: " << results.size() << " documents, " << failed << " failed, "
+              << elapsed_ms(start) << "ms\n";
+  }
+
+  std::vector<std::string> ids;
+  ids.reserve(documents.size() + 1);
+  for (const auto& [id, document] : documents) {
+    ids.push_back(id);
+  }
+  ids.emplace_back("multi_get::does-not-exist");
+
+  {
+    // Baseline: one round trip per key.
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t failed{ 0 };
+    for (const auto& id : ids) {
+      auto [err, resp] = collection.get(id, {}).get();
+      if (err.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "sequential get: " << ids.size() << " documents, " << failed << " failed, "
+              << elapsed_ms(start) << "ms\n";
+  }
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const auto results = get_multi(collection, ids, {}, config.window);
+    const auto elapsed = elapsed_ms(start);
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : results) {
+      if (entry.error.ec()) {
+        ++failed;
+        std::cout << "  get " << id << ": " << entry.error.message() << "\n";
+      }
+    }
+    std::cout << "get_multi: " << results.size() << " documents, " << failed << " failed, "
+              << elapsed << "ms\n";
+
+    if (const auto it = results.find(ids.front()); it != results.end() && it->second.result) {
+      std::cout << ids.front() << ": "
+                << tao::json::to_string(it->second.result->content_as<tao::json::value>())
+                << "\n";
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("WINDOW"); val != nullptr) {
+    config.window = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "      NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "             WINDOW: " << window << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
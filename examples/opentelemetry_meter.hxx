@@ -0,0 +1,85 @@
+/*
+ * opentelemetry_meter — routes the SDK's metrics into an OTLP/HTTP MeterProvider
+ *
+ * A condensed version of apply_opentelemetry_meter_options() from
+ * inventory_with_opentelemetry.cpp, shared by the examples that publish their own
+ * instruments next to the SDK's: an OTLP/HTTP JSON exporter, a periodic reader, a
+ * global MeterProvider for `service_name`, and the cluster's meter pointed at it.  The
+ * SDK's default histogram boundaries are kept; see inventory_with_opentelemetry.cpp for
+ * why and how to replace them.
+ */
+
+#pragma once
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/metrics/otel_meter.hxx>
+
+#include <opentelemetry/metrics/provider.h>
+
+#include <opentelemetry/sdk/metrics/export/periodic_exporting_metric_reader.h>
+#include <opentelemetry/sdk/metrics/meter.h>
+#include <opentelemetry/sdk/metrics/meter_context_factory.h>
+#include <opentelemetry/sdk/metrics/meter_provider.h>
+#include <opentelemetry/sdk/metrics/meter_provider_factory.h>
+#include <opentelemetry/sdk/metrics/view/view_registry_factory.h>
+
+#include <opentelemetry/sdk/resource/resource.h>
+
+#include <opentelemetry/exporters/otlp/otlp_http.h>
+#include <opentelemetry/exporters/otlp/otlp_http_metric_exporter_factory.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+
+struct opentelemetry_meter_options {
+  std::string service_name{};
+  std::string service_version{ "1.0.0" };
+  std::optional<std::string> endpoint{}; // default: http://localhost:4318/v1/metrics
+  std::chrono::milliseconds export_interval{ std::chrono::seconds{ 1 } };
+};
+
+// Instruments of the program come from the global provider, with the same service name
+// and version.  Call ForceFlush() on the returned provider before exiting.
+inline auto
+apply_opentelemetry_meter_options(couchbase::cluster_options& options,
+                                  const opentelemetry_meter_options& meter_options)
+  -> std::shared_ptr<opentelemetry::sdk::metrics::MeterProvider>
+{
+  opentelemetry::exporter::otlp::OtlpHttpMetricExporterOptions exporter_options{};
+  if (meter_options.endpoint) {
+    exporter_options.url = meter_options.endpoint.value();
+  }
+  exporter_options.content_type = opentelemetry::exporter::otlp::HttpRequestContentType::kJson;
+  auto exporter =
+    opentelemetry::exporter::otlp::OtlpHttpMetricExporterFactory::Create(exporter_options);
+
+  opentelemetry::sdk::metrics::PeriodicExportingMetricReaderOptions reader_options{};
+  reader_options.export_interval_millis = meter_options.export_interval;
+  reader_options.export_timeout_millis =
+    std::min(meter_options.export_interval, std::chrono::milliseconds{ 500 });
+  std::unique_ptr<opentelemetry::sdk::metrics::MetricReader> reader{
+    new opentelemetry::sdk::metrics::PeriodicExportingMetricReader(std::move(exporter),
+                                                                   reader_options)
+  };
+
+  auto context = opentelemetry::sdk::metrics::MeterContextFactory::Create(
+    opentelemetry::sdk::metrics::ViewRegistryFactory::Create(),
+    opentelemetry::sdk::resource::Resource::Create({
+      { "service.name", meter_options.service_name },
+      { "service.version", meter_options.service_version },
+    }));
+  context->AddMetricReader(std::move(reader));
+
+  auto sdk_provider = std::shared_ptr<opentelemetry::sdk::metrics::MeterProvider>(
+    opentelemetry::sdk::metrics::MeterProviderFactory::Create(std::move(context)).release());
+  opentelemetry::metrics::Provider::SetMeterProvider(sdk_provider);
+
+  options.metrics().enable(true);
+  options.metrics().meter(std::make_shared<couchbase::metrics::otel_meter>(
+    opentelemetry::metrics::Provider::GetMeterProvider()->GetMeter(meter_options.service_name,
+                                                                   meter_options.service_version)));
+  return sdk_provider;
+}
@@ -0,0 +1,34 @@
+/*
+ * passthrough_transcoder — reads and writes documents as their raw encoded_value
+ *
+ * Decoding gives the stored bytes and common flags untouched, and encoding sends an
+ * encoded_value as it is, as minimal_with_char_array.cpp shows.  Shared by the examples
+ * that keep documents opaque: document_cache.hxx and hedged_get.hxx cache and return
+ * them, server_group_read.hxx returns them, and collection_exporter.cpp writes them out.
+ */
+
+#pragma once
+
+#include <couchbase/codec/encoded_value.hxx>
+#include <couchbase/codec/transcoder_traits.hxx>
+
+#include <type_traits>
+
+struct passthrough_transcoder {
+  using document_type = couchbase::codec::encoded_value;
+
+  static auto encode(const couchbase::codec::encoded_value& document)
+    -> couchbase::codec::encoded_value
+  {
+    return document;
+  }
+
+  static auto decode(const couchbase::codec::encoded_value& encoded) -> document_type
+  {
+    return encoded;
+  }
+};
+
+template<>
+struct couchbase::codec::is_transcoder<passthrough_transcoder> : public std::true_type {
+};
@@ -0,0 +1,483 @@
+/*
+ * product_cache_with_opentelemetry — read-through document cache with OpenTelemetry metrics
+ *
+ * Catalogue reads are heavily skewed: a few popular products take most of the traffic,
+ * and every one of those reads costs a KV round trip when it goes straight to
+ * collection.get().  document_cache.hxx puts a sharded, byte-bounded LRU in front of
+ * the collection that keeps each document's CAS and raw bytes, serves repeated reads
+ * from memory, revalidates expired entries by CAS instead of refetching them, and drops
+ * an entry whenever the program writes the document through the cache.
+ *
+ * The program seeds NUM_PRODUCTS product documents, then runs NUM_THREADS threads that
+ * read products chosen from a Zipfian distribution through the cache and change the
+ * price of one product every WRITE_EVERY operations.  At the end it prints the cache
+ * statistics and the number of KV round trips compared with the same workload without
+ * a cache.
+ *
+ * While it runs, the cache is published as observable OpenTelemetry instruments on the
+ * "product-cache-service" meter:
+ *
+ *   product_cache.hit_ratio     gauge    requests served without a round trip (0..1)
+ *   product_cache.memory        gauge    bytes held by the cache, By
+ *   product_cache.entries       gauge    cached documents
+ *   product_cache.requests      counter  requests, by result=hit|revalidated|miss
+ *   product_cache.evictions     counter  entries dropped to stay within CACHE_MAX_BYTES
+ *
+ * together with the SDK's own operation metrics.  The pipeline is the OTLP/HTTP one
+ * of inventory_with_opentelemetry.cpp, set up by opentelemetry_meter.hxx, so the same
+ * ./telemetry-cluster stack can be used to look at them.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_PRODUCTS      products in the catalogue (default: 1000)
+ *   DOCUMENT_SIZE     approximate size of a product document in bytes (default: 1024)
+ *   NUM_THREADS       reader threads (default: 4)
+ *   NUM_OPERATIONS    operations across all threads (default: 40000)
+ *   WRITE_EVERY       every Nth operation of a thread is a price update (default: 100)
+ *   ZIPF_THETA        skew of product popularity (default: 0.99)
+ *   CACHE_SHARDS      lock-striped shards (default: 16)
+ *   CACHE_MAX_BYTES   memory bound of the cache (default: 1048576)
+ *   CACHE_TTL_MS      time an entry is served before it is revalidated (default: 250)
+ *   OTEL_METRICS_ENDPOINT                   OTLP/HTTP endpoint
+ *                                           (default: http://localhost:4318/v1/metrics)
+ *   OTEL_METRICS_READER_EXPORT_INTERVAL_MS  export interval (default: 1000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <opentelemetry/metrics/provider.h>
+
+#include <tao/json.hpp>
+
+#include "document_cache.hxx"
+#include "key_distribution.hxx"
+#include "kv_multi.hxx"
+#include "opentelemetry_meter.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_products{ 1000 };
+  std::size_t document_size{ 1024 };
+  std::size_t num_threads{ 4 };
+  std::size_t num_operations{ 40000 };
+  std::size_t write_every{ 100 };
+  double zipf_theta{ 0.99 };
+  std::size_t cache_shards{ 16 };
+  std::size_t cache_max_bytes{ 1024 * 1024 };
+  std::chrono::milliseconds cache_ttl{ 250 };
+  std::optional<std::string> metrics_endpoint{};
+  std::chrono::milliseconds metrics_export_interval{ std::chrono::seconds{ 1 } };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+namespace
+{
+constexpr auto* k_service_name{ "product-cache-service" };
+constexpr auto* k_service_version{ "1.0.0" };
+
+template<typename T>
+void
+observe(opentelemetry::metrics::ObserverResult& result, T value)
+{
+  using observer_type =
+    opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObserverResultT<T>>;
+  if (opentelemetry::nostd::holds_alternative<observer_type>(result)) {
+    opentelemetry::nostd::get<observer_type>(result)->Observe(value);
+  }
+}
+
+// Observable-instrument callbacks run on the metric reader's thread; `state` is the
+// document_cache the instruments were registered for in cache_instruments.
+auto
+cache_stats(void* state) -> document_cache_stats
+{
+  return static_cast<const document_cache*>(state)->stats();
+}
+
+void
+observe_hit_ratio(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  observe(result, cache_stats(state).hit_ratio());
+}
+
+void
+observe_memory(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  observe(result, static_cast<std::int64_t>(cache_stats(state).bytes));
+}
+
+void
+observe_entries(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  observe(result, static_cast<std::int64_t>(cache_stats(state).entries));
+}
+
+void
+observe_requests(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  using observer_type =
+    opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObserverResultT<std::int64_t>>;
+  if (!opentelemetry::nostd::holds_alternative<observer_type>(result)) {
+    return;
+  }
+  const auto stats = cache_stats(state);
+  auto& observer = opentelemetry::nostd::get<observer_type>(result);
+  observer->Observe(static_cast<std::int64_t>(stats.hits), { { "result", "hit" } });
+  observer->Observe(static_cast<std::int64_t>(stats.revalidations),
+                    { { "result", "revalidated" } });
+  observer->Observe(static_cast<std::int64_t>(stats.misses), { { "result", "miss" } });
+}
+
+void
+observe_evictions(opentelemetry::metrics::ObserverResult result, void* state)
+{
+  observe(result, static_cast<std::int64_t>(cache_stats(state).evictions));
+}
+
+// Keeps the observable instruments alive and detaches their callbacks from the cache
+// before it goes away.
+class cache_instruments
+{
+public:
+  explicit cache_instruments(document_cache& cache)
+    : state_{ &cache }
+  {
+    auto meter = opentelemetry::metrics::Provider::GetMeterProvider()->GetMeter(
+      k_service_name, k_service_version);
+    add(meter->CreateDoubleObservableGauge(
+          "product_cache.hit_ratio", "Fraction of requests served without a round trip", "1"),
+        observe_hit_ratio);
+    add(meter->CreateInt64ObservableGauge(
+          "product_cache.memory", "Bytes held by the product cache", "By"),
+        observe_memory);
+    add(meter->CreateInt64ObservableGauge(
+          "product_cache.entries", "Documents held by the product cache", "{document}"),
+        observe_entries);
+    add(meter->CreateInt64ObservableCounter(
+          "product_cache.requests", "Product cache requests by result", "{request}"),
+        observe_requests);
+    add(meter->CreateInt64ObservableCounter(
+          "product_cache.evictions", "Entries evicted to stay within the memory bound", "{entry}"),
+        observe_evictions);
+  }
+
+  cache_instruments(const cache_instruments&) = delete;
+  auto operator=(const cache_instruments&) -> cache_instruments& = delete;
+
+  ~cache_instruments()
+  {
+    for (auto& [instrument, callback] : instruments_) {
+      instrument->RemoveCallback(callback, state_);
+    }
+  }
+
+private:
+  using instrument_ptr =
+    opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>;
+
+  void add(instrument_ptr instrument, opentelemetry::metrics::ObservableCallbackPtr callback)
+  {
+    instrument->AddCallback(callback, state_);
+    instruments_.emplace_back(std::move(instrument), callback);
+  }
+
+  void* state_;
+  std::vector<std::pair<instrument_ptr, opentelemetry::metrics::ObservableCallbackPtr>>
+    instruments_{};
+};
+
+auto
+make_product_id(std::size_t index) -> std::string
+{
+  return "product::" + std::to_string(index);
+}
+
+auto
+make_product(std::size_t index, std::size_t document_size, std::uint64_t price_cents)
+  -> tao::json::value
+{
+  tao::json::value product{
+    { "sku", make_product_id(index) },
+    { "name", "Product " + std::to_string(index) },
+    { "price_cents", price_cents },
+  };
+  const auto encoded_size = tao::json::to_string(product).size() + 17; // ,"description":""
+  product["description"] =
+    std::string(document_size > encoded_size ? document_size - encoded_size : 0, 'x');
+  return product;
+}
+
+struct worker_stats {
+  std::uint64_t reads{ 0 };
+  std::uint64_t writes{ 0 };
+  std::uint64_t errors{ 0 };
+  std::uint64_t price_sum{ 0 };
+};
+
+auto
+run_worker(const program_config& config,
+           const document_cache& cache,
+           const key_distribution& distribution,
+           std::size_t worker_index,
+           std::size_t operations) -> worker_stats
+{
+  worker_stats stats{};
+  std::mt19937_64 engine{ std::random_device{}() ^ worker_index };
+  for (std::size_t op = 1; op <= operations; ++op) {
+    const auto index = static_cast<std::size_t>(distribution.next(engine));
+    if (config.write_every > 0 && op % config.write_every == 0) {
+      ++stats.writes;
+      const auto product = make_product(index, config.document_size, engine() % 100000);
+      auto [err, resp] = cache.upsert(make_product_id(index), product).get();
+      if (err.ec()) {
+        ++stats.errors;
+      }
+      continue;
+    }
+    ++stats.reads;
+    auto [err, document] = cache.get(make_product_id(index)).get();
+    if (err.ec()) {
+      ++stats.errors;
+      continue;
+    }
+    // The cache stores raw bytes; decoding happens here, on the reader's thread.
+    const auto product = document->content_as<tao::json::value>();
+    stats.price_sum += product.at("price_cents").as<std::uint64_t>();
+  }
+  return stats;
+}
+} // namespace
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+  // The meter must be installed before connect(); see inventory_with_opentelemetry.cpp.
+  auto meter_provider = apply_opentelemetry_meter_options(
+    options,
+    { k_service_name, k_service_version, config.metrics_endpoint, config.metrics_export_interval });
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  {
+    std::vector<std::pair<std::string, tao::json::value>> products;
+    products.reserve(config.num_products);
+    for (std::size_t i = 0; i < config.num_products; ++i) {
+      products.emplace_back(make_product_id(i), make_product(i, config.document_size, 999));
+    }
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : upsert_multi(collection, products)) {
+      if (entry.error.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "Seeded " << config.num_products - failed << " products (" << failed
+              << " failed)\n";
+  }
+
+  document_cache cache{ collection,
+                              { config.cache_shards, config.cache_max_bytes, config.cache_ttl } };
+  const auto distribution = key_distribution::zipfian(config.num_products, config.zipf_theta);
+
+  worker_stats total{};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    const cache_instruments instruments{ cache };
+
+    std::vector<worker_stats> per_worker(config.num_threads);
+    std::vector<std::thread> workers;
+    workers.reserve(config.num_threads);
+    for (std::size_t i = 0; i < config.num_threads; ++i) {
+      const auto operations = config.num_operations / config.num_threads +
+                              (i < config.num_operations % config.num_threads ? 1 : 0);
+      workers.emplace_back([&, i, operations] {
+        per_worker[i] = run_worker(config, cache, distribution, i, operations);
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (const auto& stats : per_worker) {
+      total.reads += stats.reads;
+      total.writes += stats.writes;
+      total.errors += stats.errors;
+    }
+
+    // Export the final values while the callbacks are still attached.
+    meter_provider->ForceFlush();
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  const auto stats = cache.stats();
+  const auto round_trips = stats.misses + stats.revalidations + total.writes;
+  const auto uncached_round_trips = total.reads + total.writes;
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Operations: " << total.reads << " reads, " << total.writes << " writes, "
+            << total.errors << " errors in " << elapsed.count() << "s\n";
+  std::cout << "Cache: " << stats.hits << " hits, " << stats.revalidations << " revalidated, "
+            << stats.misses << " misses, hit ratio " << stats.hit_ratio() * 100 << "%\n";
+  std::cout << "       " << stats.entries << " entries, " << stats.bytes << " bytes, "
+            << stats.evictions << " evictions, " << stats.invalidations << " invalidations\n";
+  std::cout << "KV round trips: " << round_trips << " with cache, " << uncached_round_trips
+            << " without";
+  if (round_trips > 0) {
+    std::cout << " ("
+              << static_cast<double>(uncached_round_trips) / static_cast<double>(round_trips)
+              << "x fewer)";
+  }
+  std::cout << "\n";
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_PRODUCTS"); val != nullptr) {
+    config.num_products = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZE"); val != nullptr) {
+    config.document_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("WRITE_EVERY"); val != nullptr) {
+    config.write_every = std::stoul(val);
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("CACHE_SHARDS"); val != nullptr) {
+    config.cache_shards = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("CACHE_MAX_BYTES"); val != nullptr) {
+    config.cache_max_bytes = std::stoul(val);
+  }
+  if (const auto* val = getenv("CACHE_TTL_MS"); val != nullptr) {
+    config.cache_ttl = std::chrono::milliseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("OTEL_METRICS_ENDPOINT"); val != nullptr) {
+    config.metrics_endpoint = val;
+  }
+  if (const auto* val = getenv("OTEL_METRICS_READER_EXPORT_INTERVAL_MS"); val != nullptr) {
+    config.metrics_export_interval = std::chrono::milliseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "                     CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "                             USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "                              PASSWORD: [HIDDEN]\n";
+  std::cout << "                           BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "                            SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "                       COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "                          NUM_PRODUCTS: " << num_products << "\n";
+  std::cout << "                         DOCUMENT_SIZE: " << document_size << "\n";
+  std::cout << "                           NUM_THREADS: " << num_threads << "\n";
+  std::cout << "                        NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "                           WRITE_EVERY: " << write_every << "\n";
+  std::cout << "                            ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "                          CACHE_SHARDS: " << cache_shards << "\n";
+  std::cout << "                       CACHE_MAX_BYTES: " << cache_max_bytes << "\n";
+  std::cout << "                          CACHE_TTL_MS: " << cache_ttl.count() << "\n";
+  std::cout << "                 OTEL_METRICS_ENDPOINT: "
+            << (metrics_endpoint ? quote(*metrics_endpoint) : "[DEFAULT]") << "\n";
+  std::cout << "OTEL_METRICS_READER_EXPORT_INTERVAL_MS: " << metrics_export_interval.count()
+            << "\n";
+  std::cout << "                               VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "                               PROFILE: " << (profile ? quote(*profile) : "[NONE]")
+            << "\n\n";
+}
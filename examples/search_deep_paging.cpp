@@ -0,0 +1,468 @@
+/*
+ * search_deep_paging — prefetching search-after iterator over scope.search
+ *
+ * Paging with skip/limit forces the Search service to collect, score and sort
+ * skip + limit hits for every page, so page N costs O(N * limit) and the total
+ * scan is quadratic.  The service also rejects windows beyond its result-window
+ * limit (10 000 hits by default), so naive paging cannot reach deep results at all.
+ *
+ * search_pager below pages with "search_after" instead: every request sorts on a
+ * total order (the caller's sort keys with the document ID as tie-breaker) and asks
+ * only for the `limit` hits that follow the last hit of the previous page.  Each page
+ * costs the same, independently of its depth.
+ *
+ * Because page N+1 needs the last hit of page N, requests cannot be issued in
+ * parallel; instead the pager pipelines them: as soon as a page arrives, the next
+ * request is dispatched from the completion handler, until `prefetch_depth` pages are
+ * buffered.  The consumer pulls rows with next(), which only blocks when the buffer is
+ * empty, so network round trips overlap with the consumer's own work.
+ *
+ * The program scans the same query twice — once with naive skip/limit paging and
+ * once with search_pager — and prints hits/s for both.  It works against any Search
+ * endpoint reachable through CONNECTION_STRING, e.g. a local single-node container
+ * with the index from minimal_search.cpp.
+ *
+ * Sort keys: "_id" and stored string fields are supported (a field must be listed in
+ * the index with "store": true).  "_score" cannot be used, because the SDK does not
+ * expose the exact sort value the service used for the score.  A page whose last hit
+ * lacks a sort field, or has a non-string value for it, ends the scan with
+ * decoding_failure after its rows: without that value the next page would skip or
+ * repeat hits.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   SEARCH_INDEX_NAME     (default: travel-inventory-landmarks)
+ *   SEARCH_QUERY          query string; match-all when unset
+ *   PAGE_SIZE             hits per request (default: 500)
+ *   PREFETCH_PAGES        pages buffered ahead of the consumer (default: 4)
+ *   MAX_HITS              stop each scan after this many hits (default: 100000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+#include <couchbase/match_all_query.hxx>
+#include <couchbase/query_string_query.hxx>
+
+#include <tao/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "travel-sample" };
+  std::string scope_name{ "inventory" };
+  std::string index_name{ "travel-inventory-landmarks" };
+  std::optional<std::string> query{}; // match_all_query when not set
+  std::uint32_t page_size{ 500 };
+  std::size_t prefetch_pages{ 4 };
+  std::size_t max_hits{ 100'000 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+class search_pager
+{
+public:
+  search_pager(couchbase::scope scope,
+               std::string index_name,
+               couchbase::search_request request,
+               std::vector<std::string> sort,
+               std::uint32_t page_size,
+               std::size_t prefetch_depth)
+  {
+    // "_id" is unique, so appending it makes the sort order total and search_after
+    // never skips or repeats hits that share all other sort values.
+    if (std::find(sort.begin(), sort.end(), "_id") == sort.end() &&
+        std::find(sort.begin(), sort.end(), "-_id") == sort.end()) {
+      sort.emplace_back("_id");
+    }
+    state_ = std::make_shared<state>(std::move(scope),
+                                     std::move(index_name),
+                                     std::move(request),
+                                     std::move(sort),
+                                     std::max<std::uint32_t>(page_size, 1),
+                                     std::max<std::size_t>(prefetch_depth, 1));
+
+    std::unique_lock lock(state_->mutex);
+    if (state_->claim_fetch()) {
+      lock.unlock();
+      fetch(state_);
+    }
+  }
+
+  search_pager(const search_pager&) = delete;
+  auto operator=(const search_pager&) -> search_pager& = delete;
+
+  ~search_pager()
+  {
+    // An in-flight request keeps the state alive; this only stops further prefetching.
+    std::scoped_lock lock(state_->mutex);
+    state_->cancelled = true;
+  }
+
+  // Returns the next hit, or an empty optional once the result set is exhausted.
+  // Blocks only when no prefetched page is available.
+  auto next() -> std::pair<couchbase::error, std::optional<couchbase::search_row>>
+  {
+    std::unique_lock lock(state_->mutex);
+    while (state_->current.empty() || state_->position == state_->current.size()) {
+      state_->current.clear();
+      state_->position = 0;
+      state_->cv.wait(lock, [this] {
+        return !state_->pages.empty() || state_->error.ec() ||
+               (state_->exhausted && !state_->in_flight);
+      });
+      if (state_->pages.empty()) {
+        return { state_->error, std::nullopt };
+      }
+      state_->current = std::move(state_->pages.front());
+      state_->pages.pop_front();
+
+      // Room in the buffer again: resume prefetching if it was paused.
+      if (state_->claim_fetch()) {
+        lock.unlock();
+        fetch(state_);
+        lock.lock();
+      }
+    }
+    return { {}, std::move(state_->current[state_->position++]) };
+  }
+
+  [[nodiscard]] auto requests_sent() const -> std::size_t
+  {
+    std::scoped_lock lock(state_->mutex);
+    return state_->requests_sent;
+  }
+
+private:
+  struct state {
+    state(couchbase::scope scope,
+          std::string index_name,
+          couchbase::search_request request,
+          std::vector<std::string> sort,
+          std::uint32_t page_size,
+          std::size_t prefetch_depth)
+      : scope{ std::move(scope) }
+      , index_name{ std::move(index_name) }
+      , request{ std::move(request) }
+      , sort{ std::move(sort) }
+      , page_size{ page_size }
+      , prefetch_depth{ prefetch_depth }
+    {
+    }
+
+    const couchbase::scope scope;
+    const std::string index_name;
+    const couchbase::search_request request;
+    const std::vector<std::string> sort;
+    const std::uint32_t page_size;
+    const std::size_t prefetch_depth;
+
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::deque<std::vector<couchbase::search_row>> pages{};
+    std::vector<couchbase::search_row> current{};
+    std::size_t position{ 0 };
+    std::vector<std::string> search_after{};
+    couchbase::error error{};
+    bool in_flight{ false };
+    bool exhausted{ false };
+    bool cancelled{ false };
+    std::size_t requests_sent{ 0 };
+
+    // Must be called with mutex held.  Returns true when the caller has to dispatch
+    // the next request (after releasing the mutex).
+    auto claim_fetch() -> bool
+    {
+      if (in_flight || exhausted || cancelled || error.ec() || pages.size() >= prefetch_depth) {
+        return false;
+      }
+      in_flight = true;
+      ++requests_sent;
+      return true;
+    }
+
+    // The values of the sort keys for the given hit, in the same order as `sort`.
+    auto sort_values(const couchbase::search_row& row) const
+      -> std::pair<couchbase::error, std::vector<std::string>>
+    {
+      std::vector<std::string> values;
+      values.reserve(sort.size());
+      std::optional<tao::json::value> fields{};
+      for (const auto& key : sort) {
+        const auto name = (!key.empty() && key[0] == '-') ? key.substr(1) : key;
+        if (name == "_id") {
+          values.emplace_back(row.id());
+          continue;
+        }
+        if (!fields) {
+          fields = row.fields_as<couchbase::codec::tao_json_serializer>();
+        }
+        const auto* field = fields->find(name);
+        if (field == nullptr || !field->is_string()) {
+          return { couchbase::error{ couchbase::errc::common::decoding_failure,
+                                     "search_pager: sort field \"" + name +
+                                       "\" is missing or not a string in hit " + row.id() },
+                   {} };
+        }
+        values.emplace_back(field->get_string());
+      }
+      return { {}, std::move(values) };
+    }
+  };
+
+  static void fetch(std::shared_ptr<state> self)
+  {
+    std::vector<std::string> fields{};
+    for (const auto& key : self->sort) {
+      const auto name = (!key.empty() && key[0] == '-') ? key.substr(1) : key;
+      if (name != "_id") {
+        fields.emplace_back(name); // sort values of stored fields are read back from the hit
+      }
+    }
+    auto options = couchbase::search_options{}.limit(self->page_size).sort(self->sort);
+    if (!fields.empty()) {
+      options.fields(fields);
+    }
+    if (!self->search_after.empty()) {
+      options.raw("search_after", self->search_after);
+    }
+
+    self->scope.search(
+      self->index_name, self->request, options, [self](auto err, auto resp) {
+        std::unique_lock lock(self->mutex);
+        self->in_flight = false;
+        if (err.ec()) {
+          self->error = std::move(err);
+        } else {
+          auto rows = resp.rows();
+          if (rows.size() < self->page_size) {
+            self->exhausted = true;
+          }
+          if (!self->exhausted) {
+            // The rows of this page are still delivered; the scan stops after them.
+            auto [sort_err, values] = self->sort_values(rows.back());
+            self->error = std::move(sort_err);
+            self->search_after = std::move(values);
+          }
+          if (!rows.empty()) {
+            self->pages.emplace_back(std::move(rows));
+          }
+        }
+        const bool dispatch = self->claim_fetch();
+        lock.unlock();
+        self->cv.notify_all();
+        if (dispatch) {
+          fetch(self);
+        }
+      });
+  }
+
+  std::shared_ptr<state> state_;
+};
+
+struct scan_summary {
+  std::size_t hits{ 0 };
+  std::size_t requests{ 0 };
+  std::chrono::nanoseconds elapsed{};
+  couchbase::error error{};
+};
+
+void
+print_summary(const std::string& name, const scan_summary& summary)
+{
+  const auto seconds = std::chrono::duration<double>(summary.elapsed).count();
+  std::cout << std::left << std::setw(14) << name << std::right << " hits: " << std::setw(8)
+            << summary.hits << ", requests: " << std::setw(5) << summary.requests
+            << ", elapsed: " << std::fixed << std::setprecision(3) << seconds << " s"
+            << ", throughput: " << std::setprecision(0)
+            << (seconds > 0 ? static_cast<double>(summary.hits) / seconds : 0.0) << " hits/s";
+  if (summary.error.ec()) {
+    std::cout << ", stopped by error: " << summary.error.ec().message();
+  }
+  std::cout << "\n";
+}
+
+// Baseline: one request per page, each asking for skip=N*limit.
+auto
+scan_with_skip_limit(const couchbase::scope& scope,
+                     const program_config& config,
+                     const couchbase::search_request& request) -> scan_summary
+{
+  scan_summary summary{};
+  const auto start = std::chrono::steady_clock::now();
+  while (summary.hits < config.max_hits) {
+    auto options = couchbase::search_options{}
+                     .skip(static_cast<std::uint32_t>(summary.hits))
+                     .limit(config.page_size)
+                     .sort({ "_id" });
+    auto [err, resp] = scope.search(config.index_name, request, options).get();
+    ++summary.requests;
+    if (err.ec()) {
+      summary.error = err;
+      break;
+    }
+    summary.hits += resp.rows().size();
+    if (resp.rows().size() < config.page_size) {
+      break;
+    }
+  }
+  summary.elapsed = std::chrono::steady_clock::now() - start;
+  return summary;
+}
+
+auto
+scan_with_pager(const couchbase::scope& scope,
+                const program_config& config,
+                const couchbase::search_request& request) -> scan_summary
+{
+  scan_summary summary{};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    search_pager pager(
+      scope, config.index_name, request, { "_id" }, config.page_size, config.prefetch_pages);
+    while (summary.hits < config.max_hits) {
+      auto [err, row] = pager.next();
+      if (err.ec()) {
+        summary.error = err;
+        break;
+      }
+      if (!row) {
+        break;
+      }
+      ++summary.hits;
+    }
+    summary.requests = pager.requests_sent();
+  }
+  summary.elapsed = std::chrono::steady_clock::now() - start;
+  return summary;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto scope = cluster.bucket(config.bucket_name).scope(config.scope_name);
+  const auto request = config.query
+                         ? couchbase::search_request(couchbase::query_string_query(*config.query))
+                         : couchbase::search_request(couchbase::match_all_query{});
+
+  print_summary("skip/limit", scan_with_skip_limit(scope, config, request));
+  print_summary("search_after", scan_with_pager(scope, config, request));
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  // Override defaults with environment variables when present
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("SEARCH_INDEX_NAME"); val != nullptr) {
+    config.index_name = val;
+  }
+  if (const auto* val = getenv("SEARCH_QUERY"); val != nullptr) {
+    config.query = val;
+  }
+  if (const auto* val = getenv("PAGE_SIZE"); val != nullptr) {
+    config.page_size = static_cast<std::uint32_t>(std::stoul(val));
+  }
+  if (const auto* val = getenv("PREFETCH_PAGES"); val != nullptr) {
+    config.prefetch_pages = std::stoul(val);
+  }
+  if (const auto* val = getenv("MAX_HITS"); val != nullptr) {
+    config.max_hits = std::stoul(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "  SEARCH_INDEX_NAME: " << quote(index_name) << "\n";
+  std::cout << "       SEARCH_QUERY: " << (query ? quote(*query) : "[MATCH ALL]") << "\n";
+  std::cout << "          PAGE_SIZE: " << page_size << "\n";
+  std::cout << "     PREFETCH_PAGES: " << prefetch_pages << "\n";
+  std::cout << "           MAX_HITS: " << max_hits << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,360 @@
+/*
+ * search_multi_index — concurrent fan-out over several Search indexes with
+ * client-side top-k merge
+ *
+ * When the same data is split across several indexes (for example one index per
+ * region, each built like travel-inventory-landmarks in minimal_search.cpp), a query
+ * has to be sent to every index and the hits merged by score.
+ *
+ * fan_out_search() issues scope.search() against all indexes at once and merges the
+ * hits as responses arrive into a bounded min-heap of size k: a hit only enters the
+ * heap when it beats the current k-th best score.  The global top k by score can only
+ * contain hits from each index's own top k, so no index is asked for more than k hits,
+ * whatever the per-index limit says.  Every response is released right after merging.
+ * The heap holds at most k hits and each response at most k rows, so memory is O(k)
+ * per index at worst, when the responses of all indexes are alive at once.
+ *
+ * Each index gets its own timeout.  An index that fails or times out does not fail
+ * the whole request: its error is reported in fan_out_result::outcomes, and the
+ * merged hits of the remaining indexes are still returned (is_partial() == true).
+ *
+ * Scores are comparable across indexes only when the indexes share the same mapping
+ * and analyzers, which holds for per-region copies of one index definition.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   SEARCH_INDEX_NAMES    comma-separated list (default: travel-inventory-landmarks)
+ *   SEARCH_QUERY          (default: "nice bar")
+ *   TOP_K                 number of merged hits to return (default: 10)
+ *   PER_INDEX_LIMIT       hits requested from every index, at most TOP_K (default: TOP_K)
+ *   PER_INDEX_TIMEOUT_MS  timeout of each index request (default: 2000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+#include <couchbase/query_string_query.hxx>
+
+#include <tao/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "travel-sample" };
+  std::string scope_name{ "inventory" };
+  std::vector<std::string> index_names{ "travel-inventory-landmarks" };
+  std::string query{ "nice bar" };
+  std::size_t top_k{ 10 };
+  std::optional<std::uint32_t> per_index_limit{};
+  std::chrono::milliseconds per_index_timeout{ 2'000 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct merged_hit {
+  std::string index_name;
+  couchbase::search_row row;
+};
+
+struct index_outcome {
+  std::string index_name;
+  couchbase::error error{};
+  std::size_t hits{ 0 };
+  std::chrono::milliseconds elapsed{};
+};
+
+struct fan_out_result {
+  std::vector<merged_hit> hits{};        // best first
+  std::vector<index_outcome> outcomes{}; // same order as the requested indexes
+
+  [[nodiscard]] auto is_partial() const -> bool
+  {
+    return std::any_of(outcomes.begin(), outcomes.end(), [](const auto& outcome) {
+      return static_cast<bool>(outcome.error.ec());
+    });
+  }
+};
+
+using fan_out_handler = std::function<void(fan_out_result)>;
+
+namespace
+{
+// Orders hits best-first: higher score wins, ties are broken by document ID so that
+// the merged result does not depend on the order in which indexes answered.
+auto
+better_hit(const merged_hit& lhs, const merged_hit& rhs) -> bool
+{
+  if (lhs.row.score() != rhs.row.score()) {
+    return lhs.row.score() > rhs.row.score();
+  }
+  return lhs.row.id() < rhs.row.id();
+}
+
+struct worse_on_top {
+  auto operator()(const merged_hit& lhs, const merged_hit& rhs) const -> bool
+  {
+    return better_hit(lhs, rhs);
+  }
+};
+
+// Shared by all index requests of a single fan-out.  The heap keeps the worst of the
+// current top-k on top, so a new hit is compared against one element only.
+struct fan_out_state {
+  std::mutex mutex{};
+  std::size_t k{};
+  std::priority_queue<merged_hit, std::vector<merged_hit>, worse_on_top> top{};
+  std::vector<index_outcome> outcomes{};
+  std::size_t pending{};
+  fan_out_handler handler{};
+
+  // Must be called with mutex held.
+  void offer(const std::string& index_name, const couchbase::search_row& row)
+  {
+    merged_hit candidate{ index_name, row };
+    if (top.size() < k) {
+      top.push(std::move(candidate));
+    } else if (better_hit(candidate, top.top())) {
+      top.pop();
+      top.push(std::move(candidate));
+    }
+  }
+};
+} // namespace
+
+void
+fan_out_search(const couchbase::scope& scope,
+               const std::vector<std::string>& index_names,
+               const couchbase::search_request& request,
+               std::size_t k,
+               std::uint32_t per_index_limit,
+               std::chrono::milliseconds per_index_timeout,
+               fan_out_handler&& handler)
+{
+  auto state = std::make_shared<fan_out_state>();
+  state->k = k;
+  state->pending = index_names.size();
+  state->handler = std::move(handler);
+  state->outcomes.reserve(index_names.size());
+  for (const auto& name : index_names) {
+    state->outcomes.push_back({ name });
+  }
+  if (index_names.empty() || k == 0) {
+    return state->handler({ {}, std::move(state->outcomes) });
+  }
+
+  // Hits below an index's k-th best cannot make the merged top k.
+  const auto limit = static_cast<std::uint32_t>(std::min<std::size_t>(per_index_limit, k));
+  const auto options = couchbase::search_options{}.limit(limit).timeout(per_index_timeout);
+  for (std::size_t i = 0; i < index_names.size(); ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    scope.search(index_names[i], request, options, [state, i, start](auto err, auto resp) {
+      std::unique_lock lock(state->mutex);
+      auto& outcome = state->outcomes[i];
+      outcome.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+      if (err.ec()) {
+        outcome.error = std::move(err);
+      } else {
+        outcome.hits = resp.rows().size();
+        for (const auto& row : resp.rows()) {
+          state->offer(outcome.index_name, row);
+        }
+      }
+      if (--state->pending > 0) {
+        return;
+      }
+
+      // Last response: drain the heap (worst first) into a best-first vector.
+      fan_out_result result{};
+      result.hits.reserve(state->top.size());
+      while (!state->top.empty()) {
+        result.hits.push_back(state->top.top());
+        state->top.pop();
+      }
+      std::reverse(result.hits.begin(), result.hits.end());
+      result.outcomes = std::move(state->outcomes);
+      auto complete = std::move(state->handler);
+      lock.unlock();
+      complete(std::move(result));
+    });
+  }
+}
+
+auto
+fan_out_search(const couchbase::scope& scope,
+               const std::vector<std::string>& index_names,
+               const couchbase::search_request& request,
+               std::size_t k,
+               std::uint32_t per_index_limit,
+               std::chrono::milliseconds per_index_timeout) -> std::future<fan_out_result>
+{
+  auto barrier = std::make_shared<std::promise<fan_out_result>>();
+  auto future = barrier->get_future();
+  fan_out_search(
+    scope, index_names, request, k, per_index_limit, per_index_timeout, [barrier](auto result) {
+      barrier->set_value(std::move(result));
+    });
+  return future;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto scope = cluster.bucket(config.bucket_name).scope(config.scope_name);
+
+  const auto per_index_limit =
+    config.per_index_limit.value_or(static_cast<std::uint32_t>(config.top_k));
+  const couchbase::search_request request(couchbase::query_string_query(config.query));
+  auto result = fan_out_search(scope,
+                               config.index_names,
+                               request,
+                               config.top_k,
+                               per_index_limit,
+                               config.per_index_timeout)
+                  .get();
+
+  for (const auto& outcome : result.outcomes) {
+    std::cout << "index: " << program_config::quote(outcome.index_name)
+              << ", hits: " << outcome.hits << ", elapsed: " << outcome.elapsed.count() << " ms";
+    if (outcome.error.ec()) {
+      std::cout << ", error: " << outcome.error.ec().message();
+    }
+    std::cout << "\n";
+  }
+  std::cout << "merged top-" << config.top_k << (result.is_partial() ? " (partial)" : "")
+            << ":\n";
+  for (const auto& hit : result.hits) {
+    std::cout << "score: " << std::fixed << std::setprecision(6) << hit.row.score()
+              << ", index: \"" << hit.index_name << "\", id: \"" << hit.row.id() << "\"\n";
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  // Override defaults with environment variables when present
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("SEARCH_INDEX_NAMES"); val != nullptr) {
+    config.index_names.clear();
+    std::istringstream stream(val);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+      if (!name.empty()) {
+        config.index_names.push_back(name);
+      }
+    }
+  }
+  if (const auto* val = getenv("SEARCH_QUERY"); val != nullptr) {
+    config.query = val;
+  }
+  if (const auto* val = getenv("TOP_K"); val != nullptr) {
+    config.top_k = std::stoul(val);
+  }
+  if (const auto* val = getenv("PER_INDEX_LIMIT"); val != nullptr) {
+    config.per_index_limit = static_cast<std::uint32_t>(std::stoul(val));
+  }
+  if (const auto* val = getenv("PER_INDEX_TIMEOUT_MS"); val != nullptr) {
+    config.per_index_timeout = std::chrono::milliseconds(std::stoul(val));
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "     CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "             USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "              PASSWORD: [HIDDEN]\n";
+  std::cout << "           BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "            SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    SEARCH_INDEX_NAMES: [";
+  for (std::size_t i = 0; i < index_names.size(); ++i) {
+    std::cout << (i > 0 ? ", " : "") << quote(index_names[i]);
+  }
+  std::cout << "]\n";
+  std::cout << "          SEARCH_QUERY: " << quote(query) << "\n";
+  std::cout << "                 TOP_K: " << top_k << "\n";
+  std::cout << "       PER_INDEX_LIMIT: "
+            << (per_index_limit ? std::to_string(*per_index_limit) : "[TOP_K]") << "\n";
+  std::cout << "  PER_INDEX_TIMEOUT_MS: " << per_index_timeout.count() << "\n";
+  std::cout << "               VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "               PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
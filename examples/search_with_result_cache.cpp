@@ -0,0 +1,610 @@
+/*
+ * search_with_result_cache — coalescing, TTL-bounded front-end for scope.search
+ *
+ * Landing pages tend to fire the very same Search query (for example the
+ * `query_string_query("nice bar")` from minimal_search.cpp) many times per second.
+ * Every one of those requests makes the Search service parse, score and sort the
+ * same hits again.  search_frontend below sits in front of scope.search() and
+ *
+ *   1. canonicalizes the query and its options into a cache key,
+ *   2. coalesces concurrent identical requests into a single in-flight call
+ *      ("single flight"): the first caller dispatches, later callers just queue
+ *      their handlers and are completed with the same result,
+ *   3. keeps successful results in an LRU cache bounded by entry count, where each
+ *      entry expires after a fixed TTL, so that stale results age out on their own.
+ *
+ * Errors are never cached: every waiter of a failed flight gets the error, and the
+ * next request dispatches again.
+ *
+ * The SDK's search_request/search_options are write-only builders, so the
+ * front-end accepts its own cached_search_options description, derives the cache
+ * key from it, and builds the SDK options only when it has to dispatch.
+ *
+ * Counters (requests, hits, misses, coalesced, expirations, evictions) are kept in
+ * atomics and can be sampled at any time with search_frontend::stats().  Given a
+ * couchbase::metrics::meter, the front-end also publishes every request through it: the
+ * "search_cache.duration" value recorder gets the request's latency in microseconds,
+ * tagged with result=hit|coalesced|miss, so the count per tag gives the hit ratio and
+ * the coalesced requests wherever the meter exports to.  This program installs the same
+ * counting_meter as the cluster's meter, next to the SDK's own operation metrics, and
+ * prints what it received; otel_meter (inventory_with_opentelemetry.cpp) would export
+ * both instead.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   SEARCH_INDEX_NAME     (default: travel-inventory-landmarks, see minimal_search.cpp)
+ *   SEARCH_QUERY          (default: "nice bar")
+ *   NUM_REQUESTS          total number of requests to fire (default: 500)
+ *   NUM_CONCURRENT        requests fired per wave before waiting (default: 50)
+ *   CACHE_TTL_MS          time-to-live of a cached result (default: 1000)
+ *   CACHE_MAX_ENTRIES     upper bound of cached results (default: 1024)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+#include <couchbase/metrics/meter.hxx>
+#include <couchbase/query_string_query.hxx>
+
+#include <tao/json.hpp>
+#include <tao/json/to_string.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "travel-sample" };
+  std::string scope_name{ "inventory" };
+  std::string index_name{ "travel-inventory-landmarks" };
+  std::string query{ "nice bar" };
+  std::size_t num_requests{ 500 };
+  std::size_t num_concurrent{ 50 };
+  std::chrono::milliseconds cache_ttl{ 1'000 };
+  std::size_t cache_max_entries{ 1'024 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+// Subset of couchbase::search_options that takes part in the cache key.
+// Order of `fields` and `collections` does not change the result, so they are
+// sorted before hashing; order of `sort` does, so it is kept as given.
+struct cached_search_options {
+  std::optional<std::uint32_t> limit{};
+  std::optional<std::uint32_t> skip{};
+  std::vector<std::string> fields{};
+  std::vector<std::string> collections{};
+  std::vector<std::string> sort{};
+  std::optional<std::chrono::milliseconds> timeout{};
+
+  [[nodiscard]] auto to_search_options() const -> couchbase::search_options
+  {
+    couchbase::search_options options{};
+    if (limit) {
+      options.limit(limit.value());
+    }
+    if (skip) {
+      options.skip(skip.value());
+    }
+    if (!fields.empty()) {
+      options.fields(fields);
+    }
+    if (!collections.empty()) {
+      options.collections(collections);
+    }
+    if (!sort.empty()) {
+      options.sort(sort);
+    }
+    if (timeout) {
+      options.timeout(timeout.value());
+    }
+    return options;
+  }
+};
+
+using cached_search_result = std::shared_ptr<const couchbase::search_result>;
+using cached_search_handler = std::function<void(couchbase::error, cached_search_result)>;
+
+// couchbase::metrics::meter that counts the values recorded per instrument and tag set,
+// and keeps their sum.  Enough to see what a meter receives without an exporter.
+class counting_meter : public couchbase::metrics::meter
+{
+public:
+  auto get_value_recorder(const std::string& name,
+                          const std::map<std::string, std::string>& tags)
+    -> std::shared_ptr<couchbase::metrics::value_recorder> override
+  {
+    auto key = name;
+    for (const auto& [tag, value] : tags) {
+      key += (key.size() == name.size() ? " " : ",") + tag + "=" + value;
+    }
+    const std::scoped_lock lock(mutex_);
+    auto& recorder = recorders_[key];
+    if (!recorder) {
+      recorder = std::make_shared<counting_recorder>();
+    }
+    return recorder;
+  }
+
+  void dump() const
+  {
+    const std::scoped_lock lock(mutex_);
+    for (const auto& [key, recorder] : recorders_) {
+      const auto count = recorder->count.load(std::memory_order_relaxed);
+      const auto sum = recorder->sum.load(std::memory_order_relaxed);
+      std::cout << "  " << key << ": " << count << " values, mean "
+                << (count == 0 ? 0 : sum / static_cast<std::int64_t>(count)) << "\n";
+    }
+  }
+
+private:
+  struct counting_recorder : couchbase::metrics::value_recorder {
+    std::atomic_uint64_t count{ 0 };
+    std::atomic_int64_t sum{ 0 };
+
+    void record_value(std::int64_t value) override
+    {
+      count.fetch_add(1, std::memory_order_relaxed);
+      sum.fetch_add(value, std::memory_order_relaxed);
+    }
+  };
+
+  mutable std::mutex mutex_{};
+  std::map<std::string, std::shared_ptr<counting_recorder>> recorders_{};
+};
+
+class search_frontend
+{
+public:
+  struct stats_snapshot {
+    std::uint64_t requests{};
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t coalesced{};
+    std::uint64_t expirations{};
+    std::uint64_t evictions{};
+    std::size_t entries{};
+
+    // Fraction of requests answered without dispatching to the Search service:
+    // both cache hits and requests that joined an in-flight call.
+    [[nodiscard]] auto hit_ratio() const -> double
+    {
+      if (requests == 0) {
+        return 0.0;
+      }
+      return static_cast<double>(hits + coalesced) / static_cast<double>(requests);
+    }
+  };
+
+  search_frontend(couchbase::scope scope,
+                  std::size_t max_entries,
+                  std::chrono::milliseconds ttl,
+                  const std::shared_ptr<couchbase::metrics::meter>& meter = {})
+    : scope_{ std::move(scope) }
+    , max_entries_{ std::max<std::size_t>(max_entries, 1) }
+    , ttl_{ ttl }
+  {
+    if (meter) {
+      for (const auto result : { request_result::hit,
+                                 request_result::coalesced,
+                                 request_result::miss }) {
+        recorders_[static_cast<std::size_t>(result)] = meter->get_value_recorder(
+          "search_cache.duration", { { "result", to_string(result) } });
+      }
+    }
+  }
+
+  void search(const std::string& index_name,
+              const couchbase::search_query& query,
+              const cached_search_options& options,
+              cached_search_handler&& handler)
+  {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+
+    auto encoded = query.encode();
+    if (encoded.ec) {
+      return handler(couchbase::error{ encoded.ec, "unable to encode search query" }, {});
+    }
+    auto key = make_key(index_name, encoded.query, options);
+
+    {
+      std::unique_lock lock(mutex_);
+      if (auto hit = lookup(key); hit) {
+        lock.unlock();
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return timed(request_result::hit, start, std::move(handler))({}, std::move(hit));
+      }
+      if (auto flight = in_flight_.find(key); flight != in_flight_.end()) {
+        flight->second.push_back(timed(request_result::coalesced, start, std::move(handler)));
+        coalesced_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      in_flight_[key].push_back(timed(request_result::miss, start, std::move(handler)));
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    scope_.search(index_name,
+                  couchbase::search_request(query),
+                  options.to_search_options(),
+                  [this, key = std::move(key)](auto err, auto resp) mutable {
+                    complete(std::move(key), std::move(err), std::move(resp));
+                  });
+  }
+
+  auto search(const std::string& index_name,
+              const couchbase::search_query& query,
+              const cached_search_options& options)
+    -> std::future<std::pair<couchbase::error, cached_search_result>>
+  {
+    auto barrier =
+      std::make_shared<std::promise<std::pair<couchbase::error, cached_search_result>>>();
+    auto future = barrier->get_future();
+    search(index_name, query, options, [barrier](auto err, auto result) {
+      barrier->set_value({ std::move(err), std::move(result) });
+    });
+    return future;
+  }
+
+  [[nodiscard]] auto stats() const -> stats_snapshot
+  {
+    stats_snapshot snapshot{};
+    snapshot.requests = requests_.load(std::memory_order_relaxed);
+    snapshot.hits = hits_.load(std::memory_order_relaxed);
+    snapshot.misses = misses_.load(std::memory_order_relaxed);
+    snapshot.coalesced = coalesced_.load(std::memory_order_relaxed);
+    snapshot.expirations = expirations_.load(std::memory_order_relaxed);
+    snapshot.evictions = evictions_.load(std::memory_order_relaxed);
+
+    std::scoped_lock lock(mutex_);
+    snapshot.entries = entries_.size();
+    return snapshot;
+  }
+
+private:
+  enum class request_result : std::size_t {
+    hit,
+    coalesced,
+    miss,
+  };
+
+  static auto to_string(request_result result) -> std::string
+  {
+    switch (result) {
+      case request_result::hit:
+        return "hit";
+      case request_result::coalesced:
+        return "coalesced";
+      case request_result::miss:
+        return "miss";
+    }
+    return "unknown";
+  }
+
+  // Records the latency of the request in the meter, if there is one, before `handler` runs.
+  auto timed(request_result result,
+             std::chrono::steady_clock::time_point start,
+             cached_search_handler&& handler) const -> cached_search_handler
+  {
+    const auto& recorder = recorders_[static_cast<std::size_t>(result)];
+    if (!recorder) {
+      return std::move(handler);
+    }
+    return [recorder, start, handler = std::move(handler)](auto err, auto cached) {
+      recorder->record_value(std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+      handler(std::move(err), std::move(cached));
+    };
+  }
+
+  struct cache_entry {
+    std::string key;
+    cached_search_result result;
+    std::chrono::steady_clock::time_point expires_at;
+  };
+  using lru_list = std::list<cache_entry>;
+
+  static auto make_key(const std::string& index_name,
+                       const tao::json::value& encoded_query,
+                       const cached_search_options& options) -> std::string
+  {
+    // '\x1f' (unit separator) cannot appear in index names or field names, so the
+    // concatenation below is unambiguous.
+    constexpr char separator{ '\x1f' };
+    const auto append_list = [](std::string& out, std::vector<std::string> items, bool sorted) {
+      if (sorted) {
+        std::sort(items.begin(), items.end());
+      }
+      for (const auto& item : items) {
+        out += item;
+        out += ',';
+      }
+      out += separator;
+    };
+
+    // tao::json objects keep their members ordered by key, so to_string() already
+    // yields a canonical representation of the query.
+    std::string key = index_name;
+    key += separator;
+    key += tao::json::to_string(encoded_query);
+    key += separator;
+    key += options.limit ? std::to_string(options.limit.value()) : "-";
+    key += separator;
+    key += options.skip ? std::to_string(options.skip.value()) : "-";
+    key += separator;
+    append_list(key, options.fields, true);
+    append_list(key, options.collections, true);
+    append_list(key, options.sort, false);
+    return key;
+  }
+
+  // Must be called with mutex_ held.
+  auto lookup(const std::string& key) -> cached_search_result
+  {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return {};
+    }
+    if (it->second->expires_at <= std::chrono::steady_clock::now()) {
+      entries_.erase(it->second);
+      index_.erase(it);
+      expirations_.fetch_add(1, std::memory_order_relaxed);
+      return {};
+    }
+    // Move to the front of the LRU list, iterators stay valid.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->result;
+  }
+
+  // Must be called with mutex_ held.
+  void store(const std::string& key, cached_search_result result)
+  {
+    if (auto it = index_.find(key); it != index_.end()) {
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    entries_.push_front({ key, std::move(result), std::chrono::steady_clock::now() + ttl_ });
+    index_[key] = entries_.begin();
+    while (entries_.size() > max_entries_) {
+      index_.erase(entries_.back().key);
+      entries_.pop_back();
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void complete(std::string key, couchbase::error err, couchbase::search_result resp)
+  {
+    cached_search_result result{};
+    if (!err.ec()) {
+      result = std::make_shared<const couchbase::search_result>(std::move(resp));
+    }
+
+    std::vector<cached_search_handler> waiters;
+    {
+      std::scoped_lock lock(mutex_);
+      if (auto flight = in_flight_.find(key); flight != in_flight_.end()) {
+        waiters = std::move(flight->second);
+        in_flight_.erase(flight);
+      }
+      if (result) {
+        store(key, result);
+      }
+    }
+
+    // Handlers are invoked outside of the lock, so they are free to issue new searches.
+    for (auto& waiter : waiters) {
+      waiter(err, result);
+    }
+  }
+
+  couchbase::scope scope_;
+  const std::size_t max_entries_;
+  const std::chrono::milliseconds ttl_;
+
+  mutable std::mutex mutex_{};
+  lru_list entries_{};
+  std::unordered_map<std::string, lru_list::iterator> index_{};
+  std::unordered_map<std::string, std::vector<cached_search_handler>> in_flight_{};
+  std::array<std::shared_ptr<couchbase::metrics::value_recorder>, 3> recorders_{};
+
+  std::atomic_uint64_t requests_{ 0 };
+  std::atomic_uint64_t hits_{ 0 };
+  std::atomic_uint64_t misses_{ 0 };
+  std::atomic_uint64_t coalesced_{ 0 };
+  std::atomic_uint64_t expirations_{ 0 };
+  std::atomic_uint64_t evictions_{ 0 };
+};
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  // The front-end publishes through the same meter as the SDK's operation metrics.
+  auto meter = std::make_shared<counting_meter>();
+  options.metrics().enable(true);
+  options.metrics().meter(meter);
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  search_frontend frontend(cluster.bucket(config.bucket_name).scope(config.scope_name),
+                           config.cache_max_entries,
+                           config.cache_ttl,
+                           meter);
+
+  const couchbase::query_string_query query(config.query);
+  cached_search_options search_options{};
+  search_options.fields = { "content" };
+
+  // Simulate bursts of landing-page traffic: every wave fires num_concurrent identical
+  // searches at once, then waits for all of them before starting the next wave.
+  std::size_t error_count{ 0 };
+  std::string last_error{};
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t sent = 0; sent < config.num_requests;) {
+    const auto wave_size = std::min(config.num_concurrent, config.num_requests - sent);
+    std::vector<std::future<std::pair<couchbase::error, cached_search_result>>> wave;
+    wave.reserve(wave_size);
+    for (std::size_t i = 0; i < wave_size; ++i) {
+      wave.emplace_back(frontend.search(config.index_name, query, search_options));
+    }
+    for (auto& f : wave) {
+      if (auto [err, result] = f.get(); err.ec()) {
+        ++error_count;
+        last_error = err.ec().message();
+      }
+    }
+    sent += wave_size;
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  // One more call to show the rows, most likely answered from the cache
+  if (auto [err, result] = frontend.search(config.index_name, query, search_options).get();
+      !err.ec()) {
+    for (const auto& row : result->rows()) {
+      auto fields = row.fields_as<couchbase::codec::tao_json_serializer>();
+      std::cout << "score: " << row.score() << ", id: \"" << row.id() << "\", content: \""
+                << fields["content"].get_string() << "\"\n";
+    }
+  }
+
+  const auto stats = frontend.stats();
+  std::cout << "\n";
+  std::cout << "     duration: " << elapsed.count() << " ms\n";
+  std::cout << "     requests: " << stats.requests << "\n";
+  std::cout << "  cache hits : " << stats.hits << "\n";
+  std::cout << "  coalesced  : " << stats.coalesced << "\n";
+  std::cout << "  dispatched : " << stats.misses << "\n";
+  std::cout << "  expirations: " << stats.expirations << "\n";
+  std::cout << "  evictions  : " << stats.evictions << "\n";
+  std::cout << "  entries    : " << stats.entries << "\n";
+  std::cout << "  hit ratio  : " << std::fixed << std::setprecision(3) << stats.hit_ratio()
+            << "\n";
+  std::cout << "       errors: " << error_count;
+  if (!last_error.empty()) {
+    std::cout << " (last: " << last_error << ")";
+  }
+  std::cout << "\n\nmeter:\n";
+  meter->dump();
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  // Override defaults with environment variables when present
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("SEARCH_INDEX_NAME"); val != nullptr) {
+    config.index_name = val;
+  }
+  if (const auto* val = getenv("SEARCH_QUERY"); val != nullptr) {
+    config.query = val;
+  }
+  if (const auto* val = getenv("NUM_REQUESTS"); val != nullptr) {
+    config.num_requests = std::stoul(val);
+  }
+  if (const auto* val = getenv("NUM_CONCURRENT"); val != nullptr) {
+    config.num_concurrent = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("CACHE_TTL_MS"); val != nullptr) {
+    config.cache_ttl = std::chrono::milliseconds(std::stoul(val));
+  }
+  if (const auto* val = getenv("CACHE_MAX_ENTRIES"); val != nullptr) {
+    config.cache_max_entries = std::stoul(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "  SEARCH_INDEX_NAME: " << quote(index_name) << "\n";
+  std::cout << "       SEARCH_QUERY: " << quote(query) << "\n";
+  std::cout << "       NUM_REQUESTS: " << num_requests << "\n";
+  std::cout << "     NUM_CONCURRENT: " << num_concurrent << "\n";
+  std::cout << "       CACHE_TTL_MS: " << cache_ttl.count() << "\n";
+  std::cout << "  CACHE_MAX_ENTRIES: " << cache_max_entries << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,300 @@
+/*
+ * server_group_read — reads served by the local server group, with fallback to the active
+ *
+ * Connects with options.network().preferred_server_group(PREFERRED_SERVER_GROUP), seeds
+ * NUM_DOCUMENTS small documents and reads random ones NUM_OPERATIONS times from
+ * NUM_THREADS threads: first with collection.get(), which always goes to the active
+ * copy, then with get_from_server_group() from server_group_read.hxx, which reads from
+ * a copy in the preferred group and falls back to the active copy when that fails.  It
+ * prints the latency percentiles of both and how the local reads were answered: by an
+ * active copy in the group, by a replica in the group, or by the fallback.
+ *
+ * On a single-node cluster the node is in "Group 1" and holds every active copy, so
+ * every local read is answered by it.  With a wrong group name every read falls back.
+ * The latency and cross-zone traffic saved show on a cluster with server groups in
+ * different availability zones, run from a client in one of them.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   PREFERRED_SERVER_GROUP  server group of this client (default: "Group 1")
+ *   NUM_DOCUMENTS           documents to read (default: 1000)
+ *   NUM_THREADS             reader threads (default: 4)
+ *   NUM_OPERATIONS          reads across all threads, per run (default: 10000)
+ *   LOCAL_TIMEOUT_MS        timeout of the local read before falling back; 0 uses the
+ *                           SDK's KV timeout (default: 0)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "kv_multi.hxx"
+#include "latency_histogram.hxx"
+#include "server_group_read.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string preferred_server_group{ "Group 1" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_documents{ 1000 };
+  std::size_t num_threads{ 4 };
+  std::size_t num_operations{ 10000 };
+  std::chrono::milliseconds local_timeout{ 0 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+make_document_id(std::size_t index) -> std::string
+{
+  return "server_group::" + std::to_string(index);
+}
+
+struct run_result {
+  latency_histogram latency{};
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+};
+
+// Runs `get(id)` num_operations times across num_threads threads; the callable returns
+// the couchbase::error of the read.
+template<typename Get>
+auto
+run_gets(const program_config& config, Get&& get) -> run_result
+{
+  run_result result{};
+  std::mutex result_mutex;
+  std::vector<std::thread> workers;
+  workers.reserve(config.num_threads);
+  for (std::size_t t = 0; t < config.num_threads; ++t) {
+    const auto operations = config.num_operations / config.num_threads +
+                            (t < config.num_operations % config.num_threads ? 1 : 0);
+    workers.emplace_back([&, t, operations] {
+      std::mt19937_64 engine{ t + 1 };
+      std::uniform_int_distribution<std::size_t> pick{ 0, config.num_documents - 1 };
+      latency_histogram latency{};
+      std::uint64_t errors{ 0 };
+      std::string last_error{};
+      for (std::size_t i = 0; i < operations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const couchbase::error err = get(make_document_id(pick(engine)));
+        latency.record(std::chrono::steady_clock::now() - start);
+        if (err.ec()) {
+          ++errors;
+          last_error = err.message();
+        }
+      }
+      const std::scoped_lock lock(result_mutex);
+      result.latency.merge(latency);
+      result.errors += errors;
+      if (!last_error.empty()) {
+        result.last_error = last_error;
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return result;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_result(const std::string& name, const run_result& result)
+{
+  const auto& h = result.latency;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::left << std::setw(8) << name << std::right << " latency us: p50 "
+            << to_micros(h.value_at_percentile(50)) << ", p95 "
+            << to_micros(h.value_at_percentile(95)) << ", p99 "
+            << to_micros(h.value_at_percentile(99)) << ", p99.9 "
+            << to_micros(h.value_at_percentile(99.9)) << ", max " << to_micros(h.max()) << " ("
+            << h.count() << " gets, " << result.errors << " errors)\n";
+  if (!result.last_error.empty()) {
+    std::cout << "  last error: " << result.last_error << "\n";
+  }
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+  // selected_server_group reads only consider copies on nodes of this group
+  options.network().preferred_server_group(config.preferred_server_group);
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  {
+    std::vector<std::pair<std::string, tao::json::value>> documents;
+    documents.reserve(config.num_documents);
+    for (std::size_t i = 0; i < config.num_documents; ++i) {
+      documents.emplace_back(make_document_id(i), tao::json::value{ { "index", i } });
+    }
+    std::size_t failed{ 0 };
+    for (const auto& [id, entry] : upsert_multi(collection, documents)) {
+      if (entry.error.ec()) {
+        ++failed;
+      }
+    }
+    std::cout << "Seeded " << config.num_documents - failed << " documents (" << failed
+              << " failed)\n";
+  }
+
+  print_result("get", run_gets(config, [&](std::string id) {
+                 auto [err, resp] = collection.get(std::move(id)).get();
+                 return err;
+               }));
+
+  server_group_read_options read_options{};
+  if (config.local_timeout.count() > 0) {
+    read_options.timeout = config.local_timeout;
+  }
+  std::atomic_uint64_t local_active{ 0 };
+  std::atomic_uint64_t local_replica{ 0 };
+  std::atomic_uint64_t fallback{ 0 };
+  print_result("local", run_gets(config, [&](std::string id) {
+                 auto [err, document] =
+                   get_from_server_group(collection, std::move(id), read_options).get();
+                 if (document.fallback) {
+                   ++fallback;
+                 } else if (!err.ec()) {
+                   ++(document.replica ? local_replica : local_active);
+                 }
+                 return err;
+               }));
+  std::cout << "  answered in " << program_config::quote(config.preferred_server_group) << " by "
+            << local_active << " active and " << local_replica << " replica copies, " << fallback
+            << " fell back to the active copy\n";
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("PREFERRED_SERVER_GROUP"); val != nullptr) {
+    config.preferred_server_group = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_DOCUMENTS"); val != nullptr) {
+    config.num_documents = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("LOCAL_TIMEOUT_MS"); val != nullptr) {
+    config.local_timeout = std::chrono::milliseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "       CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "               USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "                PASSWORD: [HIDDEN]\n";
+  std::cout << "  PREFERRED_SERVER_GROUP: " << quote(preferred_server_group) << "\n";
+  std::cout << "             BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "              SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "         COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "           NUM_DOCUMENTS: " << num_documents << "\n";
+  std::cout << "             NUM_THREADS: " << num_threads << "\n";
+  std::cout << "          NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "        LOCAL_TIMEOUT_MS: " << local_timeout.count() << "\n";
+  std::cout << "                 VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "                 PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
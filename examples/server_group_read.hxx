@@ -0,0 +1,111 @@
+/*
+ * server_group_read — non-transactional reads served by the local server group
+ *
+ * In a cluster spread over availability zones, every collection.get goes to the node
+ * holding the active copy of the document, which is in another zone most of the time.
+ * When the cluster is connected with
+ *
+ *   options.network().preferred_server_group("<zone of this client>")
+ *
+ * get_from_server_group() reads the document with get_any_replica() and
+ * read_preference::selected_server_group instead, which only asks the copies (active or
+ * replica) on nodes of that server group — the same locality that
+ * transactions_transfer_read_replica.cpp gets inside a transaction from
+ * get_replica_from_preferred_server_group().  The answer of a replica may be slightly
+ * behind the active copy, so this is for reads that can tolerate that.
+ *
+ * If the local read fails — no copy of the vBucket in the group, the local node is
+ * down, the document is not replicated yet, or the read exceeds `timeout` — the
+ * document is fetched from the active copy with collection.get(), unless
+ * `fallback_to_active` is off.  server_group_document says which path answered.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/default_json_transcoder.hxx>
+
+#include "passthrough_transcoder.hxx"
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+struct server_group_read_options {
+  std::optional<std::chrono::milliseconds> timeout{}; // of the local read only
+  bool fallback_to_active{ true };
+};
+
+struct server_group_document {
+  couchbase::cas cas{};
+  couchbase::codec::encoded_value value{};
+  bool replica{ false };  // served by a replica, which may be slightly stale
+  bool fallback{ false }; // the local read failed and the active copy answered
+
+  template<typename Document, typename Transcoder = couchbase::codec::default_json_transcoder>
+  [[nodiscard]] auto content_as() const -> Document
+  {
+    return Transcoder::template decode<Document>(value);
+  }
+};
+
+using server_group_read_handler = std::function<void(couchbase::error, server_group_document)>;
+
+// The handler runs on an SDK I/O thread.
+inline void
+get_from_server_group(const couchbase::collection& collection,
+                      std::string id,
+                      const server_group_read_options& options,
+                      server_group_read_handler&& handler)
+{
+  auto replica_options = couchbase::get_any_replica_options{}.read_preference(
+    couchbase::read_preference::selected_server_group);
+  if (options.timeout) {
+    replica_options.timeout(options.timeout.value());
+  }
+  collection.get_any_replica(
+    id,
+    replica_options,
+    [collection, id, fallback = options.fallback_to_active, handler = std::move(handler)](
+      auto err, auto resp) mutable {
+      if (!err.ec()) {
+        server_group_document document{};
+        document.cas = resp.cas();
+        document.value = resp.template content_as<passthrough_transcoder>();
+        document.replica = resp.is_replica();
+        return handler({}, std::move(document));
+      }
+      if (!fallback) {
+        return handler(std::move(err), {});
+      }
+      collection.get(
+        std::move(id), {}, [handler = std::move(handler)](auto get_err, auto get_resp) {
+          server_group_document document{};
+          document.fallback = true;
+          if (!get_err.ec()) {
+            document.cas = get_resp.cas();
+            document.value = get_resp.template content_as<passthrough_transcoder>();
+          }
+          handler(std::move(get_err), std::move(document));
+        });
+    });
+}
+
+inline auto
+get_from_server_group(const couchbase::collection& collection,
+                      std::string id,
+                      const server_group_read_options& options = {})
+  -> std::future<std::pair<couchbase::error, server_group_document>>
+{
+  auto barrier =
+    std::make_shared<std::promise<std::pair<couchbase::error, server_group_document>>>();
+  auto future = barrier->get_future();
+  get_from_server_group(collection, std::move(id), options, [barrier](auto err, auto document) {
+    barrier->set_value({ std::move(err), std::move(document) });
+  });
+  return future;
+}
@@ -0,0 +1,313 @@
+/*
+ * sharded_counter — hot inventory quantity as one counter document vs a sharded counter
+ *
+ * Every sale of a best-selling SKU decrements its stock level.  With a single counter
+ * document that is one hot key; sharded_counter.hxx spreads the same logical counter
+ * over SHARDS documents (item::<SKU>::ctr::<k>) on different vBuckets.
+ *
+ * NUM_THREADS threads perform NUM_OPERATIONS decrements in total, first against a single
+ * counter document (item::<SKU>::ctr) with collection.binary().decrement(), then against
+ * the sharded counter.  For each approach the program prints throughput and latency
+ * percentiles, and checks that the counter moved by exactly the number of successful
+ * decrements.  The sharded value is read with one multi-get over all shards.
+ *
+ * With GROW=true the sharded counter starts with a single shard and doubles its shard
+ * count (up to SHARDS) whenever at least 10% of the writes in a window of 1000 take
+ * longer than SLOW_WRITE_US.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   SKU              item whose stock is counted (default: "BESTSELLER")
+ *   NUM_THREADS      concurrent writers (default: 8)
+ *   NUM_OPERATIONS   decrements across all threads, per approach (default: 20000)
+ *   SHARDS           shards of the sharded counter, or the growth limit (default: 8)
+ *   GROW             start with one shard and grow on contention (default: false)
+ *   SLOW_WRITE_US    latency counted as contended when GROW is set (default: 1000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/logger.hxx>
+
+#include "latency_histogram.hxx"
+#include "sharded_counter.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::string sku{ "BESTSELLER" };
+  std::size_t num_threads{ 8 };
+  std::size_t num_operations{ 20000 };
+  std::size_t shards{ 8 };
+  bool grow{ false };
+  std::chrono::microseconds slow_write{ 1000 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct run_result {
+  latency_histogram latency{};
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+  std::chrono::nanoseconds elapsed{};
+};
+
+// Runs `decrement()` num_operations times across num_threads threads.  The callable
+// returns the couchbase::error of the decrement it performed.
+template<typename Decrement>
+auto
+run_decrements(const program_config& config, Decrement&& decrement) -> run_result
+{
+  run_result result{};
+  std::mutex result_mutex;
+  std::vector<std::thread> workers;
+  workers.reserve(config.num_threads);
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < config.num_threads; ++t) {
+    const auto operations = config.num_operations / config.num_threads +
+                            (t < config.num_operations % config.num_threads ? 1 : 0);
+    workers.emplace_back([&, operations] {
+      latency_histogram latency{};
+      std::uint64_t errors{ 0 };
+      std::string last_error{};
+      for (std::size_t i = 0; i < operations; ++i) {
+        const auto op_start = std::chrono::steady_clock::now();
+        const couchbase::error err = decrement();
+        latency.record(std::chrono::steady_clock::now() - op_start);
+        if (err.ec()) {
+          ++errors;
+          last_error = err.message();
+        }
+      }
+      const std::scoped_lock lock(result_mutex);
+      result.latency.merge(latency);
+      result.errors += errors;
+      if (!last_error.empty()) {
+        result.last_error = last_error;
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  result.elapsed = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+auto
+to_micros(std::chrono::nanoseconds value) -> double
+{
+  return std::chrono::duration<double, std::micro>(value).count();
+}
+
+void
+print_result(const std::string& name, const run_result& result)
+{
+  const auto& h = result.latency;
+  const auto seconds = std::chrono::duration<double>(result.elapsed).count();
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << name << ": " << h.count() << " decrements in " << seconds << "s ("
+            << (seconds > 0 ? static_cast<double>(h.count()) / seconds : 0.0)
+            << " ops/s), latency us mean " << to_micros(h.mean()) << ", p50 "
+            << to_micros(h.value_at_percentile(50)) << ", p99 "
+            << to_micros(h.value_at_percentile(99)) << ", max " << to_micros(h.max()) << ", "
+            << result.errors << " errors\n";
+  if (!result.last_error.empty()) {
+    std::cout << "  last error: " << result.last_error << "\n";
+  }
+}
+
+void
+print_check(std::int64_t before, std::int64_t after, const run_result& result)
+{
+  const auto expected = static_cast<std::int64_t>(result.latency.count() - result.errors);
+  std::cout << "  value " << before << " -> " << after << ", moved by " << before - after
+            << ", expected " << expected << (before - after == expected ? " (ok)" : " (MISMATCH)")
+            << "\n";
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+  const auto key = "item::" + config.sku;
+  constexpr std::uint64_t initial_stock{ 1'000'000'000 };
+
+  {
+    // A single counter document: every decrement goes to the same vBucket.
+    const auto id = key + "::ctr";
+    const auto read = [&]() -> std::int64_t {
+      const auto read_options = couchbase::increment_options{}.delta(0).initial(initial_stock);
+      auto [err, resp] = collection.binary().increment(id, read_options).get();
+      return err.ec() ? -1 : static_cast<std::int64_t>(resp.content());
+    };
+    const auto before = read();
+    const auto decrement_options = couchbase::decrement_options{}.delta(1);
+    const auto result = run_decrements(config, [&] {
+      auto [err, resp] = collection.binary().decrement(id, decrement_options).get();
+      return err;
+    });
+    print_result("single document", result);
+    print_check(before, read(), result);
+  }
+
+  {
+    sharded_counter_options counter_options{};
+    counter_options.initial_shards = config.grow ? 1 : config.shards;
+    if (config.grow) {
+      sharded_counter_growth growth{};
+      growth.max_shards = config.shards;
+      growth.slow_write = config.slow_write;
+      counter_options.growth = growth;
+    }
+    auto [open_err, counter] = sharded_counter::open(collection, key, counter_options);
+    if (open_err.ec()) {
+      std::cout << "Unable to open sharded counter " << program_config::quote(key) << ": "
+                << open_err.message() << "\n";
+    } else {
+      if (auto [err, value] = counter.value(); !err.ec() && value == 0) {
+        counter.add(static_cast<std::int64_t>(initial_stock)).get();
+      }
+      const auto before = counter.value().second;
+      const auto result = run_decrements(config, [&] {
+        return counter.add(-1).get();
+      });
+      print_result("sharded counter (" + std::to_string(counter.shard_count()) + " shards)",
+                   result);
+      print_check(before, counter.value().second, result);
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("SKU"); val != nullptr) {
+    config.sku = val;
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_OPERATIONS"); val != nullptr) {
+    config.num_operations = std::stoul(val);
+  }
+  if (const auto* val = getenv("SHARDS"); val != nullptr) {
+    config.shards = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("SLOW_WRITE_US"); val != nullptr) {
+    config.slow_write = std::chrono::microseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  if (const auto* val = getenv("GROW"); val != nullptr) {
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.grow = true;
+        break;
+      }
+    }
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "                SKU: " << quote(sku) << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "     NUM_OPERATIONS: " << num_operations << "\n";
+  std::cout << "             SHARDS: " << shards << "\n";
+  std::cout << "               GROW: " << std::boolalpha << grow << "\n";
+  std::cout << "      SLOW_WRITE_US: " << slow_write.count() << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
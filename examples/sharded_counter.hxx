@@ -0,0 +1,342 @@
+/*
+ * sharded_counter — a logical counter spread over several counter documents
+ *
+ * When every sale of a best-selling SKU decrements the same document, that document is
+ * a hot key: all writes land on one vBucket, hence one node, and queue behind each other.
+ * sharded_counter splits the logical value of `key` over S counter documents
+ *
+ *   <key>::ctr::0 ... <key>::ctr::<S-1>
+ *
+ * which hash to different vBuckets.  add() picks a shard at random and applies the delta
+ * with an atomic binary increment or decrement; value() fetches all shards with one
+ * concurrent get_multi() (kv_multi.hxx) and sums them.  The sum is not a snapshot: adds
+ * that complete while value() runs may or may not be included.
+ *
+ * Binary counters are unsigned and clamp at zero, so a shard that received more
+ * decrements than increments would silently lose updates.  Every shard is therefore
+ * created at `bias` (2^62) and contributes (stored value - bias) to the sum; shards that
+ * do not exist yet contribute nothing.  A single add() therefore takes a delta in
+ * [-bias, bias]; anything outside, INT64_MIN included, fails with invalid_argument
+ * before a shard is touched.
+ *
+ * The shard count lives in <key>::ctr::meta (a positive JSON number; open() fails with
+ * decoding_failure on anything else) and is read together with the shards, so value()
+ * still costs a single multi-get.  When `growth` is set, add() watches its own latency:
+ * once the share of writes slower than `slow_write` (or failed) within a window of
+ * `window` writes reaches `trigger_ratio`, the shard count is doubled, up to
+ * `max_shards`, with a CAS-guarded replace of the meta document.  Other clients pick the
+ * new count up the next time they read the counter.  Shards are never removed, so growing
+ * never changes the value.
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/raw_json_transcoder.hxx>
+
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Decodes the decimal text stored by binary counters (and by the meta document).
+struct counter_text_transcoder {
+  using document_type = std::uint64_t;
+
+  static auto decode(const couchbase::codec::encoded_value& encoded) -> document_type
+  {
+    std::uint64_t value{ 0 };
+    for (const auto byte : encoded.data) {
+      const auto digit = static_cast<char>(byte);
+      if (digit < '0' || digit > '9') {
+        break;
+      }
+      value = value * 10 + static_cast<std::uint64_t>(digit - '0');
+    }
+    return value;
+  }
+};
+
+template<>
+struct couchbase::codec::is_transcoder<counter_text_transcoder> : public std::true_type {
+};
+
+struct sharded_counter_growth {
+  std::size_t max_shards{ 64 };
+  std::chrono::microseconds slow_write{ std::chrono::milliseconds{ 2 } };
+  std::size_t window{ 1000 };
+  double trigger_ratio{ 0.1 };
+};
+
+struct sharded_counter_options {
+  std::size_t initial_shards{ 8 }; // used when the counter does not exist yet
+  std::optional<sharded_counter_growth> growth{};
+  std::size_t read_window{ 128 }; // maximum gets in flight in value()
+};
+
+class sharded_counter
+{
+public:
+  static constexpr std::uint64_t bias{ std::uint64_t{ 1 } << 62 };
+
+  // A delta beyond the bias would wrap the initial value of a new shard.
+  [[nodiscard]] static constexpr auto valid_delta(std::int64_t delta) -> bool
+  {
+    return delta >= -static_cast<std::int64_t>(bias) && delta <= static_cast<std::int64_t>(bias);
+  }
+
+  sharded_counter() = default;
+
+  // Reads the shard count of `key`, creating the counter with `initial_shards` shards if
+  // it does not exist.
+  static auto open(couchbase::collection collection,
+                   std::string key,
+                   sharded_counter_options options = {})
+    -> std::pair<couchbase::error, sharded_counter>
+  {
+    auto self = std::make_shared<state>(std::move(collection), std::move(key), options);
+    const auto initial = std::max<std::size_t>(options.initial_shards, 1);
+    auto [insert_err, inserted] =
+      self->collection
+        .insert<couchbase::codec::raw_json_transcoder>(self->meta_id(), std::to_string(initial))
+        .get();
+    if (!insert_err.ec()) {
+      self->shards = initial;
+      self->meta_cas = inserted.cas();
+      return { {}, sharded_counter{ std::move(self) } };
+    }
+    if (insert_err.ec() != couchbase::errc::key_value::document_exists) {
+      return { insert_err, {} };
+    }
+    auto [get_err, existing] = self->collection.get(self->meta_id()).get();
+    if (get_err.ec()) {
+      return { get_err, {} };
+    }
+    const auto text = existing.content_as<couchbase::codec::raw_json_transcoder>();
+    self->shards = static_cast<std::size_t>(existing.content_as<counter_text_transcoder>());
+    if (text.find_first_not_of("0123456789") != std::string::npos || self->shards == 0) {
+      return { couchbase::error{ couchbase::errc::common::decoding_failure,
+                                 "sharded_counter: " + self->meta_id() +
+                                   " does not hold a positive shard count" },
+               {} };
+    }
+    self->meta_cas = existing.cas();
+    return { {}, sharded_counter{ std::move(self) } };
+  }
+
+  // Adds `delta` (which may be negative) to one randomly chosen shard.  The handler runs
+  // on an SDK I/O thread.
+  void add(std::int64_t delta, std::function<void(couchbase::error)>&& handler) const
+  {
+    if (delta == 0) {
+      return handler({});
+    }
+    if (!valid_delta(delta)) {
+      return handler(couchbase::error{ couchbase::errc::common::invalid_argument,
+                                       "sharded_counter::add: delta out of range" });
+    }
+    const auto id = state_->shard_id(state_->pick_shard());
+    const auto start = std::chrono::steady_clock::now();
+    auto completion = [self = state_, start, handler = std::move(handler)](
+                        auto err, auto /* resp */) mutable {
+      self->record_write(std::chrono::steady_clock::now() - start, err);
+      handler(std::move(err));
+    };
+    if (delta > 0) {
+      const auto magnitude = static_cast<std::uint64_t>(delta);
+      state_->collection.binary().increment(
+        id,
+        couchbase::increment_options{}.delta(magnitude).initial(bias + magnitude),
+        std::move(completion));
+    } else {
+      const auto magnitude = static_cast<std::uint64_t>(-delta);
+      state_->collection.binary().decrement(
+        id,
+        couchbase::decrement_options{}.delta(magnitude).initial(bias - magnitude),
+        std::move(completion));
+    }
+  }
+
+  auto add(std::int64_t delta) const -> std::future<couchbase::error>
+  {
+    auto barrier = std::make_shared<std::promise<couchbase::error>>();
+    auto future = barrier->get_future();
+    add(delta, [barrier](auto err) {
+      barrier->set_value(std::move(err));
+    });
+    return future;
+  }
+
+  // Sums all shards.  Blocks the calling thread, so it must not be called from an SDK
+  // completion handler.
+  [[nodiscard]] auto value() const -> std::pair<couchbase::error, std::int64_t>
+  {
+    const auto meta_id = state_->meta_id();
+    std::vector<std::string> ids{ meta_id };
+    const auto known = state_->shards.load();
+    for (std::size_t k = 0; k < known; ++k) {
+      ids.emplace_back(state_->shard_id(k));
+    }
+    auto results = get_multi(state_->collection, ids, {}, state_->options.read_window);
+
+    // Another client may have grown the counter since we last looked.
+    if (const auto& meta = results[meta_id]; meta.result) {
+      const auto stored =
+        static_cast<std::size_t>(meta.result->content_as<counter_text_transcoder>());
+      if (stored > known) {
+        state_->adopt(stored, meta.result->cas());
+        std::vector<std::string> extra;
+        for (auto k = known; k < stored; ++k) {
+          extra.emplace_back(state_->shard_id(k));
+        }
+        results.merge(get_multi(state_->collection, extra, {}, state_->options.read_window));
+      }
+    }
+    results.erase(meta_id);
+
+    std::uint64_t sum{ 0 };
+    for (const auto& [id, entry] : results) {
+      if (entry.error.ec() == couchbase::errc::key_value::document_not_found) {
+        continue;
+      }
+      if (entry.error.ec()) {
+        return { entry.error, 0 };
+      }
+      // Unsigned wrap-around makes this correct for negative shard values as well.
+      sum += entry.result->content_as<counter_text_transcoder>() - bias;
+    }
+    return { {}, static_cast<std::int64_t>(sum) };
+  }
+
+  [[nodiscard]] auto shard_count() const -> std::size_t
+  {
+    return state_->shards;
+  }
+
+private:
+  struct state : std::enable_shared_from_this<state> {
+    state(couchbase::collection c, std::string k, const sharded_counter_options& o)
+      : collection{ std::move(c) }
+      , key{ std::move(k) }
+      , options{ o }
+    {
+    }
+
+    auto shard_id(std::size_t shard) const -> std::string
+    {
+      return key + "::ctr::" + std::to_string(shard);
+    }
+
+    auto meta_id() const -> std::string
+    {
+      return key + "::ctr::meta";
+    }
+
+    auto pick_shard() const -> std::size_t
+    {
+      thread_local std::minstd_rand engine{ static_cast<std::minstd_rand::result_type>(
+        std::hash<std::thread::id>{}(std::this_thread::get_id())) };
+      return std::uniform_int_distribution<std::size_t>{ 0, shards - 1 }(engine);
+    }
+
+    void adopt(std::size_t count, couchbase::cas cas)
+    {
+      const std::scoped_lock lock(meta_mutex);
+      if (count > shards) {
+        shards = count;
+        meta_cas = cas;
+      }
+    }
+
+    void record_write(std::chrono::nanoseconds latency, const couchbase::error& err)
+    {
+      if (!options.growth) {
+        return;
+      }
+      const auto& growth = *options.growth;
+      if (err.ec() || latency >= growth.slow_write) {
+        ++contended_writes;
+      }
+      if (++window_writes < growth.window) {
+        return;
+      }
+      std::size_t target{ 0 };
+      couchbase::cas expected{};
+      {
+        const std::scoped_lock lock(meta_mutex);
+        if (window_writes < growth.window) {
+          return; // another thread closed this window
+        }
+        const auto ratio =
+          static_cast<double>(contended_writes) / static_cast<double>(window_writes);
+        window_writes = 0;
+        contended_writes = 0;
+        if (ratio < growth.trigger_ratio || shards >= growth.max_shards || growing) {
+          return;
+        }
+        growing = true;
+        target = std::min<std::size_t>(shards * 2, growth.max_shards);
+        expected = meta_cas;
+      }
+      grow(target, expected);
+    }
+
+    // Runs on an SDK I/O thread, so it only issues callback operations.
+    void grow(std::size_t target, couchbase::cas expected)
+    {
+      collection.replace<couchbase::codec::raw_json_transcoder>(
+        meta_id(),
+        std::to_string(target),
+        couchbase::replace_options{}.cas(expected),
+        [self = shared_from_this(), target](auto err, auto resp) {
+          if (!err.ec()) {
+            const std::scoped_lock lock(self->meta_mutex);
+            self->shards = target;
+            self->meta_cas = resp.cas();
+            self->growing = false;
+            return;
+          }
+          // Someone else changed the count first: take theirs and re-evaluate later.
+          self->collection.get(
+            self->meta_id(), {}, [self](auto get_err, auto current) {
+              if (!get_err.ec()) {
+                const auto stored = current.template content_as<counter_text_transcoder>();
+                self->adopt(static_cast<std::size_t>(stored), current.cas());
+              }
+              const std::scoped_lock lock(self->meta_mutex);
+              self->growing = false;
+            });
+        });
+    }
+
+    const couchbase::collection collection;
+    const std::string key;
+    const sharded_counter_options options;
+
+    std::atomic_size_t shards{ 1 };
+    std::atomic_size_t window_writes{ 0 };
+    std::atomic_size_t contended_writes{ 0 };
+    std::mutex meta_mutex{};
+    couchbase::cas meta_cas{};
+    bool growing{ false };
+  };
+
+  explicit sharded_counter(std::shared_ptr<state> state)
+    : state_{ std::move(state) }
+  {
+  }
+
+  std::shared_ptr<state> state_{};
+};
@@ -0,0 +1,193 @@
+/*
+ * transaction_executor — bounded number of asynchronous transactions in flight
+ *
+ * transactions::run() with a synchronous attempt_context blocks its thread for the
+ * whole transaction, retries included, so running T transactions at once takes T
+ * threads.  The asynchronous overload (async_attempt_context, as in the async branch of
+ * ledger_with_csv_encoding.cpp) returns at once and reports through a completion
+ * handler on an SDK I/O thread, so any number of transactions can be in flight from a
+ * single thread; what is missing is a limit.  Every transaction holds staged documents
+ * and server-side state until it completes, and past a point more concurrency only
+ * buys more conflicts and timeouts.
+ *
+ * transaction_executor runs at most `max_in_flight` transactions at once.  submit()
+ * starts the transaction right away when there is room, and queues it otherwise; each
+ * completion starts the oldest queued transaction from the completion handler, so the
+ * executor owns no threads.  The handler passed to submit() runs on an SDK I/O thread
+ * once the transaction has committed or failed, before the next queued transaction is
+ * started; the future overload fulfils its future there instead.
+ *
+ * submit() does not block and may be called from any thread, completion handlers
+ * included, unless `max_queued` is set: it then waits while that many transactions
+ * are queued, which gives producers backpressure but must not happen on an SDK
+ * thread.  drain() blocks until everything submitted has completed; the destructor
+ * drains.  Neither may be called from a completion handler.
+ */
+
+#pragma once
+
+#include <couchbase/transactions.hxx>
+#include <couchbase/transactions/async_attempt_context.hxx>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+struct transaction_executor_options {
+  std::size_t max_in_flight{ 64 };
+  std::size_t max_queued{ 0 }; // 0: submit() never blocks
+  couchbase::transactions::transaction_options transaction_options{};
+};
+
+struct transaction_executor_stats {
+  std::uint64_t submitted{ 0 };
+  std::uint64_t committed{ 0 };
+  std::uint64_t failed{ 0 };
+  std::size_t peak_in_flight{ 0 };
+  std::size_t peak_queued{ 0 };
+};
+
+using transaction_handler =
+  std::function<void(couchbase::error, couchbase::transactions::transaction_result)>;
+
+class transaction_executor
+{
+public:
+  explicit transaction_executor(std::shared_ptr<couchbase::transactions::transactions> transactions,
+                                transaction_executor_options options = {})
+    : transactions_{ std::move(transactions) }
+    , options_{ std::move(options) }
+  {
+    options_.max_in_flight = std::max<std::size_t>(options_.max_in_flight, 1);
+  }
+
+  transaction_executor(const transaction_executor&) = delete;
+  auto operator=(const transaction_executor&) -> transaction_executor& = delete;
+
+  ~transaction_executor()
+  {
+    drain();
+  }
+
+  void submit(couchbase::transactions::async_txn_logic logic, transaction_handler handler)
+  {
+    task next{ std::move(logic), std::move(handler) };
+    {
+      std::unique_lock lock(mutex_);
+      if (options_.max_queued > 0) {
+        cv_.wait(lock, [this] {
+          return in_flight_ < options_.max_in_flight || queue_.size() < options_.max_queued;
+        });
+      }
+      ++stats_.submitted;
+      if (in_flight_ == options_.max_in_flight) {
+        queue_.push_back(std::move(next));
+        stats_.peak_queued = std::max(stats_.peak_queued, queue_.size());
+        return;
+      }
+      ++in_flight_;
+      stats_.peak_in_flight = std::max(stats_.peak_in_flight, in_flight_);
+    }
+    start(std::move(next));
+  }
+
+  auto submit(couchbase::transactions::async_txn_logic logic)
+    -> std::future<std::pair<couchbase::error, couchbase::transactions::transaction_result>>
+  {
+    auto barrier = std::make_shared<
+      std::promise<std::pair<couchbase::error, couchbase::transactions::transaction_result>>>();
+    auto future = barrier->get_future();
+    submit(std::move(logic), [barrier](auto err, auto result) {
+      barrier->set_value({ std::move(err), std::move(result) });
+    });
+    return future;
+  }
+
+  void drain()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return in_flight_ == 0 && queue_.empty();
+    });
+  }
+
+  [[nodiscard]] auto in_flight() const -> std::size_t
+  {
+    const std::scoped_lock lock(mutex_);
+    return in_flight_;
+  }
+
+  [[nodiscard]] auto queued() const -> std::size_t
+  {
+    const std::scoped_lock lock(mutex_);
+    return queue_.size();
+  }
+
+  [[nodiscard]] auto stats() const -> transaction_executor_stats
+  {
+    const std::scoped_lock lock(mutex_);
+    return stats_;
+  }
+
+private:
+  struct task {
+    couchbase::transactions::async_txn_logic logic;
+    transaction_handler handler;
+  };
+
+  void start(task next)
+  {
+    transactions_->run(
+      std::move(next.logic),
+      [this, handler = std::move(next.handler)](auto err, auto result) {
+        const bool failed = static_cast<bool>(err.ec());
+        if (handler) {
+          handler(std::move(err), std::move(result));
+        }
+        complete(failed);
+      },
+      options_.transaction_options);
+  }
+
+  // The finished transaction's slot goes to the oldest queued one, if any.
+  void complete(bool failed)
+  {
+    std::optional<task> next{};
+    {
+      // Notify while holding the mutex: drain() may return, and the executor be
+      // destroyed, as soon as the last slot is released.
+      const std::scoped_lock lock(mutex_);
+      if (failed) {
+        ++stats_.failed;
+      } else {
+        ++stats_.committed;
+      }
+      if (queue_.empty()) {
+        --in_flight_;
+      } else {
+        next.emplace(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      cv_.notify_all();
+    }
+    if (next) {
+      start(std::move(*next));
+    }
+  }
+
+  std::shared_ptr<couchbase::transactions::transactions> transactions_;
+  transaction_executor_options options_;
+  mutable std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::deque<task> queue_{};
+  std::size_t in_flight_{ 0 };
+  transaction_executor_stats stats_{};
+};
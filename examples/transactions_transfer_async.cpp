@@ -0,0 +1,407 @@
+/*
+ * transactions_transfer_async — many transfer transactions from one thread
+ *
+ * transactions_transfer_basic.cpp runs one blocking transactions::run() at a time, and
+ * transfer_contention_bench.cpp needs one thread per transaction in flight.  This
+ * program creates NUM_ACCOUNTS bank_account documents and submits NUM_TRANSFERS
+ * transfers between random pairs of them from the main thread alone, through
+ * submit_transfer() (bank_transfer.hxx) and a transaction_executor
+ * (transaction_executor.hxx) that bounds the transactions in flight.  Completion
+ * handlers count the outcomes on the SDK's I/O threads; nothing waits for a single
+ * transaction.
+ *
+ * It first moves one unit between the first two accounts through the future overload
+ * of submit_transfer(), then repeats the whole batch for every limit in MAX_IN_FLIGHT
+ * and prints
+ *
+ *   commits/s        transfers committed per second
+ *   attempts/commit  attempts per committed transfer, failed transfers included
+ *   failed           transfers that did not commit, with their causes below the table
+ *   peak             most transactions the executor had in flight at once
+ *   threads          threads of this process while the batch was in flight, from
+ *                    /proc/self/status: it does not grow with the limit
+ *
+ * With uniformly chosen accounts conflicts are rare until the limit approaches the
+ * number of accounts.  At the end the balances are summed, which must give
+ * NUM_ACCOUNTS * INITIAL_BALANCE whatever failed, and the accounts are removed unless
+ * KEEP_ACCOUNTS is set.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_ACCOUNTS     number of accounts, at least 2 (default: 1000)
+ *   NUM_TRANSFERS    transfers submitted per limit (default: 2000)
+ *   MAX_IN_FLIGHT    comma-separated limits on transactions in flight (default: 1,16,128)
+ *   INITIAL_BALANCE  balance of every account (default: 1000000)
+ *   MAX_AMOUNT       largest amount of a single transfer (default: 100)
+ *   KEY_PREFIX       account document ID prefix (default: "transfer_async::")
+ *   KEEP_ACCOUNTS    do not remove the accounts at the end (default: false)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/logger.hxx>
+
+#include "bank_transfer.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::uint64_t num_accounts{ 1000 };
+  std::uint64_t num_transfers{ 2000 };
+  std::vector<std::size_t> in_flight_limits{ 1, 16, 128 };
+  std::int64_t initial_balance{ 1'000'000 };
+  std::int64_t max_amount{ 100 };
+  std::string key_prefix{ "transfer_async::" };
+  bool keep_accounts{ false };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+// Filled in by the completion handlers, on the SDK's I/O threads.
+struct batch_outcome {
+  std::mutex mutex{};
+  std::uint64_t commits{ 0 };
+  std::uint64_t failures{ 0 };
+  std::uint64_t attempts{ 0 };
+  std::map<std::string, std::uint64_t> failure_causes{};
+
+  void record(const transfer_outcome& outcome)
+  {
+    const std::scoped_lock lock(mutex);
+    attempts += outcome.attempts;
+    if (!outcome.error.ec()) {
+      ++commits;
+      return;
+    }
+    ++failures;
+    std::string cause = outcome.error.ec().message();
+    if (auto inner = outcome.error.cause(); inner.has_value()) {
+      cause += " (cause: " + inner->ec().message() + ")";
+    }
+    ++failure_causes[cause];
+  }
+};
+
+auto
+split(const std::string& list) -> std::vector<std::string>
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.emplace_back(item);
+    }
+  }
+  return items;
+}
+
+auto
+make_account_id(const program_config& config, std::uint64_t index) -> std::string
+{
+  return config.key_prefix + std::to_string(index);
+}
+
+// Number of threads of this process, if /proc/self/status has it.
+auto
+read_thread_count() -> std::optional<std::uint64_t>
+{
+  std::ifstream status{ "/proc/self/status" };
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("Threads:", 0) == 0) {
+      return std::stoull(line.substr(line.find(':') + 1));
+    }
+  }
+  return {};
+}
+
+// Upserts all accounts with the initial balance, all of them at once.  Returns the number
+// of failures.
+auto
+load_accounts(const couchbase::collection& collection, const program_config& config)
+  -> std::uint64_t
+{
+  std::vector<std::future<std::pair<couchbase::error, couchbase::mutation_result>>> pending;
+  pending.reserve(config.num_accounts);
+  for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+    const bank_account account{ "account " + std::to_string(index), config.initial_balance };
+    pending.emplace_back(collection.upsert(make_account_id(config, index), account, {}));
+  }
+  std::uint64_t errors{ 0 };
+  for (auto& future : pending) {
+    if (auto [err, resp] = future.get(); err.ec()) {
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+void
+run_batch(const std::shared_ptr<couchbase::transactions::transactions>& transactions,
+          const couchbase::collection& collection,
+          const program_config& config,
+          std::size_t max_in_flight,
+          std::mt19937_64& engine)
+{
+  std::uniform_int_distribution<std::uint64_t> accounts{ 0, config.num_accounts - 1 };
+  std::uniform_int_distribution<std::int64_t> amounts{ 1, config.max_amount };
+
+  batch_outcome outcome{};
+  std::optional<std::uint64_t> threads{};
+  transaction_executor_stats stats{};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    transaction_executor executor{ transactions, { max_in_flight } };
+    for (std::uint64_t i = 0; i < config.num_transfers; ++i) {
+      const auto from = accounts(engine);
+      auto to = accounts(engine);
+      while (to == from) {
+        to = accounts(engine);
+      }
+      submit_transfer(executor,
+                      collection,
+                      make_account_id(config, from),
+                      make_account_id(config, to),
+                      amounts(engine),
+                      [&outcome](auto result) {
+                        outcome.record(result);
+                      });
+    }
+    threads = read_thread_count();
+    executor.drain();
+    stats = executor.stats();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto attempts_per_commit =
+    outcome.commits == 0
+      ? 0.0
+      : static_cast<double>(outcome.attempts) / static_cast<double>(outcome.commits);
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << std::setw(10) << max_in_flight << std::setw(10) << outcome.commits
+            << std::setw(12) << static_cast<double>(outcome.commits) / elapsed.count()
+            << std::setw(12) << attempts_per_commit << std::setw(8) << outcome.failures
+            << std::setw(8) << stats.peak_in_flight << std::setw(9)
+            << (threads ? std::to_string(*threads) : "n/a") << "\n";
+  for (const auto& [message, count] : outcome.failure_causes) {
+    std::cout << "    " << std::setw(8) << count << "  " << message << "\n";
+  }
+}
+
+// Sums the balances of all accounts.  Returns the number of accounts that could not be read.
+auto
+sum_balances(const couchbase::collection& collection,
+             const program_config& config,
+             std::int64_t& total) -> std::uint64_t
+{
+  std::uint64_t errors{ 0 };
+  total = 0;
+  for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+    auto [err, resp] = collection.get(make_account_id(config, index), {}).get();
+    if (err.ec()) {
+      ++errors;
+      continue;
+    }
+    total += resp.content_as<bank_account>().balance;
+  }
+  return errors;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+  const auto transactions = cluster.transactions();
+
+  const auto load_errors = load_accounts(collection, config);
+  std::cout << "Created " << config.num_accounts << " accounts (" << load_errors
+            << " errors)\n\n";
+
+  {
+    transaction_executor executor{ transactions };
+    const auto outcome =
+      submit_transfer(
+        executor, collection, make_account_id(config, 0), make_account_id(config, 1), 1)
+        .get();
+    std::cout << "Single transfer: "
+              << (outcome.error.ec() ? outcome.error.ec().message() : "committed") << " after "
+              << outcome.attempts << " attempt(s)\n\n";
+  }
+
+  std::mt19937_64 engine{ std::random_device{}() };
+  std::cout << std::setw(10) << "in flight" << std::setw(10) << "commits" << std::setw(12)
+            << "commits/s" << std::setw(12) << "att/commit" << std::setw(8) << "failed"
+            << std::setw(8) << "peak" << std::setw(9) << "threads"
+            << "\n";
+  for (const auto max_in_flight : config.in_flight_limits) {
+    run_batch(transactions, collection, config, max_in_flight, engine);
+  }
+
+  std::int64_t total_balance{ 0 };
+  const auto read_errors = sum_balances(collection, config, total_balance);
+  const auto expected_balance =
+    static_cast<std::int64_t>(config.num_accounts) * config.initial_balance;
+  std::cout << "\nSum of balances: " << total_balance << " (expected " << expected_balance;
+  if (read_errors > 0) {
+    std::cout << ", " << read_errors << " accounts could not be read";
+  } else if (total_balance != expected_balance) {
+    std::cout << ", MISMATCH";
+  }
+  std::cout << ")\n";
+
+  if (!config.keep_accounts) {
+    for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+      collection.remove(make_account_id(config, index), {}).get();
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+parse_truthy(const char* val) -> bool
+{
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  for (const auto& truth : truthy_values) {
+    if (val == truth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_ACCOUNTS"); val != nullptr) {
+    config.num_accounts = std::max<std::uint64_t>(std::stoull(val), 2);
+  }
+  if (const auto* val = getenv("NUM_TRANSFERS"); val != nullptr) {
+    config.num_transfers = std::stoull(val);
+  }
+  if (const auto* val = getenv("MAX_IN_FLIGHT"); val != nullptr) {
+    config.in_flight_limits.clear();
+    for (const auto& limit : split(val)) {
+      config.in_flight_limits.emplace_back(std::max<std::size_t>(std::stoul(limit), 1));
+    }
+  }
+  if (const auto* val = getenv("INITIAL_BALANCE"); val != nullptr) {
+    config.initial_balance = std::stoll(val);
+  }
+  if (const auto* val = getenv("MAX_AMOUNT"); val != nullptr) {
+    config.max_amount = std::max<std::int64_t>(std::stoll(val), 1);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("KEEP_ACCOUNTS"); val != nullptr) {
+    config.keep_accounts = parse_truthy(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    config.verbose = parse_truthy(val);
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string limits;
+  for (const auto limit : in_flight_limits) {
+    limits += (limits.empty() ? "" : ",") + std::to_string(limit);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "       NUM_ACCOUNTS: " << num_accounts << "\n";
+  std::cout << "      NUM_TRANSFERS: " << num_transfers << "\n";
+  std::cout << "      MAX_IN_FLIGHT: " << limits << "\n";
+  std::cout << "    INITIAL_BALANCE: " << initial_balance << "\n";
+  std::cout << "         MAX_AMOUNT: " << max_amount << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "      KEEP_ACCOUNTS: " << std::boolalpha << keep_accounts << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,542 @@
+/*
+ * transfer_contention_bench — transfer transactions between many accounts under contention
+ *
+ * transactions_transfer_basic.cpp moves money from alice to bob once.  This benchmark
+ * creates NUM_ACCOUNTS bank_account documents (bank_transfer.hxx) and runs transfer
+ * transactions against them from many threads at once, to see how the transfer path
+ * behaves as the threads start fighting over the same accounts.
+ *
+ * Every worker runs a closed loop: it picks two distinct accounts from the configured
+ * distribution, moves a random amount of at most MAX_AMOUNT from the first to the
+ * second in a transaction (get both, replace both, as transactions_transfer_basic.cpp
+ * does), and records the latency of the whole transaction.  With the zipfian
+ * distribution a few accounts take part in most transfers, so concurrent transactions
+ * collide on them: an attempt that finds a document staged by another transaction, or
+ * loses the race to commit, is rolled back and run again by the SDK.  The benchmark
+ * counts the attempts by counting how often the transaction lambda is entered.
+ *
+ * The run is repeated for every thread count in NUM_THREADS against the same accounts,
+ * and each step prints
+ *
+ *   commits/s        transfers committed per second
+ *   attempts/commit  lambda invocations per committed transfer, failed transfers
+ *                    included: 1.0 means no work was thrown away
+ *   failed           transfers that did not commit, with their causes below the table
+ *   p50 ... max      latency of the committed transfers, retries included
+ *
+ * followed by the errors seen by individual attempts (which include the conflicts
+ * that made the SDK retry) and the final errors of failed transfers.  A transfer that
+ * would overdraw its source account rolls back with insufficient_funds; with the
+ * default balances that does not happen.  At the end the balances are summed, which
+ * must give NUM_ACCOUNTS * INITIAL_BALANCE whatever failed, and the accounts are
+ * removed unless KEEP_ACCOUNTS is set.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_ACCOUNTS         number of accounts, at least 2 (default: 100)
+ *   NUM_THREADS          comma-separated worker thread counts (default: 1,4,16)
+ *   DURATION_SECONDS     length of each step (default: 3)
+ *   KEY_DISTRIBUTION     uniform, zipfian or hotspot (default: zipfian)
+ *   ZIPF_THETA           skew of the zipfian distribution, < 1 (default: 0.99)
+ *   INITIAL_BALANCE      balance of every account (default: 1000000)
+ *   MAX_AMOUNT           largest amount of a single transfer (default: 100)
+ *   KEY_PREFIX           account document ID prefix (default: "transfer::")
+ *   KEEP_ACCOUNTS        do not remove the accounts at the end (default: false)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/logger.hxx>
+#include <couchbase/transactions/attempt_context.hxx>
+
+#include "bank_transfer.hxx"
+#include "key_distribution.hxx"
+#include "latency_histogram.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::uint64_t num_accounts{ 100 };
+  std::vector<std::size_t> thread_counts{ 1, 4, 16 };
+  std::chrono::seconds duration{ 3 };
+  key_distribution_type distribution{ key_distribution_type::zipfian };
+  double zipf_theta{ 0.99 };
+  std::int64_t initial_balance{ 1'000'000 };
+  std::int64_t max_amount{ 100 };
+  std::string key_prefix{ "transfer::" };
+  bool keep_accounts{ false };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct transfer_stats {
+  latency_histogram latency{}; // committed transfers
+  std::uint64_t commits{ 0 };
+  std::uint64_t failures{ 0 };
+  std::uint64_t attempts{ 0 }; // of all transfers, committed or not
+  std::map<std::string, std::uint64_t> attempt_errors{};
+  std::map<std::string, std::uint64_t> failure_causes{};
+
+  void merge(const transfer_stats& other)
+  {
+    latency.merge(other.latency);
+    commits += other.commits;
+    failures += other.failures;
+    attempts += other.attempts;
+    for (const auto& [message, count] : other.attempt_errors) {
+      attempt_errors[message] += count;
+    }
+    for (const auto& [message, count] : other.failure_causes) {
+      failure_causes[message] += count;
+    }
+  }
+};
+
+using start_signal_type = std::shared_future<std::chrono::steady_clock::time_point>;
+
+auto
+split(const std::string& list) -> std::vector<std::string>
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.emplace_back(item);
+    }
+  }
+  return items;
+}
+
+auto
+make_account_id(const program_config& config, std::uint64_t index) -> std::string
+{
+  return config.key_prefix + std::to_string(index);
+}
+
+// Upserts accounts [first, last) with the initial balance.  Returns the number of failures.
+auto
+load_accounts(const couchbase::collection& collection,
+              const program_config& config,
+              std::uint64_t first,
+              std::uint64_t last) -> std::uint64_t
+{
+  std::uint64_t errors{ 0 };
+  for (auto index = first; index < last; ++index) {
+    const bank_account account{ "account " + std::to_string(index), config.initial_balance };
+    if (auto [err, resp] = collection.upsert(make_account_id(config, index), account, {}).get();
+        err.ec()) {
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+// Moves `amount` from one account to the other in a transaction, counting its attempts
+// and the errors they run into in `stats`.
+auto
+transfer(couchbase::transactions::transactions& transactions,
+         const couchbase::collection& collection,
+         const std::string& from_id,
+         const std::string& to_id,
+         std::int64_t amount,
+         transfer_stats& stats) -> couchbase::error
+{
+  auto [err, result] = transactions.run(
+    [&](std::shared_ptr<couchbase::transactions::attempt_context> ctx) -> couchbase::error {
+      ++stats.attempts;
+      auto fail = [&stats](const char* operation, couchbase::error error) {
+        ++stats.attempt_errors[std::string{ operation } + ": " + error.ec().message()];
+        return error;
+      };
+
+      auto [e1, from] = ctx->get(collection, from_id);
+      if (e1.ec()) {
+        return fail("get", e1);
+      }
+      auto [e2, to] = ctx->get(collection, to_id);
+      if (e2.ec()) {
+        return fail("get", e2);
+      }
+
+      auto from_account = from.content_as<bank_account>();
+      auto to_account = to.content_as<bank_account>();
+      if (from_account.balance < amount) {
+        return { bank_error::insufficient_funds, "not enough funds on " + from_id };
+      }
+      from_account.balance -= amount;
+      to_account.balance += amount;
+
+      if (auto [e3, staged] = ctx->replace(from, from_account); e3.ec()) {
+        return fail("replace", e3);
+      }
+      if (auto [e4, staged] = ctx->replace(to, to_account); e4.ec()) {
+        return fail("replace", e4);
+      }
+      return {};
+    });
+  return err;
+}
+
+auto
+run_transfer_worker(couchbase::transactions::transactions& transactions,
+                    const couchbase::collection& collection,
+                    const program_config& config,
+                    const key_distribution& accounts,
+                    std::size_t worker_index,
+                    const start_signal_type& start_signal,
+                    const std::atomic_bool& stop) -> transfer_stats
+{
+  std::mt19937_64 engine{ std::random_device{}() ^ worker_index };
+  std::uniform_int_distribution<std::int64_t> amounts{ 1, config.max_amount };
+
+  transfer_stats stats{};
+  std::this_thread::sleep_until(start_signal.get());
+  while (!stop.load(std::memory_order_relaxed)) {
+    const auto from = accounts.next(engine);
+    auto to = accounts.next(engine);
+    while (to == from) {
+      to = accounts.next(engine);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto err = transfer(transactions,
+                              collection,
+                              make_account_id(config, from),
+                              make_account_id(config, to),
+                              amounts(engine),
+                              stats);
+    if (err.ec()) {
+      ++stats.failures;
+      std::string cause = err.ec().message();
+      if (auto inner = err.cause(); inner.has_value()) {
+        cause += " (cause: " + inner->ec().message() + ")";
+      }
+      ++stats.failure_causes[cause];
+    } else {
+      ++stats.commits;
+      stats.latency.record(std::chrono::steady_clock::now() - start);
+    }
+  }
+  return stats;
+}
+
+auto
+run_step(couchbase::transactions::transactions& transactions,
+         const couchbase::collection& collection,
+         const program_config& config,
+         const key_distribution& accounts,
+         std::size_t num_threads) -> std::pair<transfer_stats, std::chrono::duration<double>>
+{
+  std::promise<std::chrono::steady_clock::time_point> start_promise;
+  const start_signal_type start_signal = start_promise.get_future().share();
+  std::atomic_bool stop{ false };
+
+  std::vector<std::future<transfer_stats>> workers;
+  workers.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&, i]() {
+      return run_transfer_worker(
+        transactions, collection, config, accounts, i, start_signal, stop);
+    }));
+  }
+
+  const auto run_start = std::chrono::steady_clock::now() + std::chrono::milliseconds{ 10 };
+  start_promise.set_value(run_start);
+  std::this_thread::sleep_until(run_start + config.duration);
+  stop = true;
+
+  transfer_stats total{};
+  for (auto& worker : workers) {
+    total.merge(worker.get());
+  }
+  return { std::move(total), std::chrono::steady_clock::now() - run_start };
+}
+
+void
+print_step(std::size_t num_threads,
+           const transfer_stats& stats,
+           std::chrono::duration<double> elapsed)
+{
+  const auto& h = stats.latency;
+  const auto millis = [](std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::milli>(value).count();
+  };
+  const auto attempts_per_commit =
+    stats.commits == 0 ? 0.0
+                       : static_cast<double>(stats.attempts) / static_cast<double>(stats.commits);
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << std::setw(8) << num_threads << std::setw(10) << stats.commits << std::setw(12)
+            << static_cast<double>(stats.commits) / elapsed.count() << std::setw(12)
+            << attempts_per_commit << std::setw(8) << stats.failures << std::setw(9)
+            << millis(h.value_at_percentile(50)) << std::setw(9)
+            << millis(h.value_at_percentile(90)) << std::setw(9)
+            << millis(h.value_at_percentile(99)) << std::setw(9)
+            << millis(h.value_at_percentile(99.9)) << std::setw(9) << millis(h.max()) << "\n";
+}
+
+void
+print_counts(const std::string& title, const std::map<std::string, std::uint64_t>& counts)
+{
+  if (counts.empty()) {
+    return;
+  }
+  std::cout << "  " << title << ":\n";
+  for (const auto& [message, count] : counts) {
+    std::cout << "    " << std::setw(8) << count << "  " << message << "\n";
+  }
+}
+
+// Sums the balances of all accounts.  Returns the number of accounts that could not be read.
+auto
+sum_balances(const couchbase::collection& collection,
+             const program_config& config,
+             std::int64_t& total) -> std::uint64_t
+{
+  std::uint64_t errors{ 0 };
+  total = 0;
+  for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+    auto [err, resp] = collection.get(make_account_id(config, index), {}).get();
+    if (err.ec()) {
+      ++errors;
+      continue;
+    }
+    total += resp.content_as<bank_account>().balance;
+  }
+  return errors;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+  const auto transactions = cluster.transactions();
+
+  {
+    const auto load_start = std::chrono::steady_clock::now();
+    const std::size_t loader_count{ 8 };
+    std::vector<std::future<std::uint64_t>> loaders;
+    const auto per_loader = (config.num_accounts + loader_count - 1) / loader_count;
+    for (std::size_t i = 0; i < loader_count; ++i) {
+      const auto first = std::min<std::uint64_t>(i * per_loader, config.num_accounts);
+      const auto last = std::min<std::uint64_t>(first + per_loader, config.num_accounts);
+      loaders.emplace_back(std::async(std::launch::async, [&collection, &config, first, last]() {
+        return load_accounts(collection, config, first, last);
+      }));
+    }
+    std::uint64_t load_errors{ 0 };
+    for (auto& loader : loaders) {
+      load_errors += loader.get();
+    }
+    const std::chrono::duration<double> load_elapsed =
+      std::chrono::steady_clock::now() - load_start;
+    std::cout << "Created " << config.num_accounts << " accounts in " << std::fixed
+              << std::setprecision(2) << load_elapsed.count() << "s (" << load_errors
+              << " errors)\n\n";
+  }
+
+  const auto accounts =
+    key_distribution::create(config.distribution, config.num_accounts, config.zipf_theta);
+
+  std::vector<std::pair<std::size_t, transfer_stats>> steps;
+  std::cout << "latencies of committed transfers in milliseconds\n";
+  std::cout << std::setw(8) << "threads" << std::setw(10) << "commits" << std::setw(12)
+            << "commits/s" << std::setw(12) << "att/commit" << std::setw(8) << "failed"
+            << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99"
+            << std::setw(9) << "p99.9" << std::setw(9) << "max"
+            << "\n";
+  for (const auto num_threads : config.thread_counts) {
+    auto [stats, elapsed] = run_step(*transactions, collection, config, accounts, num_threads);
+    print_step(num_threads, stats, elapsed);
+    steps.emplace_back(num_threads, std::move(stats));
+  }
+
+  for (const auto& [num_threads, stats] : steps) {
+    if (stats.attempt_errors.empty() && stats.failure_causes.empty()) {
+      continue;
+    }
+    std::cout << "\n" << num_threads << " threads\n";
+    print_counts("errors seen by attempts", stats.attempt_errors);
+    print_counts("failed transfers", stats.failure_causes);
+  }
+
+  std::int64_t total_balance{ 0 };
+  const auto read_errors = sum_balances(collection, config, total_balance);
+  const auto expected_balance =
+    static_cast<std::int64_t>(config.num_accounts) * config.initial_balance;
+  std::cout << "\nSum of balances: " << total_balance << " (expected " << expected_balance;
+  if (read_errors > 0) {
+    std::cout << ", " << read_errors << " accounts could not be read";
+  } else if (total_balance != expected_balance) {
+    std::cout << ", MISMATCH";
+  }
+  std::cout << ")\n";
+
+  if (!config.keep_accounts) {
+    for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+      collection.remove(make_account_id(config, index), {}).get();
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+parse_truthy(const char* val) -> bool
+{
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  for (const auto& truth : truthy_values) {
+    if (val == truth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_ACCOUNTS"); val != nullptr) {
+    config.num_accounts = std::max<std::uint64_t>(std::stoull(val), 2);
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.thread_counts.clear();
+    for (const auto& count : split(val)) {
+      config.thread_counts.emplace_back(std::max<std::size_t>(std::stoul(count), 1));
+    }
+  }
+  if (const auto* val = getenv("DURATION_SECONDS"); val != nullptr) {
+    config.duration = std::chrono::seconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("KEY_DISTRIBUTION"); val != nullptr) {
+    if (auto type = key_distribution_type_from_string(val); type) {
+      config.distribution = *type;
+    } else {
+      std::cout << "Unknown KEY_DISTRIBUTION " << quote(val) << ", using "
+                << to_string(config.distribution) << "\n";
+    }
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("INITIAL_BALANCE"); val != nullptr) {
+    config.initial_balance = std::stoll(val);
+  }
+  if (const auto* val = getenv("MAX_AMOUNT"); val != nullptr) {
+    config.max_amount = std::max<std::int64_t>(std::stoll(val), 1);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("KEEP_ACCOUNTS"); val != nullptr) {
+    config.keep_accounts = parse_truthy(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    config.verbose = parse_truthy(val);
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string threads;
+  for (const auto count : thread_counts) {
+    threads += (threads.empty() ? "" : ",") + std::to_string(count);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "       NUM_ACCOUNTS: " << num_accounts << "\n";
+  std::cout << "        NUM_THREADS: " << threads << "\n";
+  std::cout << "   DURATION_SECONDS: " << duration.count() << "\n";
+  std::cout << "   KEY_DISTRIBUTION: " << to_string(distribution) << "\n";
+  std::cout << "         ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "    INITIAL_BALANCE: " << initial_balance << "\n";
+  std::cout << "         MAX_AMOUNT: " << max_amount << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "      KEEP_ACCOUNTS: " << std::boolalpha << keep_accounts << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
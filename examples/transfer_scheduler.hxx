@@ -0,0 +1,220 @@
+/*
+ * transfer_scheduler — keeps conflicting transfers from running at the same time
+ *
+ * Two transactions that replace the same account cannot both commit: one of them finds
+ * the document staged by the other, or loses the race at commit time, and the SDK rolls
+ * it back and runs it again.  Under a skewed load the hot accounts take part in most
+ * transfers, and the round trips of those discarded attempts add up to a large share
+ * of the total (transfer_contention_bench.cpp counts them).
+ *
+ * transfer_scheduler sits in front of submit_transfer() (bank_transfer.hxx) and never
+ * has two transfers that share an account in flight.  Account IDs are hashed onto
+ * `stripe_count` stripes, and a transfer runs only while it holds the stripes of both
+ * of its accounts.  Transfers whose stripes are free go straight to the
+ * transaction_executor, so disjoint transfers still run in parallel; the others wait
+ * in a FIFO queue per stripe and are started from the completion handler of the
+ * transfer that releases the stripe.  Stripes are taken in ascending order, a transfer
+ * holding the lower of its stripes while it waits for the higher one, so waiting
+ * transfers cannot deadlock.  Two accounts that hash onto the same stripe are
+ * serialized needlessly; with many more stripes than transfers in flight that is rare.
+ *
+ * The scheduler only orders the transfers submitted through it: anything else writing
+ * the same accounts still conflicts with them, and the transactions keep their
+ * retries.  Like the executor it owns no threads; submit() never blocks, and drain()
+ * and the destructor wait for everything submitted, queued transfers included, and
+ * must not be called from a completion handler.
+ */
+
+#pragma once
+
+#include "bank_transfer.hxx"
+#include "transaction_executor.hxx"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct transfer_scheduler_stats {
+  std::uint64_t submitted{ 0 };
+  std::uint64_t deferred{ 0 }; // had to wait for a stripe at least once
+  std::size_t peak_waiting{ 0 };
+};
+
+class transfer_scheduler
+{
+public:
+  transfer_scheduler(transaction_executor& executor,
+                     couchbase::collection collection,
+                     std::size_t stripe_count = 4096)
+    : executor_{ executor }
+    , collection_{ std::move(collection) }
+    , stripes_(std::max<std::size_t>(stripe_count, 1))
+  {
+  }
+
+  transfer_scheduler(const transfer_scheduler&) = delete;
+  auto operator=(const transfer_scheduler&) -> transfer_scheduler& = delete;
+
+  ~transfer_scheduler()
+  {
+    drain();
+  }
+
+  void submit(std::string from_id,
+              std::string to_id,
+              std::int64_t amount,
+              transfer_handler&& handler)
+  {
+    auto next = std::make_shared<transfer>();
+    next->stripes = { stripe_of(from_id), stripe_of(to_id) };
+    std::sort(next->stripes.begin(), next->stripes.end());
+    next->stripe_count = next->stripes[0] == next->stripes[1] ? 1 : 2;
+    next->from_id = std::move(from_id);
+    next->to_id = std::move(to_id);
+    next->amount = amount;
+    next->handler = std::move(handler);
+    {
+      const std::scoped_lock lock(mutex_);
+      ++stats_.submitted;
+      ++outstanding_;
+      if (!acquire(next)) {
+        return;
+      }
+    }
+    start(std::move(next));
+  }
+
+  auto submit(std::string from_id, std::string to_id, std::int64_t amount)
+    -> std::future<transfer_outcome>
+  {
+    auto barrier = std::make_shared<std::promise<transfer_outcome>>();
+    auto future = barrier->get_future();
+    submit(std::move(from_id), std::move(to_id), amount, [barrier](auto outcome) {
+      barrier->set_value(std::move(outcome));
+    });
+    return future;
+  }
+
+  void drain()
+  {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+      return outstanding_ == 0;
+    });
+  }
+
+  [[nodiscard]] auto waiting() const -> std::size_t
+  {
+    const std::scoped_lock lock(mutex_);
+    return waiting_;
+  }
+
+  [[nodiscard]] auto stats() const -> transfer_scheduler_stats
+  {
+    const std::scoped_lock lock(mutex_);
+    return stats_;
+  }
+
+private:
+  struct transfer {
+    std::string from_id{};
+    std::string to_id{};
+    std::int64_t amount{ 0 };
+    transfer_handler handler{};
+    std::array<std::size_t, 2> stripes{};
+    std::size_t stripe_count{ 0 };
+    std::size_t held{ 0 };
+    bool deferred{ false };
+  };
+
+  struct stripe {
+    bool locked{ false };
+    std::deque<std::shared_ptr<transfer>> waiters{};
+  };
+
+  [[nodiscard]] auto stripe_of(const std::string& id) const -> std::size_t
+  {
+    return std::hash<std::string>{}(id) % stripes_.size();
+  }
+
+  // Takes the stripes `t` does not hold yet, in order.  Returns false when `t` has been
+  // queued on a locked stripe instead.  Called with the mutex held.
+  auto acquire(const std::shared_ptr<transfer>& t) -> bool
+  {
+    while (t->held < t->stripe_count) {
+      auto& s = stripes_[t->stripes[t->held]];
+      if (s.locked) {
+        s.waiters.push_back(t);
+        if (!t->deferred) {
+          t->deferred = true;
+          ++stats_.deferred;
+        }
+        stats_.peak_waiting = std::max(stats_.peak_waiting, ++waiting_);
+        return false;
+      }
+      s.locked = true;
+      ++t->held;
+    }
+    return true;
+  }
+
+  void start(std::shared_ptr<transfer> t)
+  {
+    submit_transfer(
+      executor_, collection_, t->from_id, t->to_id, t->amount, [this, t](auto outcome) {
+        if (t->handler) {
+          t->handler(std::move(outcome));
+        }
+        complete(*t);
+      });
+  }
+
+  // Hands each stripe of the finished transfer to its first waiter, and starts the
+  // waiters that now hold all their stripes.
+  void complete(const transfer& finished)
+  {
+    std::vector<std::shared_ptr<transfer>> ready{};
+    {
+      // Notify while holding the mutex, as transaction_executor::complete() does.
+      const std::scoped_lock lock(mutex_);
+      for (std::size_t i = 0; i < finished.stripe_count; ++i) {
+        auto& s = stripes_[finished.stripes[i]];
+        if (s.waiters.empty()) {
+          s.locked = false;
+          continue;
+        }
+        auto next = std::move(s.waiters.front());
+        s.waiters.pop_front();
+        --waiting_;
+        ++next->held;
+        if (acquire(next)) {
+          ready.emplace_back(std::move(next));
+        }
+      }
+      --outstanding_;
+      cv_.notify_all();
+    }
+    for (auto& next : ready) {
+      start(std::move(next));
+    }
+  }
+
+  transaction_executor& executor_;
+  couchbase::collection collection_;
+  std::vector<stripe> stripes_;
+  mutable std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::size_t outstanding_{ 0 };
+  std::size_t waiting_{ 0 };
+  transfer_scheduler_stats stats_{};
+};
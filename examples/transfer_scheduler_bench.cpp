@@ -0,0 +1,444 @@
+/*
+ * transfer_scheduler_bench — scheduled against unscheduled transfers under a skewed load
+ *
+ * Creates NUM_ACCOUNTS bank_account documents, draws NUM_TRANSFERS transfers between
+ * them from the configured distribution, and submits that same list twice for every
+ * limit in MAX_IN_FLIGHT, from the main thread and through a transaction_executor with
+ * that limit (transaction_executor.hxx):
+ *
+ *   unscheduled  straight to submit_transfer() (bank_transfer.hxx), so transfers that
+ *                share a hot account run at the same time and all but one of them are
+ *                rolled back and retried by the SDK
+ *   scheduled    through a transfer_scheduler with STRIPES stripes
+ *                (transfer_scheduler.hxx), which holds a transfer back until no other
+ *                transfer on its accounts is in flight
+ *
+ * and prints for each run
+ *
+ *   commits/s        transfers committed per second, the whole list included
+ *   attempts/commit  attempts per committed transfer, failed transfers included:
+ *                    1.0 means no work was thrown away
+ *   retried          share of the transfers that needed more than one attempt
+ *   failed           transfers that did not commit, with their causes below the table
+ *   deferred         transfers the scheduler held back at least once
+ *
+ * With the zipfian distribution the scheduler trades the retries for waiting: the
+ * transfers on the hottest account run one after the other either way, but
+ * unscheduled they also burn round trips and executor slots on attempts that are
+ * thrown away.  With the uniform distribution both modes should be close.  At the end
+ * the balances are summed, which must give NUM_ACCOUNTS * INITIAL_BALANCE whatever
+ * failed, and the accounts are removed unless KEEP_ACCOUNTS is set.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_ACCOUNTS      number of accounts, at least 2 (default: 100)
+ *   NUM_TRANSFERS     transfers submitted per run (default: 2000)
+ *   MAX_IN_FLIGHT     comma-separated limits on transactions in flight (default: 16,64)
+ *   STRIPES           number of stripes of the scheduler (default: 4096)
+ *   KEY_DISTRIBUTION  uniform, zipfian or hotspot (default: zipfian)
+ *   ZIPF_THETA        skew of the zipfian distribution, < 1 (default: 0.99)
+ *   INITIAL_BALANCE   balance of every account (default: 1000000)
+ *   MAX_AMOUNT        largest amount of a single transfer (default: 100)
+ *   KEY_PREFIX        account document ID prefix (default: "transfer_scheduler::")
+ *   KEEP_ACCOUNTS     do not remove the accounts at the end (default: false)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/logger.hxx>
+
+#include "bank_transfer.hxx"
+#include "key_distribution.hxx"
+#include "transfer_scheduler.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::uint64_t num_accounts{ 100 };
+  std::uint64_t num_transfers{ 2000 };
+  std::vector<std::size_t> in_flight_limits{ 16, 64 };
+  std::size_t stripes{ 4096 };
+  key_distribution_type distribution{ key_distribution_type::zipfian };
+  double zipf_theta{ 0.99 };
+  std::int64_t initial_balance{ 1'000'000 };
+  std::int64_t max_amount{ 100 };
+  std::string key_prefix{ "transfer_scheduler::" };
+  bool keep_accounts{ false };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct planned_transfer {
+  std::string from_id;
+  std::string to_id;
+  std::int64_t amount;
+};
+
+// Filled in by the completion handlers, on the SDK's I/O threads.
+struct batch_outcome {
+  std::mutex mutex{};
+  std::uint64_t commits{ 0 };
+  std::uint64_t failures{ 0 };
+  std::uint64_t attempts{ 0 };
+  std::uint64_t retried{ 0 };
+  std::map<std::string, std::uint64_t> failure_causes{};
+
+  void record(const transfer_outcome& outcome)
+  {
+    const std::scoped_lock lock(mutex);
+    attempts += outcome.attempts;
+    if (outcome.attempts > 1) {
+      ++retried;
+    }
+    if (!outcome.error.ec()) {
+      ++commits;
+      return;
+    }
+    ++failures;
+    std::string cause = outcome.error.ec().message();
+    if (auto inner = outcome.error.cause(); inner.has_value()) {
+      cause += " (cause: " + inner->ec().message() + ")";
+    }
+    ++failure_causes[cause];
+  }
+};
+
+auto
+split(const std::string& list) -> std::vector<std::string>
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.emplace_back(item);
+    }
+  }
+  return items;
+}
+
+auto
+make_account_id(const program_config& config, std::uint64_t index) -> std::string
+{
+  return config.key_prefix + std::to_string(index);
+}
+
+// Upserts all accounts with the initial balance, all of them at once.  Returns the number
+// of failures.
+auto
+load_accounts(const couchbase::collection& collection, const program_config& config)
+  -> std::uint64_t
+{
+  std::vector<std::future<std::pair<couchbase::error, couchbase::mutation_result>>> pending;
+  pending.reserve(config.num_accounts);
+  for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+    const bank_account account{ "account " + std::to_string(index), config.initial_balance };
+    pending.emplace_back(collection.upsert(make_account_id(config, index), account, {}));
+  }
+  std::uint64_t errors{ 0 };
+  for (auto& future : pending) {
+    if (auto [err, resp] = future.get(); err.ec()) {
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+auto
+plan_transfers(const program_config& config) -> std::vector<planned_transfer>
+{
+  const auto accounts =
+    key_distribution::create(config.distribution, config.num_accounts, config.zipf_theta);
+  std::mt19937_64 engine{ std::random_device{}() };
+  std::uniform_int_distribution<std::int64_t> amounts{ 1, config.max_amount };
+
+  std::vector<planned_transfer> transfers;
+  transfers.reserve(config.num_transfers);
+  for (std::uint64_t i = 0; i < config.num_transfers; ++i) {
+    const auto from = accounts.next(engine);
+    auto to = accounts.next(engine);
+    while (to == from) {
+      to = accounts.next(engine);
+    }
+    transfers.push_back(
+      { make_account_id(config, from), make_account_id(config, to), amounts(engine) });
+  }
+  return transfers;
+}
+
+void
+run_batch(const std::shared_ptr<couchbase::transactions::transactions>& transactions,
+          const couchbase::collection& collection,
+          const program_config& config,
+          const std::vector<planned_transfer>& transfers,
+          std::size_t max_in_flight,
+          bool scheduled)
+{
+  batch_outcome outcome{};
+  auto record = [&outcome](auto result) {
+    outcome.record(result);
+  };
+  std::optional<std::uint64_t> deferred{};
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    transaction_executor executor{ transactions, { max_in_flight } };
+    if (scheduled) {
+      transfer_scheduler scheduler{ executor, collection, config.stripes };
+      for (const auto& t : transfers) {
+        scheduler.submit(t.from_id, t.to_id, t.amount, record);
+      }
+      scheduler.drain();
+      deferred = scheduler.stats().deferred;
+    } else {
+      for (const auto& t : transfers) {
+        submit_transfer(executor, collection, t.from_id, t.to_id, t.amount, record);
+      }
+      executor.drain();
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto attempts_per_commit =
+    outcome.commits == 0
+      ? 0.0
+      : static_cast<double>(outcome.attempts) / static_cast<double>(outcome.commits);
+  const auto retried_percent =
+    transfers.empty()
+      ? 0.0
+      : 100.0 * static_cast<double>(outcome.retried) / static_cast<double>(transfers.size());
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << std::setw(13) << (scheduled ? "scheduled" : "unscheduled") << std::setw(11)
+            << max_in_flight << std::setw(10) << outcome.commits << std::setw(12)
+            << static_cast<double>(outcome.commits) / elapsed.count() << std::setw(12)
+            << attempts_per_commit << std::setw(10) << retried_percent << "%" << std::setw(8)
+            << outcome.failures << std::setw(10)
+            << (deferred ? std::to_string(*deferred) : "-") << "\n";
+  for (const auto& [message, count] : outcome.failure_causes) {
+    std::cout << "    " << std::setw(8) << count << "  " << message << "\n";
+  }
+}
+
+// Sums the balances of all accounts.  Returns the number of accounts that could not be read.
+auto
+sum_balances(const couchbase::collection& collection,
+             const program_config& config,
+             std::int64_t& total) -> std::uint64_t
+{
+  std::uint64_t errors{ 0 };
+  total = 0;
+  for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+    auto [err, resp] = collection.get(make_account_id(config, index), {}).get();
+    if (err.ec()) {
+      ++errors;
+      continue;
+    }
+    total += resp.content_as<bank_account>().balance;
+  }
+  return errors;
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+  const auto transactions = cluster.transactions();
+
+  const auto load_errors = load_accounts(collection, config);
+  std::cout << "Created " << config.num_accounts << " accounts (" << load_errors
+            << " errors)\n\n";
+
+  const auto transfers = plan_transfers(config);
+  std::cout << std::setw(13) << "mode" << std::setw(11) << "in flight" << std::setw(10)
+            << "commits" << std::setw(12) << "commits/s" << std::setw(12) << "att/commit"
+            << std::setw(11) << "retried" << std::setw(8) << "failed" << std::setw(10)
+            << "deferred"
+            << "\n";
+  for (const auto max_in_flight : config.in_flight_limits) {
+    run_batch(transactions, collection, config, transfers, max_in_flight, false);
+    run_batch(transactions, collection, config, transfers, max_in_flight, true);
+  }
+
+  std::int64_t total_balance{ 0 };
+  const auto read_errors = sum_balances(collection, config, total_balance);
+  const auto expected_balance =
+    static_cast<std::int64_t>(config.num_accounts) * config.initial_balance;
+  std::cout << "\nSum of balances: " << total_balance << " (expected " << expected_balance;
+  if (read_errors > 0) {
+    std::cout << ", " << read_errors << " accounts could not be read";
+  } else if (total_balance != expected_balance) {
+    std::cout << ", MISMATCH";
+  }
+  std::cout << ")\n";
+
+  if (!config.keep_accounts) {
+    for (std::uint64_t index = 0; index < config.num_accounts; ++index) {
+      collection.remove(make_account_id(config, index), {}).get();
+    }
+  }
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+parse_truthy(const char* val) -> bool
+{
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  for (const auto& truth : truthy_values) {
+    if (val == truth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_ACCOUNTS"); val != nullptr) {
+    config.num_accounts = std::max<std::uint64_t>(std::stoull(val), 2);
+  }
+  if (const auto* val = getenv("NUM_TRANSFERS"); val != nullptr) {
+    config.num_transfers = std::stoull(val);
+  }
+  if (const auto* val = getenv("MAX_IN_FLIGHT"); val != nullptr) {
+    config.in_flight_limits.clear();
+    for (const auto& limit : split(val)) {
+      config.in_flight_limits.emplace_back(std::max<std::size_t>(std::stoul(limit), 1));
+    }
+  }
+  if (const auto* val = getenv("STRIPES"); val != nullptr) {
+    config.stripes = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("KEY_DISTRIBUTION"); val != nullptr) {
+    if (auto type = key_distribution_type_from_string(val); type) {
+      config.distribution = *type;
+    } else {
+      std::cout << "Unknown KEY_DISTRIBUTION " << quote(val) << ", using "
+                << to_string(config.distribution) << "\n";
+    }
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("INITIAL_BALANCE"); val != nullptr) {
+    config.initial_balance = std::stoll(val);
+  }
+  if (const auto* val = getenv("MAX_AMOUNT"); val != nullptr) {
+    config.max_amount = std::max<std::int64_t>(std::stoll(val), 1);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("KEEP_ACCOUNTS"); val != nullptr) {
+    config.keep_accounts = parse_truthy(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    config.verbose = parse_truthy(val);
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::string limits;
+  for (const auto limit : in_flight_limits) {
+    limits += (limits.empty() ? "" : ",") + std::to_string(limit);
+  }
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "       NUM_ACCOUNTS: " << num_accounts << "\n";
+  std::cout << "      NUM_TRANSFERS: " << num_transfers << "\n";
+  std::cout << "      MAX_IN_FLIGHT: " << limits << "\n";
+  std::cout << "            STRIPES: " << stripes << "\n";
+  std::cout << "   KEY_DISTRIBUTION: " << to_string(distribution) << "\n";
+  std::cout << "         ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "    INITIAL_BALANCE: " << initial_balance << "\n";
+  std::cout << "         MAX_AMOUNT: " << max_amount << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "      KEEP_ACCOUNTS: " << std::boolalpha << keep_accounts << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
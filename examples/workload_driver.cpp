@@ -0,0 +1,682 @@
+/*
+ * workload_driver — multi-threaded, closed-loop KV workload generator
+ *
+ * inventory_with_opentelemetry runs one thread over sequential keys, which is a
+ * convenient demo but looks nothing like production traffic: real clients run many
+ * threads against the same connection, a small set of keys tends to receive most of
+ * the requests, and reads and writes are interleaved.  This driver reproduces that
+ * shape so hot-key and mixed-load behaviour can be studied in isolation.
+ *
+ * NUM_THREADS workers share a single couchbase::cluster (and therefore the same
+ * connections and I/O threads).  Every worker runs a closed loop: it picks a key from
+ * the configured distribution, issues a get or an upsert according to READ_RATIO,
+ * waits for the response, records the latency and immediately issues the next
+ * operation.  Each worker keeps its own latency histograms, so recording never
+ * contends; they are merged once the run is over.
+ *
+ * Before the timed run the whole key space is populated (LOAD_KEYS), so reads do not
+ * measure document_not_found responses.  Documents are pre-rendered JSON of exactly
+ * DOCUMENT_SIZE bytes and are stored through raw_json_transcoder, so the driver does
+ * not spend its time serializing.
+ *
+ * Closed-loop results understate tail latency under saturation: a slow response
+ * delays the next request instead of being queued behind it, so the requests that
+ * would have waited are never issued and never measured (coordinated omission).  They
+ * are the right tool to find the throughput a given number of threads can sustain.
+ *
+ * Setting TARGET_RATE switches to open-loop mode.  Each worker then follows a fixed
+ * schedule — operation i of worker w is due at start + (i + w / NUM_THREADS) *
+ * NUM_THREADS / TARGET_RATE — and dispatches it through the callback API without
+ * waiting for earlier operations to complete.  Latency is measured from the
+ * operation's intended start time, not from the moment it was actually sent, so any
+ * time spent waiting behind a slow client or server counts.  When the client cannot
+ * keep up (dispatch runs late, or MAX_IN_FLIGHT operations are already outstanding)
+ * the lag is reported once per second and summarized at the end; raising TARGET_RATE
+ * until that happens finds the saturation point of the client host.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_THREADS          worker threads (default: 4)
+ *   DURATION_SECONDS     length of the timed run (default: 5)
+ *   KEY_SPACE            number of distinct keys (default: 10000)
+ *   KEY_PREFIX           document ID prefix (default: "workload::")
+ *   KEY_DISTRIBUTION     uniform, zipfian or hotspot (default: zipfian)
+ *   ZIPF_THETA           skew of the zipfian distribution, < 1 (default: 0.99)
+ *   HOT_SET_FRACTION     hotspot: fraction of keys that are hot (default: 0.2)
+ *   HOT_OP_FRACTION      hotspot: fraction of operations on hot keys (default: 0.8)
+ *   READ_RATIO           fraction of operations that are reads (default: 0.8)
+ *   DOCUMENT_SIZE        size of each document in bytes (default: 1024)
+ *   LOAD_KEYS            populate the key space before the run (default: true)
+ *   PIN_THREADS          pin worker N to CPU N mod cores, Linux only (default: false)
+ *   TARGET_RATE          total operations per second; enables open-loop mode
+ *   MAX_IN_FLIGHT        open loop: outstanding operations per worker (default: 1024)
+ *   LATE_THRESHOLD_US    open loop: dispatch lag reported as late (default: 1000)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/raw_json_transcoder.hxx>
+#include <couchbase/logger.hxx>
+
+#include "key_distribution.hxx"
+#include "latency_histogram.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_threads{ 4 };
+  std::chrono::seconds duration{ 5 };
+  std::uint64_t key_space{ 10'000 };
+  std::string key_prefix{ "workload::" };
+  key_distribution_type distribution{ key_distribution_type::zipfian };
+  double zipf_theta{ 0.99 };
+  double hot_set_fraction{ 0.2 };
+  double hot_op_fraction{ 0.8 };
+  double read_ratio{ 0.8 };
+  std::size_t document_size{ 1024 };
+  bool load_keys{ true };
+  bool pin_threads{ false };
+  std::optional<double> target_rate{}; // closed loop when not set
+  std::size_t max_in_flight{ 1024 };
+  std::chrono::microseconds late_threshold{ 1000 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+struct operation_stats {
+  latency_histogram latency{};
+  std::uint64_t errors{ 0 };
+  std::string last_error{};
+
+  void merge(const operation_stats& other)
+  {
+    latency.merge(other.latency);
+    errors += other.errors;
+    if (!other.last_error.empty()) {
+      last_error = other.last_error;
+    }
+  }
+};
+
+// How far behind its schedule an open-loop worker dispatched operations.
+struct schedule_stats {
+  std::uint64_t dispatched{ 0 };
+  std::uint64_t late{ 0 };
+  std::chrono::nanoseconds total_lag{};
+  std::chrono::nanoseconds max_lag{};
+
+  void record(std::chrono::nanoseconds lag, std::chrono::nanoseconds late_threshold)
+  {
+    ++dispatched;
+    total_lag += lag;
+    max_lag = std::max(max_lag, lag);
+    if (lag > late_threshold) {
+      ++late;
+    }
+  }
+
+  void merge(const schedule_stats& other)
+  {
+    dispatched += other.dispatched;
+    late += other.late;
+    total_lag += other.total_lag;
+    max_lag = std::max(max_lag, other.max_lag);
+  }
+};
+
+struct worker_result {
+  operation_stats reads{};
+  operation_stats writes{};
+  schedule_stats schedule{};
+};
+
+using start_signal_type = std::shared_future<std::chrono::steady_clock::time_point>;
+
+auto
+make_document_id(const program_config& config, std::uint64_t index) -> std::string
+{
+  return config.key_prefix + std::to_string(index);
+}
+
+// Renders {"k":"xxxx..."} padded so that the whole body is exactly `size` bytes
+// (or as small as the JSON envelope allows).
+auto
+make_document_body(std::size_t size) -> std::string
+{
+  static constexpr std::string_view prefix{ R"({"k":")" };
+  static constexpr std::string_view suffix{ R"("})" };
+  const std::size_t envelope = prefix.size() + suffix.size();
+  std::string body{ prefix };
+  body.append(size > envelope ? size - envelope : 0, 'x');
+  body.append(suffix);
+  return body;
+}
+
+void
+pin_current_thread(std::size_t worker_index)
+{
+#if defined(__linux__)
+  const auto cores = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(static_cast<int>(worker_index % cores), &cpu_set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+    std::cout << "worker " << worker_index << ": unable to set CPU affinity\n";
+  }
+#else
+  (void)worker_index;
+#endif
+}
+
+// Upserts keys [first, last) one after another.  Returns the number of failures.
+auto
+load_keys(const couchbase::collection& collection,
+          const program_config& config,
+          std::uint64_t first,
+          std::uint64_t last) -> std::uint64_t
+{
+  const auto body = make_document_body(config.document_size);
+  std::uint64_t errors{ 0 };
+  for (auto index = first; index < last; ++index) {
+    auto [err, resp] = collection
+                         .upsert<couchbase::codec::raw_json_transcoder>(
+                           make_document_id(config, index), body, {})
+                         .get();
+    if (err.ec()) {
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+auto
+run_closed_loop_worker(const couchbase::collection& collection,
+                       const program_config& config,
+                       const key_distribution& keys,
+                       std::size_t worker_index,
+                       const start_signal_type& start_signal,
+                       const std::atomic_bool& stop) -> worker_result
+{
+  if (config.pin_threads) {
+    pin_current_thread(worker_index);
+  }
+
+  std::mt19937_64 engine{ std::random_device{}() ^ worker_index };
+  std::bernoulli_distribution is_read{ config.read_ratio };
+  const auto body = make_document_body(config.document_size);
+
+  worker_result result{};
+  std::this_thread::sleep_until(start_signal.get());
+  while (!stop.load(std::memory_order_relaxed)) {
+    const auto document_id = make_document_id(config, keys.next(engine));
+    if (is_read(engine)) {
+      const auto start = std::chrono::steady_clock::now();
+      auto [err, resp] = collection.get(document_id, {}).get();
+      result.reads.latency.record(std::chrono::steady_clock::now() - start);
+      if (err.ec()) {
+        ++result.reads.errors;
+        result.reads.last_error = err.message();
+      }
+    } else {
+      const auto start = std::chrono::steady_clock::now();
+      auto [err, resp] =
+        collection.upsert<couchbase::codec::raw_json_transcoder>(document_id, body, {}).get();
+      result.writes.latency.record(std::chrono::steady_clock::now() - start);
+      if (err.ec()) {
+        ++result.writes.errors;
+        result.writes.last_error = err.message();
+      }
+    }
+  }
+  return result;
+}
+
+// sleep_until alone wakes up late by the OS timer slack (tens of microseconds on Linux,
+// up to milliseconds elsewhere), which would show up as schedule lag.  Sleep until
+// shortly before the deadline and spin for the remainder.
+void
+wait_until(std::chrono::steady_clock::time_point deadline)
+{
+  constexpr std::chrono::microseconds spin_window{ 100 };
+  if (deadline - std::chrono::steady_clock::now() > spin_window) {
+    std::this_thread::sleep_until(deadline - spin_window);
+  }
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+void
+update_max(std::atomic<std::int64_t>& target, std::int64_t value)
+{
+  auto current = target.load(std::memory_order_relaxed);
+  while (current < value &&
+         !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+auto
+run_open_loop_worker(const couchbase::collection& collection,
+                     const program_config& config,
+                     const key_distribution& keys,
+                     std::size_t worker_index,
+                     const start_signal_type& start_signal,
+                     std::atomic<std::int64_t>& interval_max_lag_ns) -> worker_result
+{
+  if (config.pin_threads) {
+    pin_current_thread(worker_index);
+  }
+
+  std::mt19937_64 engine{ std::random_device{}() ^ worker_index };
+  std::bernoulli_distribution is_read{ config.read_ratio };
+  const auto body = make_document_body(config.document_size);
+
+  // Completion handlers run on SDK I/O threads and record into `result` under `mutex`.
+  std::mutex mutex;
+  std::condition_variable completion_cv;
+  std::size_t in_flight{ 0 };
+  worker_result result{};
+
+  const auto complete = [&](operation_stats& stats,
+                            std::chrono::steady_clock::time_point intended_start,
+                            const couchbase::error& err) {
+    const auto latency = std::chrono::steady_clock::now() - intended_start;
+    // Notify while still holding the mutex: once in_flight drops to zero the worker
+    // returns and destroys completion_cv.
+    const std::scoped_lock lock(mutex);
+    stats.latency.record(latency);
+    if (err.ec()) {
+      ++stats.errors;
+      stats.last_error = err.message();
+    }
+    --in_flight;
+    completion_cv.notify_all();
+  };
+
+  const std::chrono::duration<double> interval{ static_cast<double>(config.num_threads) /
+                                                *config.target_rate };
+  const auto offset = interval * (static_cast<double>(worker_index) /
+                                  static_cast<double>(config.num_threads));
+  const auto run_start = start_signal.get();
+  const auto run_end = run_start + config.duration;
+  schedule_stats schedule{};
+
+  for (std::uint64_t i = 0;; ++i) {
+    const auto intended_start =
+      run_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    offset + interval * static_cast<double>(i));
+    if (intended_start >= run_end) {
+      break;
+    }
+    wait_until(intended_start);
+
+    {
+      std::unique_lock lock(mutex);
+      completion_cv.wait(lock, [&] {
+        return in_flight < config.max_in_flight;
+      });
+      ++in_flight;
+    }
+
+    const auto lag = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - intended_start);
+    schedule.record(lag, config.late_threshold);
+    update_max(interval_max_lag_ns, lag.count());
+
+    const auto document_id = make_document_id(config, keys.next(engine));
+    if (is_read(engine)) {
+      collection.get(document_id, {}, [&, intended_start](auto err, auto /* resp */) {
+        complete(result.reads, intended_start, err);
+      });
+    } else {
+      collection.upsert<couchbase::codec::raw_json_transcoder>(
+        document_id, body, {}, [&, intended_start](auto err, auto /* resp */) {
+          complete(result.writes, intended_start, err);
+        });
+    }
+  }
+
+  std::unique_lock lock(mutex);
+  completion_cv.wait(lock, [&] {
+    return in_flight == 0;
+  });
+  result.schedule = schedule;
+  return result;
+}
+
+void
+print_operation(const std::string& name,
+                const operation_stats& stats,
+                std::chrono::duration<double> elapsed)
+{
+  const auto& h = stats.latency;
+  const auto micros = [](std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::micro>(value).count();
+  };
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(6) << name << std::setw(12) << h.count() << std::setw(12)
+            << static_cast<double>(h.count()) / elapsed.count() << std::setw(10)
+            << micros(h.mean()) << std::setw(10) << micros(h.value_at_percentile(50))
+            << std::setw(10) << micros(h.value_at_percentile(90)) << std::setw(10)
+            << micros(h.value_at_percentile(99)) << std::setw(10)
+            << micros(h.value_at_percentile(99.9)) << std::setw(10) << micros(h.max())
+            << std::setw(8) << stats.errors << "\n";
+  if (!stats.last_error.empty()) {
+    std::cout << "        last " << name << " error: " << stats.last_error << "\n";
+  }
+}
+
+auto
+make_key_distribution(const program_config& config) -> key_distribution
+{
+  switch (config.distribution) {
+    case key_distribution_type::zipfian:
+      return key_distribution::zipfian(config.key_space, config.zipf_theta);
+    case key_distribution_type::hotspot:
+      return key_distribution::hotspot(
+        config.key_space, config.hot_set_fraction, config.hot_op_fraction);
+    case key_distribution_type::uniform:
+      break;
+  }
+  return key_distribution::uniform(config.key_space);
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // One collection handle shared by every worker: all threads multiplex their requests
+  // over the same cluster connections.
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  if (config.load_keys) {
+    const auto load_start = std::chrono::steady_clock::now();
+    std::vector<std::future<std::uint64_t>> loaders;
+    const auto per_thread = (config.key_space + config.num_threads - 1) / config.num_threads;
+    for (std::size_t i = 0; i < config.num_threads; ++i) {
+      const auto first = std::min<std::uint64_t>(i * per_thread, config.key_space);
+      const auto last = std::min<std::uint64_t>(first + per_thread, config.key_space);
+      loaders.emplace_back(std::async(std::launch::async, [&collection, &config, first, last]() {
+        return load_keys(collection, config, first, last);
+      }));
+    }
+    std::uint64_t load_errors{ 0 };
+    for (auto& loader : loaders) {
+      load_errors += loader.get();
+    }
+    const std::chrono::duration<double> load_elapsed =
+      std::chrono::steady_clock::now() - load_start;
+    std::cout << "Loaded " << config.key_space << " keys in " << std::fixed
+              << std::setprecision(2) << load_elapsed.count() << "s (" << load_errors
+              << " errors)\n\n";
+  }
+
+  const auto keys = make_key_distribution(config);
+
+  std::promise<std::chrono::steady_clock::time_point> start_promise;
+  const start_signal_type start_signal = start_promise.get_future().share();
+  std::atomic_bool stop{ false };
+  std::atomic<std::int64_t> interval_max_lag_ns{ 0 };
+
+  std::vector<std::future<worker_result>> workers;
+  workers.reserve(config.num_threads);
+  for (std::size_t i = 0; i < config.num_threads; ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&, i]() {
+      if (config.target_rate) {
+        return run_open_loop_worker(
+          collection, config, keys, i, start_signal, interval_max_lag_ns);
+      }
+      return run_closed_loop_worker(collection, config, keys, i, start_signal, stop);
+    }));
+  }
+
+  // A short head start lets every worker reach its first scheduled operation in time.
+  const auto run_start = std::chrono::steady_clock::now() + std::chrono::milliseconds{ 10 };
+  const auto run_end = run_start + config.duration;
+  start_promise.set_value(run_start);
+  for (auto tick = run_start + std::chrono::seconds{ 1 }; tick < run_end;
+       tick += std::chrono::seconds{ 1 }) {
+    std::this_thread::sleep_until(tick);
+    const std::chrono::nanoseconds lag{ interval_max_lag_ns.exchange(0) };
+    if (config.target_rate && lag > config.late_threshold) {
+      std::cout << "  behind schedule by up to " << std::fixed << std::setprecision(2)
+                << std::chrono::duration<double, std::milli>(lag).count() << "ms\n";
+    }
+  }
+  std::this_thread::sleep_until(run_end);
+  stop = true;
+
+  worker_result total{};
+  for (auto& worker : workers) {
+    auto result = worker.get();
+    total.reads.merge(result.reads);
+    total.writes.merge(result.writes);
+    total.schedule.merge(result.schedule);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - run_start;
+
+  operation_stats all{};
+  all.merge(total.reads);
+  all.merge(total.writes);
+
+  std::cout << "Ran " << config.num_threads << " threads for " << std::fixed
+            << std::setprecision(2) << elapsed.count() << "s ("
+            << (config.target_rate ? "open loop" : "closed loop") << ")\n";
+  if (config.target_rate) {
+    const auto& schedule = total.schedule;
+    const auto mean_lag = schedule.dispatched == 0
+                            ? std::chrono::nanoseconds::zero()
+                            : schedule.total_lag / static_cast<std::int64_t>(schedule.dispatched);
+    std::cout << "target rate: " << std::setprecision(1) << *config.target_rate
+              << " ops/s, dispatched: "
+              << static_cast<double>(schedule.dispatched) /
+                   std::chrono::duration<double>(config.duration).count()
+              << " ops/s\n";
+    std::cout << "schedule lag: mean "
+              << std::chrono::duration<double, std::micro>(mean_lag).count() << "us, max "
+              << std::chrono::duration<double, std::micro>(schedule.max_lag).count() << "us, "
+              << schedule.late << " of " << schedule.dispatched << " operations started more than "
+              << config.late_threshold.count() << "us late\n";
+    if (schedule.late > 0) {
+      std::cout << "the client fell behind schedule: TARGET_RATE is above what it sustains, "
+                   "latencies below include the time spent queued in the client\n";
+    }
+  }
+  std::cout << "latencies in microseconds\n";
+  std::cout << std::setw(6) << "op" << std::setw(12) << "count" << std::setw(12) << "ops/s"
+            << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+            << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max"
+            << std::setw(8) << "errors"
+            << "\n";
+  print_operation("get", total.reads, elapsed);
+  print_operation("upsert", total.writes, elapsed);
+  print_operation("all", all, elapsed);
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+parse_truthy(const char* val) -> bool
+{
+  const std::array<std::string, 5> truthy_values = {
+    "yes", "y", "on", "true", "1",
+  };
+  for (const auto& truth : truthy_values) {
+    if (val == truth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("DURATION_SECONDS"); val != nullptr) {
+    config.duration = std::chrono::seconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("KEY_SPACE"); val != nullptr) {
+    config.key_space = std::max<std::uint64_t>(std::stoull(val), 1);
+  }
+  if (const auto* val = getenv("KEY_PREFIX"); val != nullptr) {
+    config.key_prefix = val;
+  }
+  if (const auto* val = getenv("KEY_DISTRIBUTION"); val != nullptr) {
+    if (auto type = key_distribution_type_from_string(val); type) {
+      config.distribution = *type;
+    } else {
+      std::cout << "Unknown KEY_DISTRIBUTION " << quote(val) << ", using "
+                << to_string(config.distribution) << "\n";
+    }
+  }
+  if (const auto* val = getenv("ZIPF_THETA"); val != nullptr) {
+    config.zipf_theta = std::stod(val);
+  }
+  if (const auto* val = getenv("HOT_SET_FRACTION"); val != nullptr) {
+    config.hot_set_fraction = std::stod(val);
+  }
+  if (const auto* val = getenv("HOT_OP_FRACTION"); val != nullptr) {
+    config.hot_op_fraction = std::stod(val);
+  }
+  if (const auto* val = getenv("READ_RATIO"); val != nullptr) {
+    config.read_ratio = std::clamp(std::stod(val), 0.0, 1.0);
+  }
+  if (const auto* val = getenv("DOCUMENT_SIZE"); val != nullptr) {
+    config.document_size = std::stoul(val);
+  }
+  if (const auto* val = getenv("LOAD_KEYS"); val != nullptr) {
+    config.load_keys = parse_truthy(val);
+  }
+  if (const auto* val = getenv("PIN_THREADS"); val != nullptr) {
+    config.pin_threads = parse_truthy(val);
+  }
+  if (const auto* val = getenv("TARGET_RATE"); val != nullptr) {
+    if (const auto rate = std::stod(val); rate > 0) {
+      config.target_rate = rate;
+    }
+  }
+  if (const auto* val = getenv("MAX_IN_FLIGHT"); val != nullptr) {
+    config.max_in_flight = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("LATE_THRESHOLD_US"); val != nullptr) {
+    config.late_threshold = std::chrono::microseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    config.verbose = parse_truthy(val);
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "   DURATION_SECONDS: " << duration.count() << "\n";
+  std::cout << "          KEY_SPACE: " << key_space << "\n";
+  std::cout << "         KEY_PREFIX: " << quote(key_prefix) << "\n";
+  std::cout << "   KEY_DISTRIBUTION: " << to_string(distribution) << "\n";
+  std::cout << "         ZIPF_THETA: " << zipf_theta << "\n";
+  std::cout << "   HOT_SET_FRACTION: " << hot_set_fraction << "\n";
+  std::cout << "    HOT_OP_FRACTION: " << hot_op_fraction << "\n";
+  std::cout << "         READ_RATIO: " << read_ratio << "\n";
+  std::cout << "      DOCUMENT_SIZE: " << document_size << "\n";
+  std::cout << "          LOAD_KEYS: " << std::boolalpha << load_keys << "\n";
+  std::cout << "        PIN_THREADS: " << std::boolalpha << pin_threads << "\n";
+  std::cout << "        TARGET_RATE: "
+            << (target_rate ? std::to_string(*target_rate) : "[CLOSED LOOP]") << "\n";
+  std::cout << "      MAX_IN_FLIGHT: " << max_in_flight << "\n";
+  std::cout << "  LATE_THRESHOLD_US: " << late_threshold.count() << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,310 @@
+/*
+ * write_behind — coalescing hot-key inventory updates with write_behind_buffer
+ *
+ * The inventory loop in inventory_with_opentelemetry.cpp rewrites the same item
+ * documents over and over, and only the latest quantity matters.  This program runs
+ * the same kind of update stream twice against NUM_ITEMS items: first with one blocking
+ * upsert per update, then through the write_behind_buffer from write_behind.hxx, which
+ * keeps only the newest value of each item and flushes every FLUSH_INTERVAL_MS.  It
+ * prints the number of upserts actually sent and the time taken by each approach, then
+ * reads every item back to check that the last update of each one was stored.
+ *
+ * Every DURABLE_EVERY-th update of a thread is written with upsert_durable() and
+ * durability_level::majority, which bypasses the flush delay and waits for the result.
+ * On a single-node cluster whose bucket has replicas configured, those writes fail with
+ * durability_impossible; the error is printed and the run continues.
+ *
+ * Environment (in addition to the usual connection settings):
+ *   NUM_THREADS         writer threads (default: 4)
+ *   NUM_ITEMS           distinct item documents (default: 16)
+ *   NUM_UPDATES         updates across all threads, per approach (default: 20000)
+ *   FLUSH_INTERVAL_MS   write-behind flush interval (default: 50)
+ *   MAX_IN_FLIGHT       maximum write-behind upserts outstanding (default: 64)
+ *   DURABLE_EVERY       every Nth update of a thread is durable; 0 disables (default: 0)
+ */
+
+#include <couchbase/cluster.hxx>
+#include <couchbase/codec/tao_json_serializer.hxx>
+#include <couchbase/logger.hxx>
+
+#include <tao/json.hpp>
+
+#include "write_behind.hxx"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+struct program_config {
+  std::string connection_string{ "couchbase://127.0.0.1" };
+  std::string user_name{ "Administrator" };
+  std::string password{ "password" };
+  std::string bucket_name{ "default" };
+  std::string scope_name{ couchbase::scope::default_name };
+  std::string collection_name{ couchbase::collection::default_name };
+  std::size_t num_threads{ 4 };
+  std::size_t num_items{ 16 };
+  std::size_t num_updates{ 20000 };
+  std::chrono::milliseconds flush_interval{ 50 };
+  std::size_t max_in_flight{ 64 };
+  std::size_t durable_every{ 0 };
+  std::optional<std::string> profile{};
+  bool verbose{ false };
+
+  static auto from_env() -> program_config;
+  static auto quote(std::string val) -> std::string;
+  void dump();
+};
+
+auto
+make_item_id(std::size_t index) -> std::string
+{
+  return "item::WIDGET-" + std::to_string(index);
+}
+
+auto
+make_item(std::size_t index, std::int64_t quantity) -> tao::json::value
+{
+  return {
+    { "name", "Widget " + std::to_string(index) },
+    { "sku", "WIDGET-" + std::to_string(index) },
+    { "category", "widgets" },
+    { "quantity", quantity },
+    { "price", 29.99 },
+  };
+}
+
+// Runs `update(i, item, quantity)` num_updates times across num_threads threads.  Item i is
+// only updated by thread i % num_threads, so the final quantity of every item is known:
+// it is returned, indexed by item.
+template<typename Update>
+auto
+run_updates(const program_config& config, Update&& update) -> std::vector<std::int64_t>
+{
+  std::vector<std::int64_t> final_quantity(config.num_items, -1);
+  std::vector<std::thread> workers;
+  workers.reserve(config.num_threads);
+  for (std::size_t t = 0; t < config.num_threads; ++t) {
+    const auto updates = config.num_updates / config.num_threads +
+                         (t < config.num_updates % config.num_threads ? 1 : 0);
+    workers.emplace_back([&, t, updates] {
+      std::size_t item = t;
+      for (std::size_t i = 0; i < updates && t < config.num_items; ++i) {
+        const auto quantity = static_cast<std::int64_t>(i);
+        update(i, item, quantity);
+        final_quantity[item] = quantity;
+        item += config.num_threads;
+        if (item >= config.num_items) {
+          item = t;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return final_quantity;
+}
+
+auto
+elapsed_ms(std::chrono::steady_clock::time_point start) -> double
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+int
+main()
+{
+  auto config = program_config::from_env(); // Load config from environment variables
+  config.dump();
+
+  if (config.verbose) {
+    // Enable SDK trace logging to stdout — useful for diagnosing connectivity issues
+    couchbase::logger::initialize_console_logger();
+    couchbase::logger::set_level(couchbase::logger::log_level::trace);
+  }
+
+  // Cluster options carry credentials and optional performance profiles
+  auto options = couchbase::cluster_options(config.user_name, config.password);
+  if (config.profile) {
+    options.apply_profile(config.profile.value()); // Tune timeouts for your network conditions
+  }
+
+  auto [connect_err, cluster] =
+    couchbase::cluster::connect(config.connection_string, options).get();
+  if (connect_err) {
+    std::cout << "Unable to connect to the cluster. ec: " << connect_err.message() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto collection = cluster.bucket(config.bucket_name)
+                            .scope(config.scope_name)
+                            .collection(config.collection_name);
+
+  std::cout << std::fixed << std::setprecision(2);
+  {
+    // Baseline: every update is its own round trip.
+    std::atomic_uint64_t failed{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+    run_updates(config, [&](std::size_t, std::size_t item, std::int64_t quantity) {
+      auto [err, resp] = collection.upsert(make_item_id(item), make_item(item, quantity)).get();
+      if (err.ec()) {
+        ++failed;
+      }
+    });
+    std::cout << "direct upsert: " << config.num_updates << " updates, " << config.num_updates
+              << " upserts sent, " << failed << " failed, " << elapsed_ms(start) << "ms\n";
+  }
+
+  std::vector<std::int64_t> final_quantity;
+  {
+    write_behind_options buffer_options{};
+    buffer_options.flush_interval = config.flush_interval;
+    buffer_options.max_in_flight = config.max_in_flight;
+    buffer_options.on_error = [](const std::string& id, const couchbase::error& err) {
+      std::cout << "  write-behind upsert " << id << ": " << err.message() << "\n";
+    };
+    write_behind_buffer buffer{ collection, buffer_options };
+
+    std::atomic_uint64_t durable_failed{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+    final_quantity =
+      run_updates(config, [&](std::size_t i, std::size_t item, std::int64_t quantity) {
+        if (config.durable_every > 0 && (i + 1) % config.durable_every == 0) {
+          auto [err, resp] =
+            buffer.upsert_durable(make_item_id(item), make_item(item, quantity)).get();
+          if (err.ec() && durable_failed++ == 0) {
+            std::cout << "  durable upsert " << make_item_id(item) << ": " << err.message()
+                      << "\n";
+          }
+          return;
+        }
+        buffer.upsert(make_item_id(item), make_item(item, quantity));
+      });
+    buffer.flush();
+    const auto elapsed = elapsed_ms(start);
+
+    const auto stats = buffer.stats();
+    std::cout << "write-behind: " << stats.submitted << " updates, "
+              << stats.written + stats.failed << " upserts sent (" << stats.coalesced
+              << " coalesced, " << stats.durable << " durable), " << stats.failed << " failed, "
+              << elapsed << "ms\n";
+  }
+
+  std::size_t mismatched{ 0 };
+  for (std::size_t item = 0; item < config.num_items; ++item) {
+    if (final_quantity[item] < 0) {
+      continue;
+    }
+    auto [err, resp] = collection.get(make_item_id(item), {}).get();
+    if (err.ec()) {
+      ++mismatched;
+      std::cout << "  get " << make_item_id(item) << ": " << err.message() << "\n";
+      continue;
+    }
+    if (const auto quantity =
+          resp.content_as<tao::json::value>().at("quantity").as<std::int64_t>();
+        quantity != final_quantity[item]) {
+      ++mismatched;
+      std::cout << "  " << make_item_id(item) << ": quantity " << quantity << ", expected "
+                << final_quantity[item] << "\n";
+    }
+  }
+  std::cout << "verified " << config.num_items << " items, " << mismatched
+            << " without their last update\n";
+
+  // Gracefully shut down the cluster connection and release resources
+  cluster.close().get();
+
+  return 0;
+}
+
+auto
+program_config::from_env() -> program_config
+{
+  program_config config{};
+
+  if (const auto* val = getenv("CONNECTION_STRING"); val != nullptr) {
+    config.connection_string = val;
+  }
+  if (const auto* val = getenv("USER_NAME"); val != nullptr) {
+    config.user_name = val;
+  }
+  if (const auto* val = getenv("PASSWORD"); val != nullptr) {
+    config.password = val;
+  }
+  if (const auto* val = getenv("BUCKET_NAME"); val != nullptr) {
+    config.bucket_name = val;
+  }
+  if (const auto* val = getenv("SCOPE_NAME"); val != nullptr) {
+    config.scope_name = val;
+  }
+  if (const auto* val = getenv("COLLECTION_NAME"); val != nullptr) {
+    config.collection_name = val;
+  }
+  if (const auto* val = getenv("NUM_THREADS"); val != nullptr) {
+    config.num_threads = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_ITEMS"); val != nullptr) {
+    config.num_items = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("NUM_UPDATES"); val != nullptr) {
+    config.num_updates = std::stoul(val);
+  }
+  if (const auto* val = getenv("FLUSH_INTERVAL_MS"); val != nullptr) {
+    config.flush_interval = std::chrono::milliseconds{ std::stoul(val) };
+  }
+  if (const auto* val = getenv("MAX_IN_FLIGHT"); val != nullptr) {
+    config.max_in_flight = std::max<std::size_t>(std::stoul(val), 1);
+  }
+  if (const auto* val = getenv("DURABLE_EVERY"); val != nullptr) {
+    config.durable_every = std::stoul(val);
+  }
+  if (const auto* val = getenv("PROFILE"); val != nullptr) {
+    config.profile = val; // e.g. "wan_development"
+  }
+  if (const auto* val = getenv("VERBOSE"); val != nullptr) {
+    const std::array<std::string, 5> truthy_values = {
+      "yes", "y", "on", "true", "1",
+    };
+    for (const auto& truth : truthy_values) {
+      if (val == truth) {
+        config.verbose = true;
+        break;
+      }
+    }
+  }
+
+  return config;
+}
+
+auto
+program_config::quote(std::string val) -> std::string
+{
+  return "\"" + val + "\"";
+}
+
+void
+program_config::dump()
+{
+  std::cout << "  CONNECTION_STRING: " << quote(connection_string) << "\n";
+  std::cout << "          USER_NAME: " << quote(user_name) << "\n";
+  std::cout << "           PASSWORD: [HIDDEN]\n";
+  std::cout << "        BUCKET_NAME: " << quote(bucket_name) << "\n";
+  std::cout << "         SCOPE_NAME: " << quote(scope_name) << "\n";
+  std::cout << "    COLLECTION_NAME: " << quote(collection_name) << "\n";
+  std::cout << "        NUM_THREADS: " << num_threads << "\n";
+  std::cout << "          NUM_ITEMS: " << num_items << "\n";
+  std::cout << "        NUM_UPDATES: " << num_updates << "\n";
+  std::cout << "  FLUSH_INTERVAL_MS: " << flush_interval.count() << "\n";
+  std::cout << "      MAX_IN_FLIGHT: " << max_in_flight << "\n";
+  std::cout << "      DURABLE_EVERY: " << durable_every << "\n";
+  std::cout << "            VERBOSE: " << std::boolalpha << verbose << "\n";
+  std::cout << "            PROFILE: " << (profile ? quote(*profile) : "[NONE]") << "\n\n";
+}
@@ -0,0 +1,340 @@
+/*
+ * write_behind — coalescing write-behind buffer for hot-key upserts
+ *
+ * Workloads that rewrite the same documents many times per second (counters, inventory
+ * levels, session state) usually only care about the last value.  write_behind_buffer
+ * keeps at most one pending value per document ID: upsert() encodes the document on the
+ * calling thread and replaces whatever was pending for that ID, so N writes to a hot key
+ * within one flush interval cost one round trip instead of N.
+ *
+ * A background thread flushes pending values every `flush_interval` (or sooner once
+ * `max_pending` IDs are waiting), dispatching them through the callback API with at most
+ * `max_in_flight` upserts outstanding.  At most one write per ID is ever in flight, so
+ * writes to the same document are applied in the order they were made; a value written
+ * while the previous one is still in flight waits for the next flush.
+ *
+ * Buffered writes are fire-and-forget: failures are counted in stats() and reported to
+ * the optional `on_error` handler (on an SDK I/O thread).  Writes that need a durability
+ * guarantee go through upsert_durable() instead, which skips the flush delay and returns
+ * a future for the result.  It supersedes any value still pending for the ID and keeps
+ * the per-ID ordering; if a later buffered write coalesces into it before it is sent,
+ * that later value is the one written with the requested durability.
+ *
+ * flush() blocks until every write made before the call has completed.  Every write is
+ * tagged with the flush() generation it was submitted under, and a value that
+ * coalesces into a pending one keeps the older tag, so a flush() waits for the write
+ * that actually carries its values, however often the key is rewritten meanwhile.  The
+ * destructor flushes, so nothing accepted by the buffer is dropped on shutdown.  Neither
+ * may be called from an SDK completion handler.
+ *
+ * write_behind_buffer writes to a couchbase::collection.  basic_write_behind_buffer
+ * takes any type with the same callback upsert(), which lets a test hold completions
+ * back (tests/write_behind_flush_test.cpp).
+ */
+
+#pragma once
+
+#include <couchbase/collection.hxx>
+#include <couchbase/codec/default_json_transcoder.hxx>
+
+#include "kv_multi.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct write_behind_options {
+  std::chrono::milliseconds flush_interval{ 50 };
+  std::size_t max_pending{ 10000 }; // pending IDs that trigger an early flush
+  std::size_t max_in_flight{ 128 };
+  couchbase::upsert_options upsert_options{};
+  std::function<void(const std::string&, const couchbase::error&)> on_error{};
+};
+
+struct write_behind_stats {
+  std::uint64_t submitted{ 0 }; // upsert() and upsert_durable() calls
+  std::uint64_t coalesced{ 0 }; // values replaced before they were sent
+  std::uint64_t written{ 0 };   // upserts that succeeded
+  std::uint64_t failed{ 0 };    // upserts that failed
+  std::uint64_t durable{ 0 };   // upserts sent with a durability level
+};
+
+template<typename Collection>
+class basic_write_behind_buffer
+{
+public:
+  using durable_result = std::pair<couchbase::error, couchbase::mutation_result>;
+
+  basic_write_behind_buffer(Collection collection, write_behind_options options = {})
+    : collection_{ std::move(collection) }
+    , options_{ std::move(options) }
+    , window_{ options_.max_in_flight }
+    , flusher_{ [this] {
+      run_flusher();
+    } }
+  {
+  }
+
+  basic_write_behind_buffer(const basic_write_behind_buffer&) = delete;
+  auto operator=(const basic_write_behind_buffer&) -> basic_write_behind_buffer& = delete;
+
+  ~basic_write_behind_buffer()
+  {
+    flush();
+    {
+      const std::scoped_lock lock(mutex_);
+      stopping_ = true;
+    }
+    flusher_cv_.notify_all();
+    flusher_.join();
+    // The last completion handlers may still be on their way out of the window.
+    window_.drain();
+  }
+
+  // Buffers `document` as the next value of `id`, replacing any value still pending.
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename Document>
+  void upsert(const std::string& id, const Document& document)
+  {
+    submit(id, Transcoder::encode(document), couchbase::durability_level::none, nullptr);
+  }
+
+  // Writes `document` with `durability` without waiting for the flush interval.
+  template<typename Transcoder = couchbase::codec::default_json_transcoder, typename Document>
+  auto upsert_durable(const std::string& id,
+                      const Document& document,
+                      couchbase::durability_level durability =
+                        couchbase::durability_level::majority) -> std::future<durable_result>
+  {
+    auto waiter = std::make_shared<std::promise<durable_result>>();
+    auto future = waiter->get_future();
+    submit(id, Transcoder::encode(document), durability, std::move(waiter));
+    return future;
+  }
+
+  // Blocks until every write submitted before the call has completed.
+  void flush()
+  {
+    std::unique_lock lock(mutex_);
+    const auto target = generation_++;
+    ++flush_waiters_;
+    flush_requested_ = true;
+    flusher_cv_.notify_all();
+    drained_cv_.wait(lock, [this, target] {
+      return outstanding_.empty() || outstanding_.begin()->first > target;
+    });
+    --flush_waiters_;
+  }
+
+  [[nodiscard]] auto stats() const -> write_behind_stats
+  {
+    const std::scoped_lock lock(mutex_);
+    return stats_;
+  }
+
+private:
+  struct pending_write {
+    couchbase::codec::encoded_value value{};
+    couchbase::durability_level durability{ couchbase::durability_level::none };
+    std::vector<std::shared_ptr<std::promise<durable_result>>> waiters{};
+    // flush() generation of the oldest value coalesced into this write; it stays counted
+    // in outstanding_ until this write completes
+    std::uint64_t generation{ 0 };
+  };
+
+  struct key_state {
+    std::optional<pending_write> pending{};
+    bool in_flight{ false };
+  };
+
+  void submit(const std::string& id,
+              couchbase::codec::encoded_value value,
+              couchbase::durability_level durability,
+              std::shared_ptr<std::promise<durable_result>> waiter)
+  {
+    std::optional<pending_write> to_dispatch{};
+    {
+      const std::scoped_lock lock(mutex_);
+      ++stats_.submitted;
+      auto& state = keys_[id];
+      if (!state.pending) {
+        state.pending.emplace();
+        state.pending->generation = generation_;
+        ++outstanding_[generation_];
+        ++pending_count_;
+      } else {
+        ++stats_.coalesced;
+      }
+      auto& pending = *state.pending;
+      pending.value = std::move(value);
+      if (durability != couchbase::durability_level::none) {
+        pending.durability = std::max(pending.durability, durability);
+        pending.waiters.emplace_back(std::move(waiter));
+      }
+
+      if (!pending.waiters.empty() && !state.in_flight) {
+        to_dispatch = take_pending(state);
+      } else if (pending_count_ >= options_.max_pending) {
+        flush_requested_ = true;
+        flusher_cv_.notify_all();
+      }
+    }
+    if (to_dispatch) {
+      dispatch(id, std::move(*to_dispatch));
+    }
+  }
+
+  // Must be called with mutex_ held.
+  auto take_pending(key_state& state) -> pending_write
+  {
+    auto pending = std::move(*state.pending);
+    state.pending.reset();
+    state.in_flight = true;
+    --pending_count_;
+    return pending;
+  }
+
+  // Must be called with mutex_ held.
+  void release_generation(std::uint64_t generation)
+  {
+    if (auto it = outstanding_.find(generation); it != outstanding_.end() && --it->second == 0) {
+      outstanding_.erase(it);
+      drained_cv_.notify_all();
+    }
+  }
+
+  void dispatch(const std::string& id, pending_write write)
+  {
+    window_.acquire();
+    send(id, std::move(write));
+  }
+
+  // Sends `write` on a window slot that is already held.  The slot is handed over to the
+  // next value of the same ID when that one has to go out right away, and released
+  // otherwise.
+  void send(const std::string& id, pending_write write)
+  {
+    auto options = options_.upsert_options;
+    if (write.durability != couchbase::durability_level::none) {
+      options.durability(write.durability);
+    }
+    collection_.upsert(
+      id,
+      std::move(write.value),
+      options,
+      [this,
+       id,
+       durability = write.durability,
+       generation = write.generation,
+       waiters = std::move(write.waiters)](auto err, auto resp) mutable {
+        auto next = complete(id, durability, generation, err);
+        for (auto& waiter : waiters) {
+          waiter->set_value({ err, resp });
+        }
+        if (next) {
+          send(id, std::move(*next));
+        } else {
+          window_.release();
+        }
+      });
+  }
+
+  auto complete(const std::string& id,
+                couchbase::durability_level durability,
+                std::uint64_t generation,
+                const couchbase::error& err) -> std::optional<pending_write>
+  {
+    std::optional<pending_write> next{};
+    {
+      const std::scoped_lock lock(mutex_);
+      if (err.ec()) {
+        ++stats_.failed;
+      } else {
+        ++stats_.written;
+      }
+      if (durability != couchbase::durability_level::none) {
+        ++stats_.durable;
+      }
+
+      release_generation(generation);
+      auto it = keys_.find(id);
+      it->second.in_flight = false;
+      if (!it->second.pending) {
+        keys_.erase(it);
+      } else if (!it->second.pending->waiters.empty() || flush_waiters_ > 0) {
+        // A durable value, or one that flush() waits for, was queued behind this write.
+        next = take_pending(it->second);
+      }
+    }
+    if (err.ec() && options_.on_error) {
+      options_.on_error(id, err);
+    }
+    return next;
+  }
+
+  void run_flusher()
+  {
+    std::vector<std::string> ready;
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        flusher_cv_.wait_for(lock, options_.flush_interval, [this] {
+          return stopping_ || flush_requested_;
+        });
+        if (stopping_) {
+          return;
+        }
+        flush_requested_ = false;
+        for (const auto& [id, state] : keys_) {
+          if (state.pending && !state.in_flight) {
+            ready.push_back(id);
+          }
+        }
+      }
+      for (const auto& id : ready) {
+        std::optional<pending_write> write{};
+        {
+          const std::scoped_lock lock(mutex_);
+          if (auto it = keys_.find(id);
+              it != keys_.end() && it->second.pending && !it->second.in_flight) {
+            write = take_pending(it->second);
+          }
+        }
+        if (write) {
+          dispatch(id, std::move(*write));
+        }
+      }
+      ready.clear();
+    }
+  }
+
+  const Collection collection_;
+  const write_behind_options options_;
+
+  mutable std::mutex mutex_{};
+  std::condition_variable flusher_cv_{};
+  std::condition_variable drained_cv_{};
+  std::unordered_map<std::string, key_state> keys_{};
+  std::map<std::uint64_t, std::size_t> outstanding_{}; // generation -> IDs not yet written
+  std::uint64_t generation_{ 0 };
+  std::size_t pending_count_{ 0 };
+  std::size_t flush_waiters_{ 0 };
+  bool flush_requested_{ false };
+  bool stopping_{ false };
+  write_behind_stats stats_{};
+
+  kv_multi_detail::window window_;
+  std::thread flusher_;
+};
+
+using write_behind_buffer = basic_write_behind_buffer<couchbase::collection>;
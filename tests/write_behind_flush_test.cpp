@@ -0,0 +1,175 @@
+/*
+ * write_behind_flush_test — flush() must wait for the write that carries its values
+ *
+ * Runs basic_write_behind_buffer (examples/write_behind.hxx) against held_collection,
+ * whose upsert() only records the completion handler, so the test decides when each
+ * write completes.  The scenario is the hot-key case: upsert(k, v1) is sent, flush()
+ * waits for it, and another upsert(k, v2) arrives while v1 is still in flight.  flush()
+ * must not return before v1 has completed, and must return once it has, without waiting
+ * for v2.
+ *
+ * No server is needed; the program runs every check and exits with EXIT_FAILURE if any
+ * of them failed.
+ */
+
+#include <couchbase/codec/raw_string_transcoder.hxx>
+#include <couchbase/collection.hxx>
+
+#include "write_behind.hxx"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using couchbase::codec::raw_string_transcoder;
+using upsert_completion = std::function<void(couchbase::error, couchbase::mutation_result)>;
+
+struct held_upsert {
+  std::string id;
+  couchbase::codec::encoded_value value;
+  upsert_completion handler;
+};
+
+// Stands in for couchbase::collection: upsert() keeps the handler until complete_next(),
+// or completes it right away after release_all().
+class held_collection
+{
+public:
+  template<typename Handler>
+  void upsert(std::string id,
+              couchbase::codec::encoded_value value,
+              const couchbase::upsert_options& /* options */,
+              Handler&& handler) const
+  {
+    {
+      const std::scoped_lock lock(state_->mutex);
+      if (!state_->released) {
+        state_->held.push_back({ std::move(id), std::move(value), std::forward<Handler>(handler) });
+        state_->cv.notify_all();
+        return;
+      }
+    }
+    handler(couchbase::error{}, couchbase::mutation_result{});
+  }
+
+  // Waits until `count` upserts have been sent and not completed yet.
+  [[nodiscard]] auto wait_for_held(std::size_t count) const -> bool
+  {
+    std::unique_lock lock(state_->mutex);
+    return state_->cv.wait_for(lock, std::chrono::seconds{ 5 }, [this, count] {
+      return state_->held.size() >= count;
+    });
+  }
+
+  [[nodiscard]] auto held_values() const -> std::vector<std::string>
+  {
+    const std::scoped_lock lock(state_->mutex);
+    std::vector<std::string> values;
+    for (const auto& upsert : state_->held) {
+      values.emplace_back(reinterpret_cast<const char*>(upsert.value.data.data()),
+                          upsert.value.data.size());
+    }
+    return values;
+  }
+
+  // Completes the oldest held upsert successfully, outside of the lock.  Returns false
+  // if there was none.
+  auto complete_next() const -> bool
+  {
+    held_upsert next;
+    {
+      const std::scoped_lock lock(state_->mutex);
+      if (state_->held.empty()) {
+        return false;
+      }
+      next = std::move(state_->held.front());
+      state_->held.erase(state_->held.begin());
+    }
+    next.handler({}, {});
+    return true;
+  }
+
+  // Completes everything held and everything sent from now on, so that the buffer can be
+  // destroyed whatever the checks found.
+  void release_all() const
+  {
+    {
+      const std::scoped_lock lock(state_->mutex);
+      state_->released = true;
+    }
+    while (complete_next()) {
+    }
+  }
+
+private:
+  struct shared_state {
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::vector<held_upsert> held{};
+    bool released{ false };
+  };
+
+  std::shared_ptr<shared_state> state_{ std::make_shared<shared_state>() };
+};
+
+int failures{ 0 };
+
+void
+check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "ok      " : "FAILED  ") << what << "\n";
+  if (!condition) {
+    ++failures;
+  }
+}
+} // namespace
+
+int
+main()
+{
+  const held_collection collection{};
+  write_behind_options options{};
+  options.flush_interval = std::chrono::hours{ 1 }; // only flush() sends anything
+  {
+    basic_write_behind_buffer<held_collection> buffer(collection, options);
+
+    buffer.upsert<raw_string_transcoder>("k", std::string{ "v1" });
+    auto flushed = std::async(std::launch::async, [&buffer] {
+      buffer.flush();
+    });
+    check(collection.wait_for_held(1), "flush() sends v1");
+
+    // v2 arrives under the next generation while v1 is in flight.
+    buffer.upsert<raw_string_transcoder>("k", std::string{ "v2" });
+    check(flushed.wait_for(std::chrono::milliseconds{ 200 }) == std::future_status::timeout,
+          "flush() keeps waiting while v1 is in flight after the key is rewritten");
+
+    check(collection.complete_next(), "v1 completes");
+    check(flushed.wait_for(std::chrono::seconds{ 5 }) == std::future_status::ready,
+          "flush() returns once v1 has completed");
+    const std::vector<std::string> expected{ "v2" };
+    check(collection.wait_for_held(1) && collection.held_values() == expected,
+          "v2 is sent after v1");
+
+    check(collection.complete_next(), "v2 completes");
+    const auto stats = buffer.stats();
+    check(stats.written == 2 && stats.coalesced == 0, "both values are written");
+    collection.release_all();
+  }
+
+  if (failures > 0) {
+    std::cout << failures << " check(s) failed\n";
+    return EXIT_FAILURE;
+  }
+  return 0;
+}